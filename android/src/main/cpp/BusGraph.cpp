@@ -0,0 +1,121 @@
+#include <algorithm>
+
+#include "BusGraph.h"
+
+namespace iolib {
+
+    static constexpr BusParameters kDefaultParameters { 1.0f, 0.0f, false };
+
+    BusGraph::BusGraph() {
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            mIsBus[bus] = bus == kMasterBus;
+            mBusOutput[bus] = kMasterBus;
+            mParameters[bus] = kDefaultParameters;
+        }
+        resetTrackRouting();
+    }
+
+    int32_t BusGraph::createBus() {
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            if (!mIsBus[bus]) {
+                mIsBus[bus] = true;
+                mBusOutput[bus] = kMasterBus;
+                mParameters[bus] = kDefaultParameters;
+                return bus;
+            }
+        }
+        return -1;
+    }
+
+    bool BusGraph::removeBus(int32_t bus) {
+        if (bus == kMasterBus || !isBus(bus)) {
+            return false;
+        }
+
+        int32_t output = mBusOutput[bus];
+        for (int32_t input = 0; input < kMaxBuses; input++) {
+            if (mIsBus[input] && input != kMasterBus && mBusOutput[input] == bus) {
+                mBusOutput[input] = output;
+            }
+        }
+        for (int32_t track = 0; track < kMaxScheduleTracks; track++) {
+            if (mTrackBus[track] == bus) {
+                mTrackBus[track] = output;
+            }
+        }
+        mIsBus[bus] = false;
+        return true;
+    }
+
+    bool BusGraph::isBus(int32_t bus) const {
+        return bus >= 0 && bus < kMaxBuses && mIsBus[bus];
+    }
+
+    bool BusGraph::setBusOutput(int32_t bus, int32_t outputBus) {
+        if (bus == kMasterBus || !isBus(bus) || !isBus(outputBus)) {
+            return false;
+        }
+
+        // outputBus must not be downstream of bus
+        for (int32_t next = outputBus; next != kMasterBus; next = mBusOutput[next]) {
+            if (next == bus) {
+                return false;
+            }
+        }
+
+        mBusOutput[bus] = outputBus;
+        return true;
+    }
+
+    int32_t BusGraph::getBusOutput(int32_t bus) const {
+        return isBus(bus) && bus != kMasterBus ? mBusOutput[bus] : -1;
+    }
+
+    bool BusGraph::setTrackBus(int32_t track, int32_t bus) {
+        if (track < 0 || track >= kMaxScheduleTracks || !isBus(bus)) {
+            return false;
+        }
+        mTrackBus[track] = bus;
+        return true;
+    }
+
+    int32_t BusGraph::getTrackBus(int32_t track) const {
+        return track >= 0 && track < kMaxScheduleTracks ? mTrackBus[track] : kMasterBus;
+    }
+
+    void BusGraph::resetTrackRouting() {
+        std::fill(mTrackBus, mTrackBus + kMaxScheduleTracks, kMasterBus);
+    }
+
+    int32_t BusGraph::getDepth(int32_t bus) const {
+        int32_t depth = 0;
+        for (int32_t next = bus; next != kMasterBus; next = mBusOutput[next]) {
+            depth++;
+        }
+        return depth;
+    }
+
+    void BusGraph::compile(MixSchedule* schedule) const {
+        // Deepest buses first, so every bus has received all of its inputs before it is
+        // summed into its own output
+        int32_t depths[kMaxBuses];
+        int32_t numBuses = 0;
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            if (mIsBus[bus] && bus != kMasterBus) {
+                depths[bus] = getDepth(bus);
+                schedule->busOrder[numBuses++] = static_cast<int8_t>(bus);
+            }
+        }
+        std::stable_sort(schedule->busOrder, schedule->busOrder + numBuses,
+                         [&depths](int8_t a, int8_t b) { return depths[a] > depths[b]; });
+        schedule->numBuses = numBuses;
+
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            schedule->busOutput[bus] = static_cast<int8_t>(mBusOutput[bus]);
+        }
+        for (int32_t track = 0; track < kMaxScheduleTracks; track++) {
+            schedule->trackBus[track] = static_cast<int8_t>(mTrackBus[track]);
+        }
+    }
+
+} // namespace iolib
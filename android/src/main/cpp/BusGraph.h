@@ -0,0 +1,95 @@
+#ifndef _PLAYER_BUSGRAPH_H_
+#define _PLAYER_BUSGRAPH_H_
+
+#include <cstdint>
+
+namespace iolib {
+
+    static constexpr int32_t kMaxBuses = 16;
+    static constexpr int32_t kMasterBus = 0;
+
+    // Tracks a MixSchedule can route, the player's track limit
+    static constexpr int32_t kMaxScheduleTracks = 128;
+
+    /**
+     * Gain, balance [-1.0 (left), 1.0 (right)] and mute of a bus.
+     */
+    struct BusParameters {
+        float gain;
+        float pan;
+        bool muted;
+    };
+
+    /**
+     * A bus graph compiled for the audio thread: flat, fixed size and free of pointers, so it
+     * can be copied and executed without chasing links.
+     */
+    struct MixSchedule {
+        int32_t numBuses;                       // entries in busOrder
+        int8_t busOrder[kMaxBuses];             // sub-buses, every bus after all buses feeding it
+        int8_t busOutput[kMaxBuses];            // by bus id
+        int8_t trackBus[kMaxScheduleTracks];    // by track index
+    };
+
+/**
+ * The routing of tracks into submix buses, as edited on the control thread.
+ *
+ * Bus kMasterBus is the output and always exists. Every other bus feeds exactly one bus
+ * (the master unless changed), so the graph is a tree rooted at the master, and every
+ * track feeds one bus. compile() flattens it into a MixSchedule for the BusMixer.
+ *
+ * Not thread safe, the owner serializes access.
+ */
+    class BusGraph {
+    public:
+        BusGraph();
+
+        /**
+         * Adds a bus feeding the master. Returns its id, or -1 if there are kMaxBuses already.
+         */
+        int32_t createBus();
+
+        /**
+         * Removes a bus (not the master). Its tracks and input buses are moved to the bus it fed.
+         */
+        bool removeBus(int32_t bus);
+
+        bool isBus(int32_t bus) const;
+
+        /**
+         * Routes bus into outputBus. Returns false, and changes nothing, if either isn't a bus,
+         * bus is the master, or outputBus is fed by bus (which would make a loop).
+         */
+        bool setBusOutput(int32_t bus, int32_t outputBus);
+        int32_t getBusOutput(int32_t bus) const;
+
+        bool setTrackBus(int32_t track, int32_t bus);
+        int32_t getTrackBus(int32_t track) const;
+
+        /**
+         * Sends every track straight to the master.
+         */
+        void resetTrackRouting();
+
+        /**
+         * Parameter values as last set, for readback and offline rendering. The BusMixer
+         * keeps its own copy.
+         */
+        BusParameters& getParameters(int32_t bus) { return mParameters[bus]; }
+        const BusParameters& getParameters(int32_t bus) const { return mParameters[bus]; }
+
+        void compile(MixSchedule* schedule) const;
+
+    private:
+        bool mIsBus[kMaxBuses];
+        int32_t mBusOutput[kMaxBuses];
+        int32_t mTrackBus[kMaxScheduleTracks];
+        BusParameters mParameters[kMaxBuses];
+
+        // Number of buses between bus and the master
+        int32_t getDepth(int32_t bus) const;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_BUSGRAPH_H_
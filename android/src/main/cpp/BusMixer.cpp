@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstring>
+
+#include "BusMixer.h"
+#include "MixEngine.h"
+#include "ParallelMixer.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+    // No sub-buses, every track on the master (kMasterBus is 0)
+    const MixSchedule BusMixer::kDefaultSchedule = {};
+
+    BusMixer::BusMixer()
+            : mSchedule(&kDefaultSchedule),
+              mMaxFrames(0),
+              mNumChannels(0),
+              mNumBusTracks {} {
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            setBusParameters(bus, { 1.0f, 0.0f, false });
+        }
+    }
+
+    void BusMixer::prepare(int32_t maxFrames, int32_t numChannels) {
+        if (maxFrames * numChannels > mMaxFrames * mNumChannels) {
+            mBusBuffers.reset(new float[kMaxBuses * maxFrames * numChannels]);
+        }
+        mMaxFrames = maxFrames;
+        mNumChannels = numChannels;
+    }
+
+    const MixSchedule* BusMixer::setSchedule(const MixSchedule* schedule) {
+        const MixSchedule* previous = mSchedule;
+        mSchedule = schedule != nullptr ? schedule : &kDefaultSchedule;
+        return previous != &kDefaultSchedule ? previous : nullptr;
+    }
+
+    void BusMixer::setBusGain(int32_t bus, float gain) {
+        if (bus >= 0 && bus < kMaxBuses) {
+            mParameters[bus].gain = gain;
+            updateBusGains(bus);
+        }
+    }
+
+    void BusMixer::setBusPan(int32_t bus, float pan) {
+        if (bus >= 0 && bus < kMaxBuses) {
+            mParameters[bus].pan = std::max(-1.0f, std::min(pan, 1.0f));
+            updateBusGains(bus);
+        }
+    }
+
+    void BusMixer::setBusMute(int32_t bus, bool muted) {
+        if (bus >= 0 && bus < kMaxBuses) {
+            mParameters[bus].muted = muted;
+            updateBusGains(bus);
+        }
+    }
+
+    void BusMixer::setBusParameters(int32_t bus, const BusParameters& parameters) {
+        if (bus >= 0 && bus < kMaxBuses) {
+            mParameters[bus] = parameters;
+            updateBusGains(bus);
+        }
+    }
+
+    void BusMixer::updateBusGains(int32_t bus) {
+        // Balance rather than the tracks' pan law: a centred bus passes its input unchanged
+        const BusParameters& parameters = mParameters[bus];
+        float gain = parameters.muted ? 0.0f : parameters.gain;
+        mBusGains[bus][0] = gain * std::min(1.0f, 1.0f - parameters.pan);
+        mBusGains[bus][1] = gain * std::min(1.0f, 1.0f + parameters.pan);
+    }
+
+    void BusMixer::mix(SampleSource* const* tracks, int32_t numTracks,
+                       float* outBuff, int32_t numChannels,
+                       int64_t transportFrame, int32_t numFrames,
+                       ParallelMixer* parallelMixer, int32_t sampleRate) {
+        const MixSchedule& schedule = *mSchedule;
+
+        // Sub-buses need their buffers, without them everything goes to the master
+        bool useBuses = schedule.numBuses > 0 && mMaxFrames > 0 && numChannels <= mNumChannels;
+
+        std::fill(mNumBusTracks, mNumBusTracks + kMaxBuses, 0);
+        numTracks = std::min(numTracks, kMaxScheduleTracks);
+        for (int32_t track = 0; track < numTracks; track++) {
+            SampleSource* source = tracks[track];
+            if (source != nullptr) {
+                int32_t bus = useBuses ? schedule.trackBus[track] : kMasterBus;
+                mBusTracks[bus][mNumBusTracks[bus]++] = source;
+            }
+        }
+
+        int32_t sliceFrames = useBuses ? mMaxFrames : numFrames;
+        for (int32_t offset = 0; offset < numFrames; offset += sliceFrames) {
+            int32_t numSliceFrames = std::min(sliceFrames, numFrames - offset);
+            int64_t sliceFrame = transportFrame + offset;
+            float* sliceOut = outBuff + offset * numChannels;
+
+            mixTracks(kMasterBus, sliceOut, numChannels, sliceFrame, numSliceFrames,
+                      parallelMixer, sampleRate);
+            if (!useBuses) {
+                continue;
+            }
+
+            for (int32_t index = 0; index < schedule.numBuses; index++) {
+                int32_t bus = schedule.busOrder[index];
+                float* busBuff = getBusBuffer(bus);
+                memset(busBuff, 0, numSliceFrames * numChannels * sizeof(float));
+                mixTracks(bus, busBuff, numChannels, sliceFrame, numSliceFrames,
+                          parallelMixer, sampleRate);
+            }
+
+            // Children before parents, so each bus is complete when it is summed
+            for (int32_t index = 0; index < schedule.numBuses; index++) {
+                int32_t bus = schedule.busOrder[index];
+                int32_t output = schedule.busOutput[bus];
+                sumBus(bus, getBusBuffer(bus),
+                       output == kMasterBus ? sliceOut : getBusBuffer(output),
+                       numChannels, numSliceFrames);
+            }
+        }
+
+        // The master's own gain, in place
+        bool masterIsUnity = true;
+        for (int32_t channel = 0; channel < std::min(numChannels, 2); channel++) {
+            masterIsUnity &= getChannelGain(kMasterBus, channel, numChannels) == 1.0f;
+        }
+        if (!masterIsUnity) {
+            for (int32_t channel = 0; channel < numChannels; channel++) {
+                float gain = getChannelGain(kMasterBus, channel, numChannels);
+                for (int32_t frame = 0; frame < numFrames; frame++) {
+                    outBuff[frame * numChannels + channel] *= gain;
+                }
+            }
+        }
+    }
+
+    float BusMixer::getChannelGain(int32_t bus, int32_t channel, int32_t numChannels) {
+        if (numChannels >= 2 && channel < 2) {
+            return mBusGains[bus][channel];
+        }
+        return mParameters[bus].muted ? 0.0f : mParameters[bus].gain;
+    }
+
+    void BusMixer::mixTracks(int32_t bus, float* outBuff, int32_t numChannels,
+                             int64_t transportFrame, int32_t numFrames,
+                             ParallelMixer* parallelMixer, int32_t sampleRate) {
+        if (mNumBusTracks[bus] == 0) {
+            return;
+        }
+        if (parallelMixer != nullptr) {
+            parallelMixer->mix(mBusTracks[bus], mNumBusTracks[bus], outBuff, numChannels,
+                               transportFrame, numFrames, sampleRate);
+        } else {
+            MixEngine::mix(mBusTracks[bus], mNumBusTracks[bus], outBuff, numChannels,
+                           transportFrame, numFrames);
+        }
+    }
+
+    void BusMixer::sumBus(int32_t bus, const float* busBuff, float* outBuff,
+                          int32_t numChannels, int32_t numFrames) {
+        float left = mBusGains[bus][0];
+        float right = mBusGains[bus][1];
+        if (mParameters[bus].muted || (left == 0.0f && right == 0.0f)) {
+            return;
+        }
+
+        if (numChannels == 2) {
+            for (int32_t frame = 0; frame < numFrames; frame++) {
+                outBuff[2 * frame] += busBuff[2 * frame] * left;
+                outBuff[2 * frame + 1] += busBuff[2 * frame + 1] * right;
+            }
+        } else {
+            for (int32_t channel = 0; channel < numChannels; channel++) {
+                float gain = getChannelGain(bus, channel, numChannels);
+                for (int32_t frame = 0; frame < numFrames; frame++) {
+                    outBuff[frame * numChannels + channel] +=
+                            busBuff[frame * numChannels + channel] * gain;
+                }
+            }
+        }
+    }
+
+} // namespace iolib
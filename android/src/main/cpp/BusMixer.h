@@ -0,0 +1,95 @@
+#ifndef _PLAYER_BUSMIXER_H_
+#define _PLAYER_BUSMIXER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "BusGraph.h"
+
+namespace iolib {
+
+    class ParallelMixer;
+    class SampleSource;
+
+/**
+ * Executes a MixSchedule: every track is mixed into the buffer of its bus, then the buses are
+ * summed into their outputs in schedule order, scaled by one gain per channel. A bus gain,
+ * pan or mute therefore costs one multiply per bus sample, however many tracks feed it.
+ *
+ * Muted buses are still mixed (only their sum is dropped), so unmuting never has to wait for
+ * streaming tracks to catch up.
+ *
+ * prepare() allocates and is for the control thread. Everything else is for the mixing
+ * thread, and never allocates or blocks.
+ */
+    class BusMixer {
+    public:
+        BusMixer();
+
+        /**
+         * Sizes the bus buffers. Blocks larger than maxFrames are mixed in slices.
+         */
+        void prepare(int32_t maxFrames, int32_t numChannels);
+
+        /**
+         * Switches to schedule, which must stay valid until it is replaced. nullptr routes
+         * every track to the master. Returns the schedule replaced (nullptr for the default),
+         * which is no longer referenced.
+         */
+        const MixSchedule* setSchedule(const MixSchedule* schedule);
+
+        void setBusGain(int32_t bus, float gain);
+        void setBusPan(int32_t bus, float pan);
+        void setBusMute(int32_t bus, bool muted);
+        void setBusParameters(int32_t bus, const BusParameters& parameters);
+
+        /**
+         * Adds numFrames frames of every playing track, through the buses, to outBuff (which
+         * the caller has cleared). tracks is indexed by track number and may contain nullptr
+         * for tracks that aren't loaded. Each bus's tracks are mixed by parallelMixer, or
+         * serially if it is nullptr.
+         */
+        void mix(SampleSource* const* tracks, int32_t numTracks,
+                 float* outBuff, int32_t numChannels,
+                 int64_t transportFrame, int32_t numFrames,
+                 ParallelMixer* parallelMixer, int32_t sampleRate);
+
+    private:
+        static const MixSchedule kDefaultSchedule;
+
+        const MixSchedule* mSchedule;
+        BusParameters mParameters[kMaxBuses];
+
+        // Left/right gain each bus is summed with, from mParameters
+        float mBusGains[kMaxBuses][2];
+
+        // One maxFrames block per bus
+        std::unique_ptr<float[]> mBusBuffers;
+        int32_t mMaxFrames;
+        int32_t mNumChannels;
+
+        // The playing tracks of each bus, gathered per block
+        SampleSource* mBusTracks[kMaxBuses][kMaxScheduleTracks];
+        int32_t mNumBusTracks[kMaxBuses];
+
+        void updateBusGains(int32_t bus);
+
+        // Balance applies to the front pair of stereo and multichannel outputs only
+        float getChannelGain(int32_t bus, int32_t channel, int32_t numChannels);
+
+        float* getBusBuffer(int32_t bus) {
+            return mBusBuffers.get() + bus * mMaxFrames * mNumChannels;
+        }
+
+        void mixTracks(int32_t bus, float* outBuff, int32_t numChannels,
+                       int64_t transportFrame, int32_t numFrames,
+                       ParallelMixer* parallelMixer, int32_t sampleRate);
+
+        // outBuff += busBuff * the bus's gains
+        void sumBus(int32_t bus, const float* busBuff, float* outBuff, int32_t numChannels,
+                    int32_t numFrames);
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_BUSMIXER_H_
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <ctime>
+
+#include "CallbackProfiler.h"
+
+namespace iolib {
+
+    static const double kPercentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+    static int64_t clockNanos(clockid_t clock) {
+        timespec time;
+        clock_gettime(clock, &time);
+        return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+
+    CallbackProfiler::CallbackProfiler()
+            : mResetRequested(false),
+              mWallStartNanos(0),
+              mCpuStartNanos(0),
+              mLastXRunCount(-1) {
+        clear();
+    }
+
+    void CallbackProfiler::clear() {
+        for (int32_t bucket = 0; bucket < kNumBuckets; bucket++) {
+            mWallHistogram[bucket].store(0, std::memory_order_relaxed);
+            mCpuHistogram[bucket].store(0, std::memory_order_relaxed);
+        }
+        mNumCallbacks.store(0, std::memory_order_relaxed);
+        mNumLateCallbacks.store(0, std::memory_order_relaxed);
+        mNumXRuns.store(0, std::memory_order_relaxed);
+        mMaxWallLoad.store(0.0f, std::memory_order_relaxed);
+        mMaxCpuLoad.store(0.0f, std::memory_order_relaxed);
+        mLastWallLoad.store(0.0f, std::memory_order_relaxed);
+        for (int32_t track = 0; track < kMaxTracks; track++) {
+            mTrackNanos[track].store(0, std::memory_order_relaxed);
+            mTrackCalls[track].store(0, std::memory_order_relaxed);
+            mTrackMaxNanos[track].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void CallbackProfiler::beginCallback() {
+        if (mResetRequested.load(std::memory_order_acquire)) {
+            mResetRequested.store(false, std::memory_order_relaxed);
+            clear();
+        }
+        mWallStartNanos = clockNanos(CLOCK_MONOTONIC);
+        mCpuStartNanos = clockNanos(CLOCK_THREAD_CPUTIME_ID);
+    }
+
+    void CallbackProfiler::addTrackCost(int32_t track, int64_t nanos) {
+        if (track < 0 || track >= kMaxTracks) {
+            return;
+        }
+        increment<uint64_t>(mTrackNanos[track], static_cast<uint64_t>(nanos));
+        increment<uint32_t>(mTrackCalls[track]);
+        uint32_t cost = static_cast<uint32_t>(std::min<int64_t>(nanos, UINT32_MAX));
+        if (cost > mTrackMaxNanos[track].load(std::memory_order_relaxed)) {
+            mTrackMaxNanos[track].store(cost, std::memory_order_relaxed);
+        }
+    }
+
+    bool CallbackProfiler::endCallback(int32_t numFrames, int32_t sampleRate, int32_t xRunCount) {
+        int64_t wallNanos = clockNanos(CLOCK_MONOTONIC) - mWallStartNanos;
+        int64_t cpuNanos = clockNanos(CLOCK_THREAD_CPUTIME_ID) - mCpuStartNanos;
+        if (numFrames <= 0 || sampleRate <= 0) {
+            return false;
+        }
+
+        float budgetNanos = numFrames * 1e9f / sampleRate;
+        float wallLoad = wallNanos / budgetNanos;
+        recordLoad(mWallHistogram, mMaxWallLoad, wallLoad);
+        recordLoad(mCpuHistogram, mMaxCpuLoad, cpuNanos / budgetNanos);
+        mLastWallLoad.store(wallLoad, std::memory_order_relaxed);
+        increment<uint32_t>(mNumCallbacks);
+
+        // The stream's count is cumulative, and restarts with a new stream
+        if (xRunCount >= 0) {
+            if (mLastXRunCount >= 0 && xRunCount > mLastXRunCount) {
+                increment<uint32_t>(mNumXRuns, xRunCount - mLastXRunCount);
+            }
+            mLastXRunCount = xRunCount;
+        }
+
+        bool isLate = wallLoad > 1.0f;
+        if (isLate) {
+            increment<uint32_t>(mNumLateCallbacks);
+        }
+        return isLate;
+    }
+
+    void CallbackProfiler::recordLoad(std::atomic<uint32_t>* histogram,
+                                      std::atomic<float>& maxLoad, float load) {
+        int32_t bucket = std::min(kNumBuckets - 1,
+                                  std::max(0, static_cast<int32_t>(load * kBucketsPerBudget)));
+        increment<uint32_t>(histogram[bucket]);
+        if (load > maxLoad.load(std::memory_order_relaxed)) {
+            maxLoad.store(load, std::memory_order_relaxed);
+        }
+    }
+
+    void CallbackProfiler::getPercentiles(const std::atomic<uint32_t>* histogram,
+                                          float* percentiles) {
+        uint32_t counts[kNumBuckets];
+        uint64_t total = 0;
+        for (int32_t bucket = 0; bucket < kNumBuckets; bucket++) {
+            counts[bucket] = histogram[bucket].load(std::memory_order_relaxed);
+            total += counts[bucket];
+        }
+
+        int32_t bucket = 0;
+        uint64_t below = counts[0];
+        for (int32_t index = 0; index < 4; index++) {
+            uint64_t rank = static_cast<uint64_t>(kPercentiles[index] * total);
+            while (bucket < kNumBuckets - 1 && below <= rank && below < total) {
+                below += counts[++bucket];
+            }
+            percentiles[index] = total > 0
+                                 ? static_cast<float>(bucket + 1) / kBucketsPerBudget
+                                 : 0.0f;
+        }
+    }
+
+    void CallbackProfiler::getReport(Report* report, int32_t maxOffenders) const {
+        report->numCallbacks = mNumCallbacks.load(std::memory_order_relaxed);
+        report->numLateCallbacks = mNumLateCallbacks.load(std::memory_order_relaxed);
+        report->numXRuns = mNumXRuns.load(std::memory_order_relaxed);
+        getPercentiles(mWallHistogram, report->wallLoadPercentiles);
+        getPercentiles(mCpuHistogram, report->cpuLoadPercentiles);
+        report->maxWallLoad = mMaxWallLoad.load(std::memory_order_relaxed);
+        report->maxCpuLoad = mMaxCpuLoad.load(std::memory_order_relaxed);
+
+        // Keep the costliest tracks, by insertion into the short sorted list
+        maxOffenders = std::max(0, std::min(maxOffenders, kMaxOffenders));
+        report->numOffenders = 0;
+        for (int32_t track = 0; track < kMaxTracks && maxOffenders > 0; track++) {
+            uint32_t calls = mTrackCalls[track].load(std::memory_order_relaxed);
+            if (calls == 0) {
+                continue;
+            }
+            TrackCost cost;
+            cost.track = track;
+            cost.meanMicros = mTrackNanos[track].load(std::memory_order_relaxed) / (calls * 1e3f);
+            cost.maxMicros = mTrackMaxNanos[track].load(std::memory_order_relaxed) / 1e3f;
+
+            int32_t position = report->numOffenders;
+            while (position > 0 && report->offenders[position - 1].meanMicros < cost.meanMicros) {
+                if (position < maxOffenders) {
+                    report->offenders[position] = report->offenders[position - 1];
+                }
+                position--;
+            }
+            if (position < maxOffenders) {
+                report->offenders[position] = cost;
+                report->numOffenders = std::min(report->numOffenders + 1, maxOffenders);
+            }
+        }
+    }
+
+} // namespace iolib
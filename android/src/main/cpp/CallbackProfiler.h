@@ -0,0 +1,124 @@
+#ifndef _PLAYER_CALLBACKPROFILER_H_
+#define _PLAYER_CALLBACKPROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace iolib {
+
+/**
+ * How close the audio callback runs to its deadline.
+ *
+ * Every callback's wall time and thread CPU time go into histograms of load, the fraction of
+ * the callback's budget (the duration of the frames it renders) it used. Callbacks over
+ * budget count as late, and the stream's xrun count is followed. Each track's mix cost is
+ * summed too, to find the tracks that cost the most.
+ *
+ * The audio thread is the only writer and never waits: counters are atomics it updates with
+ * relaxed stores. getReport() may run on any thread at any time, a report taken while a
+ * callback is being recorded may be off by that callback.
+ */
+    class CallbackProfiler {
+    public:
+        static constexpr int32_t kMaxTracks = 128;
+
+        // Load histogram buckets of 1/kBucketsPerBudget of the budget, the last one also
+        // holds everything beyond
+        static constexpr int32_t kBucketsPerBudget = 32;
+        static constexpr int32_t kNumBuckets = 2 * kBucketsPerBudget + 1;
+
+        static constexpr int32_t kMaxOffenders = 8;
+
+        struct TrackCost {
+            int32_t track;
+            float meanMicros;       // per callback the track was mixed in
+            float maxMicros;
+        };
+
+        struct Report {
+            uint32_t numCallbacks;
+            uint32_t numLateCallbacks;  // wall time over budget
+            uint32_t numXRuns;          // reported by the stream since the last reset
+
+            // Load (time / budget) at the 50th, 90th, 99th and 99.9th percentile, to the
+            // bucket's upper edge, and the worst seen
+            float wallLoadPercentiles[4];
+            float cpuLoadPercentiles[4];
+            float maxWallLoad;
+            float maxCpuLoad;
+
+            // The costliest tracks by mean cost, worst first
+            int32_t numOffenders;
+            TrackCost offenders[kMaxOffenders];
+        };
+
+        CallbackProfiler();
+
+        /**
+         * Audio thread, at the start of a callback.
+         */
+        void beginCallback();
+
+        /**
+         * Audio thread: the cost of mixing track in this callback, in nanoseconds.
+         */
+        void addTrackCost(int32_t track, int64_t nanos);
+
+        /**
+         * Audio thread, at the end of a callback that rendered numFrames frames.
+         * xRunCount is the stream's running count (negative if it doesn't report one).
+         * Returns true if the callback was late.
+         */
+        bool endCallback(int32_t numFrames, int32_t sampleRate, int32_t xRunCount);
+
+        /**
+         * Any thread. maxOffenders is clamped to kMaxOffenders.
+         */
+        void getReport(Report* report, int32_t maxOffenders = kMaxOffenders) const;
+
+        /**
+         * Any thread: the audio thread clears the statistics at its next callback.
+         */
+        void reset() { mResetRequested.store(true, std::memory_order_release); }
+
+        // Load of the last callback (wall time / budget)
+        float getLastWallLoad() const { return mLastWallLoad.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint32_t> mWallHistogram[kNumBuckets];
+        std::atomic<uint32_t> mCpuHistogram[kNumBuckets];
+        std::atomic<uint32_t> mNumCallbacks;
+        std::atomic<uint32_t> mNumLateCallbacks;
+        std::atomic<uint32_t> mNumXRuns;
+        std::atomic<float> mMaxWallLoad;
+        std::atomic<float> mMaxCpuLoad;
+        std::atomic<float> mLastWallLoad;
+
+        std::atomic<uint64_t> mTrackNanos[kMaxTracks];
+        std::atomic<uint32_t> mTrackCalls[kMaxTracks];
+        std::atomic<uint32_t> mTrackMaxNanos[kMaxTracks];
+
+        std::atomic<bool> mResetRequested;
+
+        // Audio thread only
+        int64_t mWallStartNanos;
+        int64_t mCpuStartNanos;
+        int32_t mLastXRunCount;
+
+        void clear();
+
+        // Single writer, so a load and a store do
+        template <typename T>
+        static void increment(std::atomic<T>& counter, T amount = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + amount,
+                          std::memory_order_relaxed);
+        }
+
+        static void recordLoad(std::atomic<uint32_t>* histogram, std::atomic<float>& maxLoad,
+                               float load);
+        static void getPercentiles(const std::atomic<uint32_t>* histogram, float* percentiles);
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_CALLBACKPROFILER_H_
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <chrono>
+
+#include "DiskStreamer.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+    DiskStreamer::DiskStreamer()
+            : mBufferFrames(kDefaultBufferFrames),
+              mLowWatermarkFrames(kDefaultLowWatermarkFrames),
+              mHighWatermarkFrames(kDefaultBufferFrames),
+              mRunning(false)
+    {}
+
+    DiskStreamer::~DiskStreamer() {
+        stop();
+    }
+
+    void DiskStreamer::start() {
+        std::lock_guard<std::mutex> lock(mRunLock);
+        if (mRunning) {
+            return;
+        }
+        mRunning = true;
+        mStreamThread = std::thread(&DiskStreamer::streamLoop, this);
+    }
+
+    void DiskStreamer::stop() {
+        {
+            std::lock_guard<std::mutex> lock(mRunLock);
+            if (!mRunning) {
+                return;
+            }
+            mRunning = false;
+        }
+        mRunCondition.notify_all();
+        if (mStreamThread.joinable()) {
+            mStreamThread.join();
+        }
+    }
+
+    void DiskStreamer::addSource(SampleSource* source) {
+        source->allocateStreamBuffer(mBufferFrames);
+
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        mSources.push_back(source);
+    }
+
+    void DiskStreamer::removeSource(SampleSource* source) {
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        mSources.erase(std::remove(mSources.begin(), mSources.end(), source), mSources.end());
+    }
+
+    void DiskStreamer::removeAllSources() {
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        mSources.clear();
+    }
+
+    void DiskStreamer::setBufferFrames(int32_t numFrames) {
+        mBufferFrames = numFrames;
+        setWatermarks(mLowWatermarkFrames.load(), mHighWatermarkFrames.load());
+    }
+
+    void DiskStreamer::setWatermarks(int32_t lowWatermarkFrames, int32_t highWatermarkFrames) {
+        // Stream buffers are rounded up to a power of two, so mBufferFrames is always available
+        highWatermarkFrames = std::min(highWatermarkFrames, mBufferFrames);
+        lowWatermarkFrames = std::min(lowWatermarkFrames, highWatermarkFrames);
+        mHighWatermarkFrames.store(highWatermarkFrames);
+        mLowWatermarkFrames.store(lowWatermarkFrames);
+    }
+
+    void DiskStreamer::streamLoop() {
+        std::unique_lock<std::mutex> runLock(mRunLock);
+        while (mRunning) {
+            runLock.unlock();
+
+            int32_t lowWatermarkFrames = mLowWatermarkFrames.load();
+            int32_t highWatermarkFrames = mHighWatermarkFrames.load();
+            int32_t numDecoded = 0;
+            {
+                std::lock_guard<std::mutex> lock(mSourcesLock);
+                for (SampleSource* source : mSources) {
+                    numDecoded += source->serviceStream(lowWatermarkFrames, highWatermarkFrames);
+                }
+            }
+
+            runLock.lock();
+            if (numDecoded == 0) {
+                // Everyone is above the low watermark (or waiting on a seek), nap until the
+                // audio thread has had a chance to consume something.
+                mRunCondition.wait_for(runLock,
+                                       std::chrono::milliseconds(kDefaultPollPeriodMillis));
+            }
+        }
+    }
+
+} // namespace iolib
@@ -0,0 +1,74 @@
+#ifndef _PLAYER_DISKSTREAMER_H_
+#define _PLAYER_DISKSTREAMER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace iolib {
+
+    class SampleSource;
+
+/**
+ * Keeps the stream buffers of all registered SampleSources topped up from a single
+ * background I/O thread, so the audio callback only ever consumes already-decoded frames.
+ *
+ * A source is refilled to the high watermark once it drops below the low watermark.
+ */
+    class DiskStreamer {
+    public:
+        // ~1.4s / ~0.34s at 48kHz
+        static constexpr int32_t kDefaultBufferFrames = 65536;
+        static constexpr int32_t kDefaultLowWatermarkFrames = 16384;
+        static constexpr int32_t kDefaultPollPeriodMillis = 5;
+
+        DiskStreamer();
+        ~DiskStreamer();
+
+        void start();
+        void stop();
+
+        /**
+         * Allocates the source's stream buffer and starts servicing it. Control thread only,
+         * before the source is added to the mix.
+         */
+        void addSource(SampleSource* source);
+
+        /**
+         * Stops servicing the source. When this returns the I/O thread no longer references it.
+         */
+        void removeSource(SampleSource* source);
+        void removeAllSources();
+
+        /**
+         * Stream buffer size for sources added from now on. The high watermark is clamped to it.
+         */
+        void setBufferFrames(int32_t numFrames);
+        int32_t getBufferFrames() { return mBufferFrames; }
+
+        void setWatermarks(int32_t lowWatermarkFrames, int32_t highWatermarkFrames);
+        int32_t getLowWatermarkFrames() { return mLowWatermarkFrames.load(); }
+        int32_t getHighWatermarkFrames() { return mHighWatermarkFrames.load(); }
+
+    private:
+        void streamLoop();
+
+        std::mutex mSourcesLock;    // guards mSources, held by the I/O thread for a whole pass
+        std::vector<SampleSource*> mSources;
+
+        int32_t mBufferFrames;
+        std::atomic<int32_t> mLowWatermarkFrames;
+        std::atomic<int32_t> mHighWatermarkFrames;
+
+        std::thread mStreamThread;
+        std::mutex mRunLock;
+        std::condition_variable mRunCondition;
+        bool mRunning;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_DISKSTREAMER_H_
@@ -0,0 +1,123 @@
+#ifndef _PLAYER_FRAMERINGBUFFER_H_
+#define _PLAYER_FRAMERINGBUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace iolib {
+
+/**
+ * A single-producer/single-consumer ring buffer of interleaved float audio frames.
+ *
+ * The producer (the disk streaming thread) writes decoded frames, the consumer (the audio
+ * callback) reads them. Neither side blocks or allocates. allocate() must be called before
+ * either side starts using the buffer.
+ */
+    class FrameRingBuffer {
+    public:
+        FrameRingBuffer() : mCapacityFrames(0), mChannelCount(0), mWriteFrame(0), mReadFrame(0) {}
+
+        /**
+         * Allocates room for at least capacityFrames frames (rounded up to a power of two).
+         * Not thread-safe, control thread only.
+         */
+        void allocate(int32_t capacityFrames, int32_t channelCount) {
+            int32_t capacity = 1;
+            while (capacity < capacityFrames) {
+                capacity <<= 1;
+            }
+            mBuffer.reset(new float[capacity * channelCount]);
+            mCapacityFrames = capacity;
+            mChannelCount = channelCount;
+            mWriteFrame.store(0, std::memory_order_relaxed);
+            mReadFrame.store(0, std::memory_order_relaxed);
+        }
+
+        int32_t getCapacityFrames() const { return mCapacityFrames; }
+
+        int32_t getReadableFrames() const {
+            return static_cast<int32_t>(mWriteFrame.load(std::memory_order_acquire)
+                                        - mReadFrame.load(std::memory_order_acquire));
+        }
+
+        int32_t getWritableFrames() const {
+            return mCapacityFrames - getReadableFrames();
+        }
+
+        /*
+         * Producer side
+         */
+
+        /**
+         * Returns a pointer to the largest contiguous writable region, its length in frames
+         * is returned in numFrames. Follow with commitWrite().
+         */
+        float* getWriteRegion(int32_t* numFrames) {
+            uint32_t writeFrame = mWriteFrame.load(std::memory_order_relaxed);
+            int32_t offset = static_cast<int32_t>(writeFrame & (mCapacityFrames - 1));
+            *numFrames = std::min(getWritableFrames(), mCapacityFrames - offset);
+            return mBuffer.get() + offset * mChannelCount;
+        }
+
+        void commitWrite(int32_t numFrames) {
+            mWriteFrame.store(mWriteFrame.load(std::memory_order_relaxed) + numFrames,
+                              std::memory_order_release);
+        }
+
+        /*
+         * Consumer side
+         */
+
+        /**
+         * Copies up to numFrames frames into buff. Returns the number of frames copied.
+         */
+        int32_t read(float* buff, int32_t numFrames) {
+            uint32_t readFrame = mReadFrame.load(std::memory_order_relaxed);
+            int32_t numRead = std::min(numFrames, getReadableFrames());
+            int32_t offset = static_cast<int32_t>(readFrame & (mCapacityFrames - 1));
+            int32_t firstPart = std::min(numRead, mCapacityFrames - offset);
+
+            memcpy(buff, mBuffer.get() + offset * mChannelCount,
+                   firstPart * mChannelCount * sizeof(float));
+            if (numRead > firstPart) {
+                memcpy(buff + firstPart * mChannelCount, mBuffer.get(),
+                       (numRead - firstPart) * mChannelCount * sizeof(float));
+            }
+
+            mReadFrame.store(readFrame + numRead, std::memory_order_release);
+            return numRead;
+        }
+
+        /**
+         * Discards up to numFrames frames. Returns the number of frames discarded.
+         */
+        int32_t skip(int32_t numFrames) {
+            int32_t numSkipped = std::min(numFrames, getReadableFrames());
+            mReadFrame.store(mReadFrame.load(std::memory_order_relaxed) + numSkipped,
+                             std::memory_order_release);
+            return numSkipped;
+        }
+
+        /**
+         * Discards everything that is currently readable.
+         */
+        void flush() {
+            mReadFrame.store(mWriteFrame.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+    private:
+        std::unique_ptr<float[]> mBuffer;
+        int32_t mCapacityFrames;
+        int32_t mChannelCount;
+
+        // Free-running frame counters, masked on access
+        alignas(64) std::atomic<uint32_t> mWriteFrame;
+        alignas(64) std::atomic<uint32_t> mReadFrame;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_FRAMERINGBUFFER_H_
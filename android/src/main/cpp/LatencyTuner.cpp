@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LatencyTuner.h"
+
+namespace iolib {
+
+    LatencyTuner::LatencyTuner()
+            : mEnabled(true),
+              mMaxLatencyMillis(kDefaultMaxLatencyMillis),
+              mQuietSeconds(kDefaultQuietSeconds),
+              mBufferFrames(0),
+              mSampleRate(0),
+              mFramesPerBurst(0),
+              mCapacityFrames(0),
+              mLastXRunCount(-1),
+              mQuietFrames(0) {
+    }
+
+    int32_t LatencyTuner::reset(int32_t framesPerBurst, int32_t capacityFrames,
+                                int32_t sampleRate) {
+        mFramesPerBurst = std::max(1, framesPerBurst);
+        mCapacityFrames = std::max(mFramesPerBurst, capacityFrames);
+        mSampleRate.store(sampleRate, std::memory_order_relaxed);
+        mLastXRunCount = -1;
+        mQuietFrames = 0;
+
+        int32_t bufferFrames = isEnabled()
+                               ? mFramesPerBurst
+                               : std::min(mFramesPerBurst * kFallbackBursts, mCapacityFrames);
+        mBufferFrames.store(bufferFrames, std::memory_order_relaxed);
+        return bufferFrames;
+    }
+
+    int32_t LatencyTuner::getMaxBufferFrames() const {
+        // Rounded up to whole bursts, so a ceiling between two sizes allows the larger one
+        float maxLatencyMillis = mMaxLatencyMillis.load(std::memory_order_relaxed);
+        int32_t sampleRate = mSampleRate.load(std::memory_order_relaxed);
+        int32_t maxBursts = static_cast<int32_t>(
+                ceilf(maxLatencyMillis * sampleRate / (1000.0f * mFramesPerBurst)));
+        return std::min(mCapacityFrames, std::max(1, maxBursts) * mFramesPerBurst);
+    }
+
+    int32_t LatencyTuner::update(int32_t xRunCount, int32_t numFrames) {
+        int32_t bufferFrames = mBufferFrames.load(std::memory_order_relaxed);
+        if (mFramesPerBurst == 0) {
+            return bufferFrames;
+        }
+        if (xRunCount < 0 || !isEnabled()) {
+            return std::max(bufferFrames,
+                            std::min(mFramesPerBurst * kFallbackBursts, mCapacityFrames));
+        }
+
+        int32_t maxBufferFrames = getMaxBufferFrames();
+        bool hadXRun = mLastXRunCount >= 0 && xRunCount > mLastXRunCount;
+        mLastXRunCount = xRunCount;
+
+        if (hadXRun) {
+            // One burst per callback that saw xruns, however many: they often come in bunches
+            mQuietFrames = 0;
+            return std::min(bufferFrames + mFramesPerBurst, maxBufferFrames);
+        }
+
+        mQuietFrames += numFrames;
+        float quietSeconds = mQuietSeconds.load(std::memory_order_relaxed);
+        int32_t sampleRate = mSampleRate.load(std::memory_order_relaxed);
+        if (bufferFrames > maxBufferFrames) {
+            // The ceiling was lowered
+            mQuietFrames = 0;
+            return maxBufferFrames;
+        }
+        if (bufferFrames > mFramesPerBurst && mQuietFrames >= quietSeconds * sampleRate) {
+            mQuietFrames = 0;
+            return bufferFrames - mFramesPerBurst;
+        }
+        return bufferFrames;
+    }
+
+    float LatencyTuner::getLatencyMillis() const {
+        int32_t sampleRate = mSampleRate.load(std::memory_order_relaxed);
+        return sampleRate > 0
+               ? 1000.0f * mBufferFrames.load(std::memory_order_relaxed) / sampleRate
+               : 0.0f;
+    }
+
+} // namespace iolib
@@ -0,0 +1,90 @@
+#ifndef _PLAYER_LATENCYTUNER_H_
+#define _PLAYER_LATENCYTUNER_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace iolib {
+
+/**
+ * Sizes the output stream's buffer from the xruns it reports: starts at one burst, grows by
+ * a burst whenever the xrun count rises, and gives a burst back after a quiet period, never
+ * beyond the latency ceiling (or the buffer's capacity).
+ *
+ * Streams that don't count xruns can't be tuned, they get kFallbackBursts.
+ *
+ * reset() is for the control thread while the stream is stopped. update() is for the audio
+ * callback, it neither allocates nor blocks. The settings and getters are for any thread.
+ */
+    class LatencyTuner {
+    public:
+        // The size a stream gets when it can't be tuned, or tuning is off
+        static constexpr int32_t kFallbackBursts = 2;
+
+        static constexpr float kDefaultMaxLatencyMillis = 100.0f;
+        static constexpr float kDefaultQuietSeconds = 10.0f;
+
+        LatencyTuner();
+
+        /**
+         * For a newly opened stream. Returns the buffer size to start it with.
+         */
+        int32_t reset(int32_t framesPerBurst, int32_t capacityFrames, int32_t sampleRate);
+
+        void setEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+        bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+        /**
+         * The ceiling growth stops at, at least one burst. Applies from the next update().
+         */
+        void setMaxLatencyMillis(float maxLatencyMillis) {
+            mMaxLatencyMillis.store(maxLatencyMillis, std::memory_order_relaxed);
+        }
+
+        /**
+         * How long without xruns before the buffer shrinks by a burst.
+         */
+        void setQuietSeconds(float quietSeconds) {
+            mQuietSeconds.store(quietSeconds, std::memory_order_relaxed);
+        }
+
+        /**
+         * Audio thread, once per callback of numFrames frames. xRunCount is the stream's
+         * running count, negative if it has none. Returns the buffer size the stream should
+         * have; if that's a change, set it and report the size the stream took with
+         * setActualBufferSize().
+         */
+        int32_t update(int32_t xRunCount, int32_t numFrames);
+
+        void setActualBufferSize(int32_t bufferFrames) {
+            mBufferFrames.store(bufferFrames, std::memory_order_relaxed);
+        }
+
+        int32_t getBufferSizeInFrames() const {
+            return mBufferFrames.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * The latency the buffer adds, in milliseconds.
+         */
+        float getLatencyMillis() const;
+
+    private:
+        std::atomic<bool> mEnabled;
+        std::atomic<float> mMaxLatencyMillis;
+        std::atomic<float> mQuietSeconds;
+        std::atomic<int32_t> mBufferFrames;
+        std::atomic<int32_t> mSampleRate;
+
+        // Audio thread, after reset()
+        int32_t mFramesPerBurst;
+        int32_t mCapacityFrames;
+        int32_t mLastXRunCount;
+        int64_t mQuietFrames;
+
+        int32_t getMaxBufferFrames() const;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_LATENCYTUNER_H_
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LevelMeters.h"
+
+namespace iolib {
+
+    // Overtaken reads are retried this often before read() reports silence
+    static constexpr int32_t kMaxReadAttempts = 4;
+
+    LevelMeters::LevelMeters()
+            : mSampleRate(48000),
+              mRefreshFrames(static_cast<int32_t>(48000 / kDefaultRefreshHz)),
+              mReleaseDecibelsPerSecond(kDefaultReleaseDecibelsPerSecond),
+              mHoldSeconds(kDefaultHoldSeconds),
+              mPeaks {},
+              mEnergies {},
+              mNumTracks(0),
+              mWindowFrames(0),
+              mNumBlocks(0),
+              mFramesMeasured(0),
+              mWriteIndex(0),
+              mDisplayPeaks {},
+              mDisplayMeanSquares {},
+              mHolds {},
+              mHoldAges {},
+              mPublishedIndex(1) {
+        for (Snapshot& snapshot : mSnapshots) {
+            snapshot.sequence.store(0, std::memory_order_relaxed);
+            snapshot.numTracks.store(0, std::memory_order_relaxed);
+            for (int32_t track = 0; track < kMaxTracks; track++) {
+                snapshot.peaks[track].store(0.0f, std::memory_order_relaxed);
+                snapshot.meanSquares[track].store(0.0f, std::memory_order_relaxed);
+                snapshot.holds[track].store(0.0f, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    float LevelMeters::toDecibels(float amplitude) {
+        return amplitude > 0.0f
+               ? std::max(kSilenceDecibels, 20.0f * log10f(amplitude))
+               : kSilenceDecibels;
+    }
+
+    void LevelMeters::setSampleRate(int32_t sampleRate) {
+        if (sampleRate <= 0) {
+            return;
+        }
+        int32_t previousRate = mSampleRate.exchange(sampleRate, std::memory_order_relaxed);
+        int64_t refreshFrames = static_cast<int64_t>(mRefreshFrames.load(std::memory_order_relaxed))
+                                * sampleRate / previousRate;
+        mRefreshFrames.store(static_cast<int32_t>(std::max<int64_t>(1, refreshFrames)),
+                             std::memory_order_relaxed);
+    }
+
+    void LevelMeters::setBallistics(float refreshHz, float releaseDecibelsPerSecond,
+                                    float holdSeconds) {
+        if (refreshHz > 0.0f) {
+            mRefreshFrames.store(
+                    std::max(1, static_cast<int32_t>(mSampleRate.load(std::memory_order_relaxed)
+                                                     / refreshHz)),
+                    std::memory_order_relaxed);
+        }
+        mReleaseDecibelsPerSecond.store(std::max(0.0f, releaseDecibelsPerSecond),
+                                        std::memory_order_relaxed);
+        mHoldSeconds.store(std::max(0.0f, holdSeconds), std::memory_order_relaxed);
+    }
+
+    bool LevelMeters::endBlock(int32_t numFrames) {
+        mNumBlocks++;
+        mWindowFrames += numFrames;
+        mFramesMeasured += numFrames;
+        if (mWindowFrames < mRefreshFrames.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        applyBallistics(mWindowFrames / static_cast<float>(mSampleRate.load(std::memory_order_relaxed)));
+        publish();
+        std::fill(mPeaks, mPeaks + mNumTracks, 0.0f);
+        std::fill(mEnergies, mEnergies + mNumTracks, 0.0f);
+        mWindowFrames = 0;
+        mNumBlocks = 0;
+        return true;
+    }
+
+    void LevelMeters::applyBallistics(float elapsedSeconds) {
+        // Once per refresh, not per track: the dB/s release as a linear factor
+        float release = powf(10.0f, -mReleaseDecibelsPerSecond.load(std::memory_order_relaxed)
+                                    * elapsedSeconds / 20.0f);
+        float rmsWeight = 1.0f - expf(-elapsedSeconds / kRmsIntegrationSeconds);
+        float holdSeconds = mHoldSeconds.load(std::memory_order_relaxed);
+        float blockScale = 1.0f / mNumBlocks;
+
+        for (int32_t track = 0; track < mNumTracks; track++) {
+            float peak = mPeaks[track];
+            mDisplayPeaks[track] = std::max(peak, mDisplayPeaks[track] * release);
+            mDisplayMeanSquares[track] += rmsWeight
+                                          * (mEnergies[track] * blockScale
+                                             - mDisplayMeanSquares[track]);
+            if (peak >= mHolds[track]) {
+                mHolds[track] = peak;
+                mHoldAges[track] = 0.0f;
+            } else {
+                mHoldAges[track] += elapsedSeconds;
+                if (mHoldAges[track] > holdSeconds) {
+                    mHolds[track] = mDisplayPeaks[track];
+                }
+            }
+        }
+    }
+
+    void LevelMeters::publish() {
+        Snapshot& snapshot = mSnapshots[mWriteIndex];
+        uint32_t sequence = snapshot.sequence.load(std::memory_order_relaxed);
+        snapshot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        snapshot.numTracks.store(mNumTracks, std::memory_order_relaxed);
+        for (int32_t track = 0; track < mNumTracks; track++) {
+            snapshot.peaks[track].store(mDisplayPeaks[track], std::memory_order_relaxed);
+            snapshot.meanSquares[track].store(mDisplayMeanSquares[track],
+                                              std::memory_order_relaxed);
+            snapshot.holds[track].store(mHolds[track], std::memory_order_relaxed);
+        }
+
+        snapshot.sequence.store(sequence + 2, std::memory_order_release);
+        mPublishedIndex.store(mWriteIndex, std::memory_order_release);
+        mWriteIndex ^= 1;
+    }
+
+    int32_t LevelMeters::copyLevels(float* values, int32_t numTracks) const {
+        numTracks = std::max(0, std::min(numTracks, mNumTracks));
+        for (int32_t track = 0; track < numTracks; track++) {
+            values[track * kValuesPerTrack] = mDisplayPeaks[track];
+            values[track * kValuesPerTrack + 1] = mDisplayMeanSquares[track];
+            values[track * kValuesPerTrack + 2] = mHolds[track];
+        }
+        return numTracks;
+    }
+
+    int32_t LevelMeters::read(float* values, int32_t numTracks) const {
+        numTracks = std::max(0, std::min(numTracks, kMaxTracks));
+
+        // Copy the front snapshot out, retrying if the audio thread started rewriting it
+        float levels[kMaxTracks * kValuesPerTrack];
+        int32_t numMeasured = 0;
+        for (int32_t attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+            const Snapshot& snapshot =
+                    mSnapshots[mPublishedIndex.load(std::memory_order_acquire)];
+            uint32_t sequence = snapshot.sequence.load(std::memory_order_acquire);
+            if (sequence & 1) {
+                continue;
+            }
+            int32_t snapshotTracks = std::min(snapshot.numTracks.load(std::memory_order_relaxed),
+                                              numTracks);
+            for (int32_t track = 0; track < snapshotTracks; track++) {
+                levels[track * kValuesPerTrack] =
+                        snapshot.peaks[track].load(std::memory_order_relaxed);
+                levels[track * kValuesPerTrack + 1] =
+                        snapshot.meanSquares[track].load(std::memory_order_relaxed);
+                levels[track * kValuesPerTrack + 2] =
+                        snapshot.holds[track].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (snapshot.sequence.load(std::memory_order_relaxed) == sequence) {
+                numMeasured = snapshotTracks;
+                break;
+            }
+        }
+
+        for (int32_t track = 0; track < numTracks; track++) {
+            const float* level = levels + track * kValuesPerTrack;
+            float* value = values + track * kValuesPerTrack;
+            value[0] = track < numMeasured ? toDecibels(level[0]) : kSilenceDecibels;
+            value[1] = track < numMeasured ? toDecibels(sqrtf(level[1])) : kSilenceDecibels;
+            value[2] = track < numMeasured ? toDecibels(level[2]) : kSilenceDecibels;
+        }
+        return numTracks;
+    }
+
+} // namespace iolib
@@ -0,0 +1,128 @@
+#ifndef _PLAYER_LEVELMETERS_H_
+#define _PLAYER_LEVELMETERS_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace iolib {
+
+/**
+ * Per-track peak, RMS and peak-hold meters.
+ *
+ * The audio thread only accumulates linear levels. Once per refresh period it applies the
+ * ballistics (peaks fall back at a fixed rate, RMS is integrated over kRmsIntegrationSeconds,
+ * the highest peak is held for a while), still in the linear domain, and publishes the result
+ * into the back half of a double-buffered snapshot, then flips it to the front. Each half is
+ * guarded by a sequence counter, so a reader that was overtaken retries instead of seeing a
+ * torn snapshot, and the audio thread never waits.
+ *
+ * read() only converts the latest snapshot to dBFS. Time is measured in audio frames, so the
+ * meters behave the same however often, and by however many readers, they are read.
+ */
+    class LevelMeters {
+    public:
+        static constexpr int32_t kMaxTracks = 128;
+
+        // read() writes peak, RMS, peak hold for each track
+        static constexpr int32_t kValuesPerTrack = 3;
+
+        // Reported for silence
+        static constexpr float kSilenceDecibels = -100.0f;
+
+        static constexpr float kDefaultRefreshHz = 10.0f;
+        static constexpr float kDefaultReleaseDecibelsPerSecond = 20.0f;
+        static constexpr float kDefaultHoldSeconds = 1.5f;
+        static constexpr float kRmsIntegrationSeconds = 0.3f;
+
+        LevelMeters();
+
+        /**
+         * Control thread.
+         */
+        void setSampleRate(int32_t sampleRate);
+
+        /**
+         * refreshHz: snapshots published per second. releaseDecibelsPerSecond: how fast peaks
+         * fall back. holdSeconds: how long the highest peak is held. Any thread.
+         */
+        void setBallistics(float refreshHz, float releaseDecibelsPerSecond, float holdSeconds);
+
+        /**
+         * Audio thread: adds the level of track in the current block, after its gain.
+         */
+        void addLevel(int32_t track, float peak, float meanSquare) {
+            if (track >= 0 && track < kMaxTracks) {
+                mPeaks[track] = peak > mPeaks[track] ? peak : mPeaks[track];
+                mEnergies[track] += meanSquare;
+                mNumTracks = track >= mNumTracks ? track + 1 : mNumTracks;
+            }
+        }
+
+        /**
+         * Audio thread: closes a block of numFrames frames, every block counts (silent or not).
+         * Publishes a snapshot when a refresh period is complete, and returns true if it did.
+         */
+        bool endBlock(int32_t numFrames);
+
+        /**
+         * Audio thread: the meters as last published, linear. Fills kValuesPerTrack values
+         * for each of the first numTracks measured tracks (peak, mean square, peak hold) and
+         * returns how many tracks that is.
+         */
+        int32_t copyLevels(float* values, int32_t numTracks) const;
+
+        /**
+         * Audio thread: audio frames measured so far, the time base of the meters.
+         */
+        int64_t getFramesMeasured() const { return mFramesMeasured; }
+
+        /**
+         * Fills values with kValuesPerTrack dBFS values for each of the first numTracks
+         * tracks: peak, RMS and peak hold. Returns the number of tracks filled, tracks not
+         * measured yet read as kSilenceDecibels. Any (non audio) thread.
+         */
+        int32_t read(float* values, int32_t numTracks) const;
+
+        // 20 * log10(amplitude), no lower than kSilenceDecibels
+        static float toDecibels(float amplitude);
+
+    private:
+        struct Snapshot {
+            std::atomic<uint32_t> sequence;     // odd while being written
+            std::atomic<int32_t> numTracks;
+            std::atomic<float> peaks[kMaxTracks];
+            std::atomic<float> meanSquares[kMaxTracks];
+            std::atomic<float> holds[kMaxTracks];
+        };
+
+        std::atomic<int32_t> mSampleRate;
+        std::atomic<int32_t> mRefreshFrames;
+
+        std::atomic<float> mReleaseDecibelsPerSecond;
+        std::atomic<float> mHoldSeconds;
+
+        // Audio thread only
+        float mPeaks[kMaxTracks];
+        float mEnergies[kMaxTracks];    // sum of the blocks' mean squares
+        int32_t mNumTracks;
+        int32_t mWindowFrames;
+        int32_t mNumBlocks;
+        int64_t mFramesMeasured;
+        int32_t mWriteIndex;
+
+        // The meters after ballistics, linear
+        float mDisplayPeaks[kMaxTracks];
+        float mDisplayMeanSquares[kMaxTracks];
+        float mHolds[kMaxTracks];
+        float mHoldAges[kMaxTracks];
+
+        Snapshot mSnapshots[2];
+        std::atomic<int32_t> mPublishedIndex;
+
+        void applyBallistics(float elapsedSeconds);
+        void publish();
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_LEVELMETERS_H_
@@ -0,0 +1,79 @@
+#ifndef _PLAYER_LOCKFREEQUEUE_H_
+#define _PLAYER_LOCKFREEQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace iolib {
+
+/**
+ * A wait-free, fixed capacity, single-producer/single-consumer FIFO.
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may call pop()/peek().
+ * Neither side ever blocks or allocates, so the consumer may be the audio callback.
+ * Capacity must be a power of two; one slot is NOT wasted, the indices run freely and
+ * are masked on access.
+ */
+    template <typename T, uint32_t Capacity>
+    class LockFreeQueue {
+    public:
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                      "LockFreeQueue capacity must be a power of two");
+
+        LockFreeQueue() : mWriteIndex(0), mReadIndex(0) {}
+
+        /**
+         * Producer side. Returns false (and drops nothing already queued) if the queue is full.
+         */
+        bool push(const T& item) {
+            uint32_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+            uint32_t readIndex = mReadIndex.load(std::memory_order_acquire);
+            if (writeIndex - readIndex >= Capacity) {
+                return false;
+            }
+            mBuffer[writeIndex & kMask] = item;
+            mWriteIndex.store(writeIndex + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Consumer side. Returns false if the queue is empty.
+         */
+        bool pop(T& item) {
+            uint32_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+            uint32_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+            if (readIndex == writeIndex) {
+                return false;
+            }
+            item = mBuffer[readIndex & kMask];
+            mReadIndex.store(readIndex + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Number of queued items. Exact only when called from the producer or consumer thread.
+         */
+        uint32_t size() const {
+            return mWriteIndex.load(std::memory_order_acquire)
+                   - mReadIndex.load(std::memory_order_acquire);
+        }
+
+        bool empty() const { return size() == 0; }
+
+        static constexpr uint32_t capacity() { return Capacity; }
+
+    private:
+        static constexpr uint32_t kMask = Capacity - 1;
+
+        // Keep the two indices on separate cache lines so producer and consumer don't
+        // false-share.
+        alignas(64) std::atomic<uint32_t> mWriteIndex;
+        alignas(64) std::atomic<uint32_t> mReadIndex;
+
+        T mBuffer[Capacity];
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_LOCKFREEQUEUE_H_
@@ -0,0 +1,18 @@
+#include "MixEngine.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+    void MixEngine::mix(SampleSource* const* sources, int32_t numSources,
+                        float* outBuff, int32_t numChannels,
+                        int64_t transportFrame, int32_t numFrames) {
+        // Every source reads from the same transport frame
+        for (int32_t index = 0; index < numSources; index++) {
+            SampleSource* source = sources[index];
+            if (source->isPlaying()) {
+                source->mixAudio(outBuff, numChannels, transportFrame, numFrames);
+            }
+        }
+    }
+
+} // namespace iolib
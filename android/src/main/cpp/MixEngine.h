@@ -0,0 +1,27 @@
+#ifndef _PLAYER_MIXENGINE_H_
+#define _PLAYER_MIXENGINE_H_
+
+#include <cstdint>
+
+namespace iolib {
+
+    class SampleSource;
+
+/**
+ * Mixes a set of sources at one position of the transport clock. Shared by the real-time
+ * callback and the OfflineRenderer, so that a rendered mixdown is sample-identical to playback.
+ */
+    class MixEngine {
+    public:
+        /**
+         * Adds numFrames frames of every playing source, starting at transportFrame, to outBuff
+         * (which the caller has cleared). Doesn't allocate or block.
+         */
+        static void mix(SampleSource* const* sources, int32_t numSources,
+                        float* outBuff, int32_t numChannels,
+                        int64_t transportFrame, int32_t numFrames);
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_MIXENGINE_H_
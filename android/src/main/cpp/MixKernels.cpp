@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MixKernels.h"
+
+namespace iolib {
+
+    static constexpr float kMinus3dB = 0.70710678f;
+
+    // Where a source channel ends up when folded to stereo
+    struct StereoFold {
+        float left;
+        float right;
+    };
+
+    static constexpr StereoFold kFront { 1.0f, 1.0f };         // mono
+    static constexpr StereoFold kLeft { 1.0f, 0.0f };
+    static constexpr StereoFold kRight { 0.0f, 1.0f };
+    static constexpr StereoFold kCenter { kMinus3dB, kMinus3dB };
+    static constexpr StereoFold kLfe { 0.0f, 0.0f };
+    static constexpr StereoFold kSurroundLeft { kMinus3dB, 0.0f };
+    static constexpr StereoFold kSurroundRight { 0.0f, kMinus3dB };
+    static constexpr StereoFold kBackCenter { 0.5f, 0.5f };
+
+    // Default WAV channel order for each channel count (the file's channel mask isn't parsed)
+    static const StereoFold kStereoFolds[kMaxMixChannels + 1][kMaxMixChannels] = {
+            {},
+            { kFront },
+            { kLeft, kRight },
+            // L R C
+            { kLeft, kRight, kCenter },
+            // L R BL BR (quad)
+            { kLeft, kRight, kSurroundLeft, kSurroundRight },
+            // L R C BL BR (5.0)
+            { kLeft, kRight, kCenter, kSurroundLeft, kSurroundRight },
+            // L R C LFE BL BR (5.1)
+            { kLeft, kRight, kCenter, kLfe, kSurroundLeft, kSurroundRight },
+            // L R C LFE BC SL SR (6.1)
+            { kLeft, kRight, kCenter, kLfe, kBackCenter, kSurroundLeft, kSurroundRight },
+            // L R C LFE BL BR SL SR (7.1)
+            { kLeft, kRight, kCenter, kLfe, kSurroundLeft, kSurroundRight,
+              kSurroundLeft, kSurroundRight },
+    };
+
+    // Peak and energy of a run of samples. Independent lanes, rather than a single running
+    // maximum and sum, let the loop vectorize without reassociating floating point reductions.
+    static MixLevel measureLevel(const float* __restrict samples, int32_t numSamples) {
+        constexpr int32_t kLanes = 8;
+        float peaks[kLanes] = {};
+        float sums[kLanes] = {};
+        int32_t index = 0;
+        for (; index + kLanes <= numSamples; index += kLanes) {
+            for (int32_t lane = 0; lane < kLanes; lane++) {
+                float sample = samples[index + lane];
+                peaks[lane] = std::max(peaks[lane], std::fabs(sample));
+                sums[lane] += sample * sample;
+            }
+        }
+        MixLevel level { 0.0f, 0.0f };
+        for (; index < numSamples; index++) {
+            level.peak = std::max(level.peak, std::fabs(samples[index]));
+            level.sumOfSquares += samples[index] * samples[index];
+        }
+        for (int32_t lane = 0; lane < kLanes; lane++) {
+            level.peak = std::max(level.peak, peaks[lane]);
+            level.sumOfSquares += sums[lane];
+        }
+        return level;
+    }
+
+    template<int32_t SrcChannels, int32_t DstChannels>
+    static MixLevel mixFrames(const float* __restrict src, int32_t /*srcChannels*/,
+                              float* __restrict dst, int32_t /*dstChannels*/,
+                              int32_t numFrames, const MixMatrix& matrix) {
+        // Local copy of the gains, so the compiler can keep them in registers
+        float gains[DstChannels][SrcChannels];
+        for (int32_t out = 0; out < DstChannels; out++) {
+            for (int32_t in = 0; in < SrcChannels; in++) {
+                gains[out][in] = matrix.gains[out][in];
+            }
+        }
+
+        for (int32_t frame = 0; frame < numFrames; frame++) {
+            const float* input = src + frame * SrcChannels;
+            float* output = dst + frame * DstChannels;
+            for (int32_t out = 0; out < DstChannels; out++) {
+                float sum = gains[out][0] * input[0];
+                for (int32_t in = 1; in < SrcChannels; in++) {
+                    sum += gains[out][in] * input[in];
+                }
+                output[out] += sum;
+            }
+        }
+
+        return measureLevel(src, numFrames * SrcChannels);
+    }
+
+    // Same channel count in and out, each channel scaled by its own gain (stereo is the
+    // common case). Treated as one long run of samples, which vectorizes best.
+    template<int32_t Channels>
+    static MixLevel mixDiagonal(const float* __restrict src, int32_t /*srcChannels*/,
+                                float* __restrict dst, int32_t /*dstChannels*/,
+                                int32_t numFrames, const MixMatrix& matrix) {
+        float gains[Channels];
+        for (int32_t channel = 0; channel < Channels; channel++) {
+            gains[channel] = matrix.gains[channel][channel];
+        }
+
+        for (int32_t frame = 0; frame < numFrames; frame++) {
+            for (int32_t channel = 0; channel < Channels; channel++) {
+                int32_t index = frame * Channels + channel;
+                dst[index] += gains[channel] * src[index];
+            }
+        }
+
+        return measureLevel(src, numFrames * Channels);
+    }
+
+    static MixLevel mixGeneric(const float* __restrict src, int32_t srcChannels,
+                               float* __restrict dst, int32_t dstChannels,
+                               int32_t numFrames, const MixMatrix& matrix) {
+        int32_t numIn = std::min(srcChannels, kMaxMixChannels);
+        int32_t numOut = std::min(dstChannels, kMaxMixChannels);
+        for (int32_t frame = 0; frame < numFrames; frame++) {
+            const float* input = src + frame * srcChannels;
+            float* output = dst + frame * dstChannels;
+            for (int32_t out = 0; out < numOut; out++) {
+                float sum = 0.0f;
+                for (int32_t in = 0; in < numIn; in++) {
+                    sum += matrix.gains[out][in] * input[in];
+                }
+                output[out] += sum;
+            }
+        }
+
+        return measureLevel(src, numFrames * srcChannels);
+    }
+
+    // [source channels - 1][output channels - 1]
+    static const MixKernel kKernels[kMaxMixChannels][2] = {
+            { mixDiagonal<1>, mixFrames<1, 2> },
+            { mixFrames<2, 1>, mixDiagonal<2> },
+            { mixFrames<3, 1>, mixFrames<3, 2> },
+            { mixFrames<4, 1>, mixFrames<4, 2> },
+            { mixFrames<5, 1>, mixFrames<5, 2> },
+            { mixFrames<6, 1>, mixFrames<6, 2> },
+            { mixFrames<7, 1>, mixFrames<7, 2> },
+            { mixFrames<8, 1>, mixFrames<8, 2> },
+    };
+
+    // One-to-one multichannel, [channels - 3]: buildMatrix() only sets the diagonal
+    static const MixKernel kDiagonalKernels[kMaxMixChannels - 2] = {
+            mixDiagonal<3>, mixDiagonal<4>, mixDiagonal<5>, mixDiagonal<6>, mixDiagonal<7>,
+            mixDiagonal<8>,
+    };
+
+    MixKernel MixKernels::select(int32_t srcChannels, int32_t dstChannels) {
+        if (srcChannels >= 1 && srcChannels <= kMaxMixChannels
+            && dstChannels >= 1 && dstChannels <= 2) {
+            return kKernels[srcChannels - 1][dstChannels - 1];
+        }
+        if (srcChannels == dstChannels && dstChannels > 2 && dstChannels <= kMaxMixChannels) {
+            return kDiagonalKernels[dstChannels - 3];
+        }
+        return mixGeneric;
+    }
+
+    void MixKernels::buildMatrix(int32_t srcChannels, int32_t dstChannels,
+                                 float leftGain, float rightGain, MixMatrix* matrix) {
+        memset(matrix, 0, sizeof(MixMatrix));
+        int32_t numIn = std::min(srcChannels, kMaxMixChannels);
+        int32_t numOut = std::min(dstChannels, kMaxMixChannels);
+        if (numIn <= 0 || numOut <= 0) {
+            return;
+        }
+
+        if (numOut > 2 && numIn == numOut) {
+            for (int32_t channel = 0; channel < numOut; channel++) {
+                matrix->gains[channel][channel] = leftGain + rightGain;
+            }
+            return;
+        }
+
+        const StereoFold* folds = kStereoFolds[numIn];
+        for (int32_t in = 0; in < numIn; in++) {
+            float left = folds[in].left * leftGain;
+            float right = folds[in].right * rightGain;
+            if (numOut == 1) {
+                matrix->gains[0][in] = left + right;
+            } else {
+                matrix->gains[0][in] = left;
+                matrix->gains[1][in] = right;
+            }
+        }
+    }
+
+} // namespace iolib
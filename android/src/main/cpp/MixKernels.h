@@ -0,0 +1,69 @@
+#ifndef _PLAYER_MIXKERNELS_H_
+#define _PLAYER_MIXKERNELS_H_
+
+#include <cstdint>
+
+namespace iolib {
+
+    // Largest source/output channel count a MixMatrix routes, extra channels are dropped
+    static constexpr int32_t kMaxMixChannels = 8;
+
+    /**
+     * Gain from every source channel to every output channel:
+     * out[o] += sum(gains[o][s] * in[s])
+     */
+    struct MixMatrix {
+        float gains[kMaxMixChannels][kMaxMixChannels];
+    };
+
+    /**
+     * Level of the source samples a kernel mixed, for metering.
+     */
+    struct MixLevel {
+        float peak;             // largest absolute sample
+        float sumOfSquares;
+    };
+
+    /**
+     * Adds numFrames interleaved frames of src, routed through matrix, to dst. Returns the
+     * level of src. Doesn't allocate or block.
+     */
+    typedef MixLevel (*MixKernel)(const float* src, int32_t srcChannels,
+                                  float* dst, int32_t dstChannels,
+                                  int32_t numFrames, const MixMatrix& matrix);
+
+/**
+ * Mix kernels specialized at compile time on the source and output channel counts, so the
+ * per-frame channel loops unroll and vectorize. Select one per track with select() when its
+ * layout is known, not per callback.
+ *
+ * Sources with more than two channels are folded to stereo with a downmix matrix, assuming the
+ * usual WAV channel order for their channel count (see buildMatrix()).
+ */
+    class MixKernels {
+    public:
+        /**
+         * The kernel for srcChannels -> dstChannels, for a matrix from buildMatrix(): as many
+         * output as source channels beyond stereo only applies the diagonal. Other layouts
+         * without a specialization (more than kMaxMixChannels source channels, or more than two
+         * output channels) get a generic kernel. Never returns null.
+         */
+        static MixKernel select(int32_t srcChannels, int32_t dstChannels);
+
+        /**
+         * Routing for a source panned into the output:
+         * - up to stereo output, the source is folded to stereo (mono goes to both sides,
+         *   centre and surround channels are mixed into the front pair at -3dB, LFE is dropped)
+         *   and its left and right sides are scaled by leftGain and rightGain. Mono output
+         *   sums the two sides.
+         * - with as many output as source channels (beyond stereo), channels map one-to-one at
+         *   (leftGain + rightGain).
+         * - other multichannel outputs get the stereo routing on their first two channels.
+         */
+        static void buildMatrix(int32_t srcChannels, int32_t dstChannels,
+                                float leftGain, float rightGain, MixMatrix* matrix);
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_MIXKERNELS_H_
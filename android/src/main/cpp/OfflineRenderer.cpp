@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "wav/WavStreamWriter.h"
+
+#include "DiskStreamer.h"
+#include "OfflineRenderer.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+    OfflineRenderer::OfflineRenderer(int32_t channelCount, int32_t sampleRate,
+                                     int32_t blockFrames)
+            : mChannelCount(channelCount),
+              mSampleRate(sampleRate),
+              mBlockFrames(std::max(1, blockFrames)),
+              mResamplerQuality(ResamplerQuality::Medium),
+              mTotalFrames(0),
+              mStreamBufferFrames(std::max(DiskStreamer::kDefaultBufferFrames, 2 * mBlockFrames)),
+              mMixBuffer(new float[mBlockFrames * channelCount]),
+              mLastProgress { 0, 0, 0.0 },
+              mCancelled(false) {
+    }
+
+    void OfflineRenderer::addSampleSource(SampleSource* source) {
+        source->setOutputSampleRate(mSampleRate, mResamplerQuality);
+        source->prepareToPlay(mBlockFrames, mChannelCount);
+        if (source->isStreaming()) {
+            source->allocateStreamBuffer(mStreamBufferFrames);
+        }
+
+        mSampleSources.push_back(source);
+        mTotalFrames = std::max<int64_t>(mTotalFrames, source->getNumFrames());
+    }
+
+    void OfflineRenderer::setBusRouting(const MixSchedule& schedule,
+                                        const BusParameters* parameters) {
+        mSchedule = schedule;
+        mBusMixer.prepare(mBlockFrames, mChannelCount);
+        mBusMixer.setSchedule(&mSchedule);
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            mBusMixer.setBusParameters(bus, parameters[bus]);
+        }
+    }
+
+    bool OfflineRenderer::render(parselib::WavStreamWriter* writer) {
+        mCancelled.store(false, std::memory_order_relaxed);
+        mLastProgress = { 0, mTotalFrames, 0.0 };
+
+        if (!writer->writeHeader()) {
+            return false;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        int32_t numSources = static_cast<int32_t>(mSampleSources.size());
+        int64_t transportFrame = 0;
+        bool ok = true;
+        while (transportFrame < mTotalFrames) {
+            if (mCancelled.load(std::memory_order_relaxed)) {
+                ok = false;
+                break;
+            }
+
+            int32_t numFrames = static_cast<int32_t>(
+                    std::min<int64_t>(mBlockFrames, mTotalFrames - transportFrame));
+
+            // Stand-in for the DiskStreamer: make sure the whole block is decoded up front
+            for (SampleSource* source : mSampleSources) {
+                source->serviceStream(numFrames, mStreamBufferFrames);
+            }
+
+            memset(mMixBuffer.get(), 0, numFrames * mChannelCount * sizeof(float));
+            mBusMixer.mix(mSampleSources.data(), numSources, mMixBuffer.get(), mChannelCount,
+                          transportFrame, numFrames, nullptr, mSampleRate);
+
+            if (writer->write(mMixBuffer.get(), numFrames) != numFrames) {
+                ok = false;
+                break;
+            }
+            transportFrame += numFrames;
+
+            double elapsedSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - startTime).count();
+            mLastProgress.framesRendered = transportFrame;
+            mLastProgress.realtimeMultiple = elapsedSeconds > 0.0
+                    ? (transportFrame / (double) mSampleRate) / elapsedSeconds
+                    : 0.0;
+            if (mProgressCallback) {
+                mProgressCallback(mLastProgress);
+            }
+        }
+
+        // Leave a valid (if truncated) file behind even if we stopped early
+        return writer->finish() && ok;
+    }
+
+} // namespace iolib
@@ -0,0 +1,102 @@
+#ifndef _PLAYER_OFFLINERENDERER_H_
+#define _PLAYER_OFFLINERENDERER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "BusMixer.h"
+#include "Resampler.h"
+
+namespace parselib {
+    class WavStreamWriter;
+}
+
+namespace iolib {
+
+    class SampleSource;
+
+/**
+ * Renders a mix to a WAV file faster than real time, with no audio device.
+ *
+ * The sources go through a BusMixer exactly as in the audio callback, only in large blocks, and
+ * streaming sources are decoded synchronously between blocks instead of by the DiskStreamer.
+ * The sources are owned by the caller and must not be used by a player at the same time.
+ */
+    class OfflineRenderer {
+    public:
+        static constexpr int32_t kDefaultBlockFrames = 4096;
+
+        struct Progress {
+            int64_t framesRendered;
+            int64_t totalFrames;
+            double  realtimeMultiple;   // seconds of audio rendered per second of wall time
+        };
+
+        // Called on the rendering thread after every block
+        typedef std::function<void(const Progress&)> ProgressCallback;
+
+        OfflineRenderer(int32_t channelCount, int32_t sampleRate,
+                        int32_t blockFrames = kDefaultBlockFrames);
+
+        void setResamplerQuality(ResamplerQuality quality) { mResamplerQuality = quality; }
+        void setProgressCallback(ProgressCallback callback) { mProgressCallback = callback; }
+
+        /**
+         * Converts the source to the render rate and adds it to the mix. Its play mode, gain
+         * and pan are used as they are when render() runs.
+         */
+        void addSampleSource(SampleSource* source);
+
+        /**
+         * Routes the sources through submix buses, as the player does. Track numbers in the
+         * schedule are in the order the sources were added. Without it every source goes
+         * straight to the output.
+         */
+        void setBusRouting(const MixSchedule& schedule, const BusParameters* parameters);
+
+        /**
+         * Length of the longest source, in frames.
+         */
+        int64_t getTotalFrames() { return mTotalFrames; }
+
+        /**
+         * Writes the header, all getTotalFrames() frames of the mix, and finishes the file.
+         * Returns false if writing failed or the render was cancelled.
+         */
+        bool render(parselib::WavStreamWriter* writer);
+
+        /**
+         * Stops a render() in progress after the current block. May be called from any thread.
+         */
+        void cancel() { mCancelled.store(true, std::memory_order_relaxed); }
+
+        const Progress& getLastProgress() { return mLastProgress; }
+
+    private:
+        int32_t mChannelCount;
+        int32_t mSampleRate;
+        int32_t mBlockFrames;
+        ResamplerQuality mResamplerQuality;
+
+        std::vector<SampleSource*> mSampleSources;
+        int64_t mTotalFrames;
+
+        // Each streaming source holds up to this many decoded frames between blocks
+        int32_t mStreamBufferFrames;
+
+        std::unique_ptr<float[]> mMixBuffer;
+
+        MixSchedule mSchedule;
+        BusMixer mBusMixer;
+
+        ProgressCallback mProgressCallback;
+        Progress mLastProgress;
+        std::atomic<bool> mCancelled;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_OFFLINERENDERER_H_
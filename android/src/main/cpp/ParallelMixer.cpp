@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "MixEngine.h"
+#include "ParallelMixer.h"
+#include "RealtimeAllocationCheck.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+    // Polls of a new job before a worker goes to sleep, roughly 20-50us
+    static constexpr int32_t kSpinCount = 2000;
+
+    // Same as Android's THREAD_PRIORITY_URGENT_AUDIO
+    static constexpr int kUrgentAudioNice = -19;
+
+    static inline int64_t nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static inline void cpuRelax() {
+#if defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#elif defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    static void futexWait(std::atomic<uint32_t>* word, uint32_t expected) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected,
+                nullptr, nullptr, 0);
+#else
+        (void) word;
+        (void) expected;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+    }
+
+    static void futexWakeAll(std::atomic<uint32_t>* word) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+#else
+        (void) word;
+#endif
+    }
+
+    static inline uint64_t makeClaim(uint32_t generation, int32_t numSources, int32_t index) {
+        return (static_cast<uint64_t>(generation) << 32)
+               | (static_cast<uint64_t>(numSources) << 16) | static_cast<uint64_t>(index);
+    }
+
+    ParallelMixer::ParallelMixer()
+            : mAccumulatorSamples(0),
+              mNumChannels(0),
+              mJobSources(nullptr),
+              mJobNumSources(0),
+              mJobNumChannels(0),
+              mJobTransportFrame(0),
+              mJobNumFrames(0),
+              mJobDeadlineNanos(0),
+              mClaim(0),
+              mGeneration(0),
+              mNumBusy(0),
+              mNumSleeping(0),
+              mAbandonedGeneration(0),
+              mRunning(false),
+              mEnabled(true),
+              mMinSources(kDefaultMinSources),
+              mMinLoad(kDefaultMinLoad),
+              mLoad(0.0f),
+              mLoadTriggered(false),
+              mFallbackBlocksLeft(0),
+              mNumParallelBlocks(0),
+              mNumDeadlineMisses(0),
+              mNumAbandonedBlocks(0) {
+    }
+
+    ParallelMixer::~ParallelMixer() {
+        stop();
+    }
+
+    void ParallelMixer::start(int32_t numWorkers) {
+        if (!mWorkers.empty()) {
+            return;
+        }
+        if (numWorkers <= 0) {
+            numWorkers = static_cast<int32_t>(std::thread::hardware_concurrency()) - 1;
+        }
+        numWorkers = std::min(numWorkers, kMaxWorkers);
+
+        mRunning.store(true);
+        for (int32_t index = 0; index < numWorkers; index++) {
+            mWorkers.push_back(std::make_unique<Worker>());
+            if (mAccumulatorSamples > 0) {
+                mWorkers.back()->accumulator.reset(new float[mAccumulatorSamples]);
+            }
+        }
+        for (auto& worker : mWorkers) {
+            worker->thread = std::thread(&ParallelMixer::workerLoop, this, worker.get());
+        }
+    }
+
+    void ParallelMixer::stop() {
+        if (mWorkers.empty()) {
+            return;
+        }
+        mRunning.store(false);
+        mGeneration.fetch_add(1);
+        futexWakeAll(&mGeneration);
+        for (auto& worker : mWorkers) {
+            worker->thread.join();
+        }
+        mWorkers.clear();
+    }
+
+    void ParallelMixer::prepare(int32_t maxFrames, int32_t numChannels) {
+        int32_t numSamples = maxFrames * numChannels;
+        if (numSamples > mAccumulatorSamples) {
+            for (auto& worker : mWorkers) {
+                worker->accumulator.reset(new float[numSamples]);
+            }
+            mAccumulatorSamples = numSamples;
+        }
+        mNumChannels = numChannels;
+    }
+
+    void ParallelMixer::mix(SampleSource* const* sources, int32_t numSources,
+                            float* outBuff, int32_t numChannels,
+                            int64_t transportFrame, int32_t numFrames, int32_t sampleRate) {
+        int32_t numPlaying = 0;
+        for (int32_t index = 0; index < numSources; index++) {
+            numPlaying += sources[index]->isPlaying() ? 1 : 0;
+        }
+
+        int64_t startNanos = nowNanos();
+        int64_t periodNanos = sampleRate > 0 ? static_cast<int64_t>(numFrames) * 1000000000 / sampleRate : 0;
+        if (mNumBusy.load() != 0) {
+            // Workers left behind by an abandoned block, or just waking up to a finished one
+            mixAroundInFlight(sources, numSources, outBuff, numChannels, transportFrame,
+                              numFrames);
+        } else if (shouldMixInParallel(numPlaying, numChannels, numFrames)) {
+            int64_t deadlineNanos = INT64_MAX;
+            int64_t abandonNanos = INT64_MAX;
+            if (periodNanos > 0) {
+                deadlineNanos = startNanos + static_cast<int64_t>(periodNanos * kDeadlineFraction);
+                abandonNanos = startNanos + static_cast<int64_t>(periodNanos * kAbandonFraction);
+            }
+            mixInParallel(sources, numSources, outBuff, numChannels, transportFrame, numFrames,
+                          deadlineNanos, abandonNanos);
+        } else {
+            MixEngine::mix(sources, numSources, outBuff, numChannels, transportFrame, numFrames);
+        }
+
+        if (periodNanos > 0) {
+            float load = (nowNanos() - startNanos) / (float) periodNanos;
+            mLoad += 0.1f * (load - mLoad);
+        }
+    }
+
+    bool ParallelMixer::shouldMixInParallel(int32_t numPlaying, int32_t numChannels,
+                                            int32_t numFrames) {
+        if (!mEnabled.load(std::memory_order_relaxed) || mWorkers.empty() || numPlaying < 2
+                || numChannels != mNumChannels || numFrames * numChannels > mAccumulatorSamples) {
+            return false;
+        }
+        if (mFallbackBlocksLeft > 0) {
+            mFallbackBlocksLeft--;
+            return false;
+        }
+        if (numPlaying >= mMinSources.load(std::memory_order_relaxed)) {
+            return true;
+        }
+
+        // Mixing in parallel lowers the measured load, so only let go well below the threshold
+        float minLoad = mMinLoad.load(std::memory_order_relaxed);
+        mLoadTriggered = mLoad >= (mLoadTriggered ? minLoad * 0.5f : minLoad);
+        return mLoadTriggered;
+    }
+
+    void ParallelMixer::mixInParallel(SampleSource* const* sources, int32_t numSources,
+                                      float* outBuff, int32_t numChannels,
+                                      int64_t transportFrame, int32_t numFrames,
+                                      int64_t deadlineNanos, int64_t abandonNanos) {
+        uint32_t generation = mGeneration.load(std::memory_order_relaxed) + 1;
+        mJobSources = sources;
+        mJobNumSources = numSources;
+        mJobNumChannels = numChannels;
+        mJobTransportFrame = transportFrame;
+        mJobNumFrames = numFrames;
+        mJobDeadlineNanos = deadlineNanos;
+        mClaim.store(makeClaim(generation, numSources, 0));
+        mGeneration.store(generation);
+        if (mNumSleeping.load() > 0) {
+            futexWakeAll(&mGeneration);
+        }
+
+        // Take our share straight into the output. If the workers are slow to wake up, or
+        // stop at the deadline, we simply end up doing the rest.
+        mixClaimed(generation, outBuff, false, nullptr);
+
+        // Every source is claimed now, wait for the ones still being mixed
+        bool missedDeadline = false;
+        bool abandoned = false;
+        while (mNumBusy.load() != 0) {
+            int64_t now = nowNanos();
+            missedDeadline = missedDeadline || now > deadlineNanos;
+            if (now > abandonNanos) {
+                // Workers check this after marking a source in flight: they either back off
+                // from it or are seen mixing it
+                mAbandonedGeneration.store(generation);
+                abandoned = true;
+                break;
+            }
+            cpuRelax();
+        }
+
+        int32_t numSamples = numFrames * numChannels;
+        for (auto& worker : mWorkers) {
+            if (worker->contributedGeneration.load(std::memory_order_acquire) == generation) {
+                const float* accumulator = worker->accumulator.get();
+                for (int32_t index = 0; index < numSamples; index++) {
+                    outBuff[index] += accumulator[index];
+                }
+            }
+        }
+
+        mNumParallelBlocks.fetch_add(1, std::memory_order_relaxed);
+        if (abandoned) {
+            mNumAbandonedBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (missedDeadline || abandoned) {
+            mNumDeadlineMisses.fetch_add(1, std::memory_order_relaxed);
+            mFallbackBlocksLeft = kFallbackBlocks;
+        }
+    }
+
+    void ParallelMixer::mixAroundInFlight(SampleSource* const* sources, int32_t numSources,
+                                          float* outBuff, int32_t numChannels,
+                                          int64_t transportFrame, int32_t numFrames) {
+        // As MixEngine::mix(), less the sources the workers still have
+        for (int32_t index = 0; index < numSources; index++) {
+            SampleSource* source = sources[index];
+            if (source->isPlaying() && !isInFlight(source)) {
+                source->mixAudio(outBuff, numChannels, transportFrame, numFrames);
+            }
+        }
+    }
+
+    bool ParallelMixer::isInFlight(const SampleSource* source) {
+        for (auto& worker : mWorkers) {
+            if (worker->inFlight.load() == source) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int32_t ParallelMixer::mixClaimed(uint32_t generation, float* outBuff, bool clearFirst,
+                                      Worker* worker) {
+        int32_t numMixed = 0;
+        uint64_t claim = mClaim.load();
+        while (true) {
+            int32_t index = static_cast<int32_t>(claim & 0xffff);
+            int32_t numSources = static_cast<int32_t>((claim >> 16) & 0xffff);
+            if (static_cast<uint32_t>(claim >> 32) != generation || index >= numSources) {
+                return numMixed;
+            }
+            if (worker != nullptr && nowNanos() > mJobDeadlineNanos) {
+                return numMixed; // the audio thread mixes the rest
+            }
+            if (!mClaim.compare_exchange_weak(claim, claim + 1)) {
+                continue; // claim now holds the current value
+            }
+
+            SampleSource* source = mJobSources[index];
+            if (source->isPlaying()) {
+                if (worker != nullptr) {
+                    worker->inFlight.store(source);
+                    if (mAbandonedGeneration.load() == generation) {
+                        worker->inFlight.store(nullptr);
+                        return numMixed;
+                    }
+                }
+                if (numMixed == 0 && clearFirst) {
+                    memset(outBuff, 0, mJobNumFrames * mJobNumChannels * sizeof(float));
+                }
+                source->mixAudio(outBuff, mJobNumChannels, mJobTransportFrame, mJobNumFrames);
+                numMixed++;
+                if (worker != nullptr) {
+                    worker->inFlight.store(nullptr);
+                }
+            }
+            claim = mClaim.load();
+        }
+    }
+
+    void ParallelMixer::workerLoop(Worker* worker) {
+        // Best effort: the audio thread's own class if we're allowed, else urgent audio nice
+        sched_param param;
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+            setpriority(PRIO_PROCESS, 0, kUrgentAudioNice);
+        }
+
+        uint32_t seenGeneration = mGeneration.load();
+        while (true) {
+            int32_t numSpins = 0;
+            uint32_t generation;
+            while ((generation = mGeneration.load()) == seenGeneration) {
+                if (++numSpins < kSpinCount) {
+                    cpuRelax();
+                    continue;
+                }
+                // Announce ourselves before re-checking, so a job published in between
+                // either is seen here or wakes us
+                mNumSleeping.fetch_add(1);
+                if (mGeneration.load() == seenGeneration) {
+                    futexWait(&mGeneration, seenGeneration);
+                }
+                mNumSleeping.fetch_sub(1);
+                numSpins = 0;
+            }
+            seenGeneration = generation;
+            if (!mRunning.load()) {
+                return;
+            }
+
+            mNumBusy.fetch_add(1);
+            {
+                ScopedRealtimeSection realtimeSection;
+                if (mixClaimed(generation, worker->accumulator.get(), true, worker) > 0) {
+                    worker->contributedGeneration.store(generation, std::memory_order_release);
+                }
+            }
+            mNumBusy.fetch_sub(1);
+        }
+    }
+
+} // namespace iolib
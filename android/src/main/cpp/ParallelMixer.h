@@ -0,0 +1,152 @@
+#ifndef _PLAYER_PARALLELMIXER_H_
+#define _PLAYER_PARALLELMIXER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace iolib {
+
+    class SampleSource;
+
+/**
+ * Spreads the mix of a large number of sources across a few pre-spawned worker threads.
+ *
+ * The audio thread publishes each block as a job; it and the workers then claim sources one at
+ * a time from a shared counter. Workers sum into private accumulators which the audio thread
+ * adds to the output once they are done. Nothing locks or allocates: idle workers spin briefly
+ * and then sleep on a futex, and the audio thread only makes a (non-blocking) wake call if one
+ * of them is asleep.
+ *
+ * Only blocks with enough sources (or a high enough measured mix load) are mixed in parallel,
+ * everything else goes straight to MixEngine.
+ *
+ * Workers stop claiming sources at the deadline, the audio thread mixes the rest itself, and
+ * the mixer stays serial for a while. A worker may still be in the middle of a source then
+ * (preempted, say): the audio thread waits for it until the abandon time at most, then leaves
+ * the workers' unfinished share out of the block. A source a worker is still mixing is left
+ * out of the following blocks too, until the worker is done with it.
+ */
+    class ParallelMixer {
+    public:
+        static constexpr int32_t kMaxWorkers = 4;
+        static constexpr int32_t kDefaultMinSources = 16;
+        static constexpr float kDefaultMinLoad = 0.5f;
+
+        // Share of the block period after which workers stop claiming sources
+        static constexpr float kDeadlineFraction = 0.5f;
+        // Share of the block period after which the audio thread stops waiting for workers
+        static constexpr float kAbandonFraction = 0.8f;
+        // Serial blocks after a missed deadline
+        static constexpr int32_t kFallbackBlocks = 500;
+
+        ParallelMixer();
+        ~ParallelMixer();
+
+        /**
+         * Spawns the workers, numWorkers 0 leaves one core to the audio thread. Control thread
+         * only, while mix() isn't running.
+         */
+        void start(int32_t numWorkers = 0);
+        void stop();
+
+        /**
+         * Allocates the worker accumulators. Control thread only, while mix() isn't running.
+         */
+        void prepare(int32_t maxFrames, int32_t numChannels);
+
+        /**
+         * Parallel mixing kicks in for blocks with at least minSources playing sources, or at
+         * least 2 when the mix took over minLoad of the block period. Any thread.
+         */
+        void setEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+        void setThresholds(int32_t minSources, float minLoad) {
+            mMinSources.store(minSources, std::memory_order_relaxed);
+            mMinLoad.store(minLoad, std::memory_order_relaxed);
+        }
+
+        int32_t getNumWorkers() { return static_cast<int32_t>(mWorkers.size()); }
+        uint32_t getNumParallelBlocks() { return mNumParallelBlocks.load(std::memory_order_relaxed); }
+        uint32_t getNumDeadlineMisses() { return mNumDeadlineMisses.load(std::memory_order_relaxed); }
+        uint32_t getNumAbandonedBlocks() { return mNumAbandonedBlocks.load(std::memory_order_relaxed); }
+
+        /**
+         * Same contract as MixEngine::mix(). Audio thread only.
+         */
+        void mix(SampleSource* const* sources, int32_t numSources,
+                 float* outBuff, int32_t numChannels,
+                 int64_t transportFrame, int32_t numFrames, int32_t sampleRate);
+
+    private:
+        struct Worker {
+            std::thread thread;
+            std::unique_ptr<float[]> accumulator;
+            // Generation of the last job this worker mixed something for
+            std::atomic<uint32_t> contributedGeneration { 0 };
+            // The source being mixed, if any
+            std::atomic<SampleSource*> inFlight { nullptr };
+        };
+
+        bool shouldMixInParallel(int32_t numPlaying, int32_t numChannels, int32_t numFrames);
+        void mixInParallel(SampleSource* const* sources, int32_t numSources,
+                           float* outBuff, int32_t numChannels,
+                           int64_t transportFrame, int32_t numFrames, int64_t deadlineNanos,
+                           int64_t abandonNanos);
+        void mixAroundInFlight(SampleSource* const* sources, int32_t numSources,
+                               float* outBuff, int32_t numChannels,
+                               int64_t transportFrame, int32_t numFrames);
+        bool isInFlight(const SampleSource* source);
+
+        /**
+         * Claims and mixes sources of job generation into outBuff until none are left, or, for
+         * a worker, until the job's deadline.
+         * clearFirst: zero outBuff before the first source is mixed.
+         * worker: nullptr on the audio thread.
+         * Returns the number of sources mixed.
+         */
+        int32_t mixClaimed(uint32_t generation, float* outBuff, bool clearFirst, Worker* worker);
+
+        void workerLoop(Worker* worker);
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        int32_t mAccumulatorSamples;
+        int32_t mNumChannels;
+
+        // The current job, written by the audio thread before it publishes the claim word
+        SampleSource* const* mJobSources;
+        int32_t mJobNumSources;
+        int32_t mJobNumChannels;
+        int64_t mJobTransportFrame;
+        int32_t mJobNumFrames;
+        int64_t mJobDeadlineNanos;
+
+        // Generation in the upper 32 bits, index of the next source to claim in the lower 32
+        alignas(64) std::atomic<uint64_t> mClaim;
+        // Bumped for every job (and to stop), workers sleep on it
+        alignas(64) std::atomic<uint32_t> mGeneration;
+        // Workers between looking at a job and being done with it
+        alignas(64) std::atomic<int32_t> mNumBusy;
+        alignas(64) std::atomic<int32_t> mNumSleeping;
+        // The last job the audio thread stopped waiting for
+        std::atomic<uint32_t> mAbandonedGeneration;
+        std::atomic<bool> mRunning;
+
+        std::atomic<bool> mEnabled;
+        std::atomic<int32_t> mMinSources;
+        std::atomic<float> mMinLoad;
+
+        // Audio thread only
+        float mLoad;            // smoothed share of the block period spent mixing
+        bool mLoadTriggered;    // parallel because of load, kept on until it drops well below
+        int32_t mFallbackBlocksLeft;
+
+        std::atomic<uint32_t> mNumParallelBlocks;
+        std::atomic<uint32_t> mNumDeadlineMisses;
+        std::atomic<uint32_t> mNumAbandonedBlocks;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_PARALLELMIXER_H_
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PeakPyramid.h"
+#include "stream/FileOutputStream.h"
+
+namespace iolib {
+
+    static constexpr uint32_t kSidecarMagic = 0x59504b50; // "PKPY"
+    static constexpr uint32_t kSidecarVersion = 1;
+
+    static constexpr float kFullScale = 32767.0f;
+
+    // Block size of the first decode when building
+    static constexpr int32_t kBuildChunkFrames = 16 * PeakPyramid::kBaseBlockFrames;
+
+    struct SidecarHeader {
+        uint32_t magic;
+        uint32_t version;
+        int64_t fileSize;
+        int64_t fileModifiedNanos;
+        int64_t numFrames;
+        int32_t numChannels;
+        int32_t sampleRate;
+        int32_t baseBlockFrames;
+        int32_t numLevels;
+    };
+
+    static inline int16_t quantize(float value, float (*roundFunction)(float)) {
+        float scaled = roundFunction(value * kFullScale);
+        return static_cast<int16_t>(std::min(kFullScale, std::max(-kFullScale, scaled)));
+    }
+
+    PeakPyramid::PeakPyramid(int32_t numChannels, int32_t sampleRate, int64_t numFrames)
+            : mNumChannels(numChannels),
+              mSampleRate(sampleRate),
+              mNumFrames(numFrames),
+              mData(nullptr),
+              mMapping(nullptr),
+              mMappingSize(0) {
+        // Level sizes follow from the length alone, so they are not stored in the sidecar
+        int64_t numEntries = std::max<int64_t>(1, (numFrames + kBaseBlockFrames - 1) / kBaseBlockFrames);
+        int64_t offset = 0;
+        while (true) {
+            mLevelOffsets.push_back(offset);
+            offset += numEntries * kValuesPerEntry;
+            if (numEntries == 1) {
+                break;
+            }
+            numEntries = (numEntries + 1) / 2;
+        }
+        mLevelOffsets.push_back(offset);
+    }
+
+    PeakPyramid::~PeakPyramid() {
+        if (mMapping != nullptr) {
+            munmap(mMapping, mMappingSize);
+        }
+    }
+
+    int64_t PeakPyramid::getNumEntries(int32_t level) const {
+        return (mLevelOffsets[level + 1] - mLevelOffsets[level]) / kValuesPerEntry;
+    }
+
+    std::unique_ptr<PeakPyramid> PeakPyramid::load(const std::string& path,
+                                                   int64_t fileSize, int64_t fileModifiedNanos) {
+        int fileDescriptor = open(path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<PeakPyramid> pyramid;
+        SidecarHeader header;
+        struct stat fileStat;
+        if (read(fileDescriptor, &header, sizeof(header)) == sizeof(header)
+                && header.magic == kSidecarMagic && header.version == kSidecarVersion
+                && header.fileSize == fileSize && header.fileModifiedNanos == fileModifiedNanos
+                && header.baseBlockFrames == kBaseBlockFrames
+                && header.numChannels > 0 && header.numFrames >= 0
+                && fstat(fileDescriptor, &fileStat) == 0) {
+            pyramid.reset(new PeakPyramid(header.numChannels, header.sampleRate, header.numFrames));
+            size_t size = sizeof(SidecarHeader) + pyramid->mLevelOffsets.back() * sizeof(int16_t);
+            void* mapping = static_cast<int32_t>(pyramid->mLevelOffsets.size()) - 1 == header.numLevels
+                            && static_cast<size_t>(fileStat.st_size) == size
+                            ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0)
+                            : MAP_FAILED;
+            if (mapping != MAP_FAILED) {
+                pyramid->mMapping = mapping;
+                pyramid->mMappingSize = size;
+                pyramid->mData = reinterpret_cast<const int16_t*>(
+                        static_cast<const char*>(mapping) + sizeof(SidecarHeader));
+            } else {
+                pyramid.reset(); // truncated, or written by a different layout
+            }
+        }
+
+        close(fileDescriptor);
+        return pyramid;
+    }
+
+    std::unique_ptr<PeakPyramid> PeakPyramid::build(int32_t numChannels, int32_t sampleRate,
+                                                    int64_t numFrames, const FrameReader& readFrames) {
+        if (numChannels <= 0 || numFrames < 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<PeakPyramid> pyramid(new PeakPyramid(numChannels, sampleRate, numFrames));
+        pyramid->mOwnedData.assign(pyramid->mLevelOffsets.back(), 0);
+        int16_t* data = pyramid->mOwnedData.data();
+
+        // Level 0 from the audio
+        std::unique_ptr<float[]> buffer(new float[kBuildChunkFrames * numChannels]);
+        int64_t numEntries = pyramid->getNumEntries(0);
+        int64_t frameIndex = 0;
+        for (int64_t entry = 0; entry < numEntries && frameIndex < numFrames; ) {
+            int32_t numToRead = static_cast<int32_t>(
+                    std::min<int64_t>(kBuildChunkFrames, numFrames - frameIndex));
+            int32_t numRead = readFrames(buffer.get(), numToRead);
+            if (numRead <= 0) {
+                break; // shorter than its header claims, the rest stays silent
+            }
+            frameIndex += numRead;
+
+            for (int32_t blockStart = 0; blockStart < numRead; blockStart += kBaseBlockFrames) {
+                int32_t numSamples = std::min(kBaseBlockFrames, numRead - blockStart) * numChannels;
+                const float* samples = buffer.get() + blockStart * numChannels;
+                float minValue = samples[0];
+                float maxValue = samples[0];
+                float sumSquares = 0.0f;
+                for (int32_t index = 0; index < numSamples; index++) {
+                    float sample = samples[index];
+                    minValue = std::min(minValue, sample);
+                    maxValue = std::max(maxValue, sample);
+                    sumSquares += sample * sample;
+                }
+                int16_t* values = data + entry * kValuesPerEntry;
+                values[0] = quantize(minValue, floorf);
+                values[1] = quantize(maxValue, ceilf);
+                values[2] = quantize(sqrtf(sumSquares / numSamples), roundf);
+                entry++;
+            }
+        }
+
+        // Every other level from the one below it
+        for (int32_t level = 1; level < static_cast<int32_t>(pyramid->mLevelOffsets.size()) - 1; level++) {
+            const int16_t* below = data + pyramid->mLevelOffsets[level - 1];
+            int64_t numBelow = pyramid->getNumEntries(level - 1);
+            int16_t* values = data + pyramid->mLevelOffsets[level];
+            for (int64_t entry = 0; entry < pyramid->getNumEntries(level); entry++) {
+                const int16_t* first = below + 2 * entry * kValuesPerEntry;
+                if (2 * entry + 1 < numBelow) {
+                    const int16_t* second = first + kValuesPerEntry;
+                    float rms1 = first[2] / kFullScale;
+                    float rms2 = second[2] / kFullScale;
+                    values[0] = std::min(first[0], second[0]);
+                    values[1] = std::max(first[1], second[1]);
+                    values[2] = quantize(sqrtf((rms1 * rms1 + rms2 * rms2) * 0.5f), roundf);
+                } else {
+                    memcpy(values, first, kValuesPerEntry * sizeof(int16_t));
+                }
+                values += kValuesPerEntry;
+            }
+        }
+
+        pyramid->mData = data;
+        return pyramid;
+    }
+
+    bool PeakPyramid::save(const std::string& path, int64_t fileSize,
+                           int64_t fileModifiedNanos) const {
+        // Unique, as several sources may be analyzing the same file at once
+        static std::atomic<uint32_t> sNextTempId { 0 };
+        std::string tempPath = path + ".tmp" + std::to_string(getpid()) + "."
+                               + std::to_string(sNextTempId.fetch_add(1));
+        int fileDescriptor = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fileDescriptor < 0) {
+            return false; // e.g. a read-only directory, the pyramid still works from memory
+        }
+
+        SidecarHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = kSidecarMagic;
+        header.version = kSidecarVersion;
+        header.fileSize = fileSize;
+        header.fileModifiedNanos = fileModifiedNanos;
+        header.numFrames = mNumFrames;
+        header.numChannels = mNumChannels;
+        header.sampleRate = mSampleRate;
+        header.baseBlockFrames = kBaseBlockFrames;
+        header.numLevels = static_cast<int32_t>(mLevelOffsets.size()) - 1;
+
+        parselib::FileOutputStream stream(fileDescriptor);
+        bool ok = stream.write(&header, sizeof(header)) == sizeof(header);
+        const char* bytes = reinterpret_cast<const char*>(mData);
+        int64_t numBytes = mLevelOffsets.back() * sizeof(int16_t);
+        for (int64_t offset = 0; ok && offset < numBytes; ) {
+            int32_t numToWrite = static_cast<int32_t>(std::min<int64_t>(numBytes - offset, 1 << 20));
+            ok = stream.write(bytes + offset, numToWrite) == numToWrite;
+            offset += numToWrite;
+        }
+        close(fileDescriptor);
+
+        if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+            unlink(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    PeakPyramid::Peak PeakPyramid::getPeak(int32_t level, int64_t firstEntry,
+                                           int64_t endEntry) const {
+        const int16_t* values = getLevel(level) + firstEntry * kValuesPerEntry;
+        int16_t minValue = values[0];
+        int16_t maxValue = values[1];
+        float sumSquares = 0.0f;
+        for (int64_t entry = firstEntry; entry < endEntry; entry++) {
+            minValue = std::min(minValue, values[0]);
+            maxValue = std::max(maxValue, values[1]);
+            float rms = values[2] / kFullScale;
+            sumSquares += rms * rms;
+            values += kValuesPerEntry;
+        }
+        return { minValue / kFullScale, maxValue / kFullScale,
+                 sqrtf(sumSquares / (endEntry - firstEntry)) };
+    }
+
+    void PeakPyramid::getPeaks(int64_t startFrame, int64_t endFrame, int32_t numPeaks,
+                               Peak* peaks) const {
+        if (numPeaks <= 0) {
+            return;
+        }
+
+        // The coarsest level with at least one block per peak
+        int32_t numLevels = static_cast<int32_t>(mLevelOffsets.size()) - 1;
+        double framesPerPeak = (endFrame - startFrame) / (double) numPeaks;
+        int32_t level = 0;
+        while (level + 1 < numLevels && (int64_t) kBaseBlockFrames << (level + 1) <= framesPerPeak) {
+            level++;
+        }
+        int64_t blockFrames = (int64_t) kBaseBlockFrames << level;
+        int64_t numEntries = getNumEntries(level);
+
+        for (int32_t index = 0; index < numPeaks; index++) {
+            int64_t peakStart = startFrame + (int64_t) (framesPerPeak * index);
+            int64_t peakEnd = std::max(peakStart + 1, startFrame + (int64_t) (framesPerPeak * (index + 1)));
+            peakStart = std::max<int64_t>(0, peakStart);
+            peakEnd = std::min(mNumFrames, peakEnd);
+
+            int64_t firstEntry = peakStart / blockFrames;
+            int64_t endEntry = std::min(numEntries, (peakEnd + blockFrames - 1) / blockFrames);
+            peaks[index] = peakStart < peakEnd && firstEntry < endEntry
+                           ? getPeak(level, firstEntry, endEntry)
+                           : Peak { 0.0f, 0.0f, 0.0f };
+        }
+    }
+
+} // namespace iolib
@@ -0,0 +1,95 @@
+#ifndef _PLAYER_PEAKPYRAMID_H_
+#define _PLAYER_PEAKPYRAMID_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace iolib {
+
+/**
+ * A multi-resolution min/max/RMS overview of an audio file, all channels combined.
+ *
+ * Level 0 summarizes blocks of kBaseBlockFrames frames, every following level halves the
+ * resolution, down to a single block for the whole file. It is computed once per file and
+ * saved as a sidecar file, identified by the audio file's size and modification time, which
+ * later loads map instead of decoding the audio again.
+ *
+ * Immutable once built, so any thread may query it.
+ */
+    class PeakPyramid {
+    public:
+        static constexpr int32_t kBaseBlockFrames = 256;
+
+        struct Peak {
+            float min;
+            float max;
+            float rms;
+        };
+
+        /**
+         * Reads up to numFrames interleaved frames into buff, returns the number read (0 at
+         * the end of the data).
+         */
+        typedef std::function<int32_t(float* buff, int32_t numFrames)> FrameReader;
+
+        ~PeakPyramid();
+
+        /**
+         * Maps the sidecar at path. Returns nullptr if there is none, or it belongs to another
+         * version of the audio file.
+         */
+        static std::unique_ptr<PeakPyramid> load(const std::string& path,
+                                                 int64_t fileSize, int64_t fileModifiedNanos);
+
+        /**
+         * Decodes numFrames frames through readFrames and summarizes them.
+         */
+        static std::unique_ptr<PeakPyramid> build(int32_t numChannels, int32_t sampleRate,
+                                                  int64_t numFrames, const FrameReader& readFrames);
+
+        /**
+         * Writes the sidecar, tagged with the audio file's size and modification time.
+         * The file is replaced atomically, so a concurrent load() never sees a partial one.
+         */
+        bool save(const std::string& path, int64_t fileSize, int64_t fileModifiedNanos) const;
+
+        int64_t getNumFrames() const { return mNumFrames; }
+        int32_t getNumChannels() const { return mNumChannels; }
+        int32_t getSampleRate() const { return mSampleRate; }
+
+        /**
+         * Fills numPeaks peaks, each covering an equal share of [startFrame, endFrame), from
+         * the coarsest level that still resolves them. Peaks outside the file are silent.
+         */
+        void getPeaks(int64_t startFrame, int64_t endFrame, int32_t numPeaks, Peak* peaks) const;
+
+    private:
+        // Stored as 16-bit fixed point: min, max, rms
+        static constexpr int32_t kValuesPerEntry = 3;
+
+        PeakPyramid(int32_t numChannels, int32_t sampleRate, int64_t numFrames);
+
+        int64_t getNumEntries(int32_t level) const;
+        const int16_t* getLevel(int32_t level) const { return mData + mLevelOffsets[level]; }
+        Peak getPeak(int32_t level, int64_t firstEntry, int64_t endEntry) const;
+
+        int32_t mNumChannels;
+        int32_t mSampleRate;
+        int64_t mNumFrames;
+
+        // Offset of each level in mData, in int16 values, plus the total at the end
+        std::vector<int64_t> mLevelOffsets;
+
+        // Either mOwnedData or the sidecar mapping
+        const int16_t* mData;
+        std::vector<int16_t> mOwnedData;
+        void* mMapping;
+        size_t mMappingSize;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_PEAKPYRAMID_H_
@@ -0,0 +1,145 @@
+#include "RealtimeAllocationCheck.h"
+
+#ifdef IOLIB_CHECK_REALTIME_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+#include <android/log.h>
+
+static const char* TAG = "RealtimeAllocationCheck";
+
+// Nesting depth of ScopedRealtimeSection on the current thread
+static thread_local int sRealtimeDepth = 0;
+
+static void checkNotRealtime(const char* operation) {
+    if (sRealtimeDepth > 0) {
+        __android_log_assert(nullptr, TAG, "%s called from a real-time section", operation);
+    }
+}
+
+namespace iolib {
+
+    ScopedRealtimeSection::ScopedRealtimeSection() {
+        sRealtimeDepth++;
+    }
+
+    ScopedRealtimeSection::~ScopedRealtimeSection() {
+        sRealtimeDepth--;
+    }
+
+} // namespace iolib
+
+void* operator new(std::size_t size) {
+    checkNotRealtime("operator new");
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        std::abort();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    checkNotRealtime("operator new[]");
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        std::abort();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        checkNotRealtime("operator delete");
+    }
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    if (p != nullptr) {
+        checkNotRealtime("operator delete[]");
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    operator delete[](p);
+}
+
+// The over-aligned forms (alignas() above the default new alignment) don't go through the ones
+// above, so they are replaced as well. posix_memalign() rather than aligned_alloc(), which needs
+// API 28; its blocks are freed with free().
+static void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void* p = nullptr;
+    if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align,
+                       size == 0 ? 1 : size) != 0) {
+        return nullptr;
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    checkNotRealtime("operator new");
+    void* p = allocateAligned(size, alignment);
+    if (p == nullptr) {
+        std::abort();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    checkNotRealtime("operator new[]");
+    void* p = allocateAligned(size, alignment);
+    if (p == nullptr) {
+        std::abort();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    checkNotRealtime("operator new");
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    checkNotRealtime("operator new[]");
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    if (p != nullptr) {
+        checkNotRealtime("operator delete");
+    }
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    if (p != nullptr) {
+        checkNotRealtime("operator delete[]");
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete[](p, alignment);
+}
+
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete[](p, alignment);
+}
+
+#endif // IOLIB_CHECK_REALTIME_ALLOCATIONS
@@ -0,0 +1,33 @@
+#ifndef _PLAYER_REALTIMEALLOCATIONCHECK_H_
+#define _PLAYER_REALTIMEALLOCATIONCHECK_H_
+
+namespace iolib {
+
+/**
+ * Marks a region of code (typically the body of onAudioReady()) as real-time.
+ *
+ * When the library is built with IOLIB_CHECK_REALTIME_ALLOCATIONS defined, any call to the
+ * global operator new/delete made from the same thread while a ScopedRealtimeSection is alive
+ * aborts with a message naming the offending operation. Otherwise this compiles to nothing.
+ *
+ * Note that direct malloc()/free() calls are not intercepted.
+ */
+#ifdef IOLIB_CHECK_REALTIME_ALLOCATIONS
+    class ScopedRealtimeSection {
+    public:
+        ScopedRealtimeSection();
+        ~ScopedRealtimeSection();
+
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+    };
+#else
+    class ScopedRealtimeSection {
+    public:
+        ScopedRealtimeSection() {}
+    };
+#endif
+
+} // namespace iolib
+
+#endif //_PLAYER_REALTIMEALLOCATIONCHECK_H_
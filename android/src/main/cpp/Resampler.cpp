@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Resampler.h"
+
+namespace iolib {
+
+    /**
+     * The coefficient table, mNumPhases rows of mNumTaps coefficients.
+     */
+    struct PolyphaseFilter {
+        int32_t numTaps;
+        int32_t numPhases;
+        std::unique_ptr<float[]> coefficients;
+    };
+
+    struct QualityParameters {
+        int32_t numTaps;
+        double  kaiserBeta;
+        double  passbandFraction;   // cutoff, as a fraction of the lower Nyquist frequency
+    };
+
+    static QualityParameters getQualityParameters(ResamplerQuality quality) {
+        switch (quality) {
+            case ResamplerQuality::Low: return { 16, 6.0, 0.85 };
+            case ResamplerQuality::High: return { 64, 10.0, 0.95 };
+            case ResamplerQuality::Medium:
+            default: return { 32, 8.0, 0.91 };
+        }
+    }
+
+    // Zeroth order modified Bessel function of the first kind, for the Kaiser window
+    static double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1e-12; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    static std::shared_ptr<const PolyphaseFilter> createFilter(int32_t numPhases,
+                                                               double conversionRatio,
+                                                               ResamplerQuality quality) {
+        QualityParameters parameters = getQualityParameters(quality);
+        int32_t numTaps = parameters.numTaps;
+        int32_t halfTaps = numTaps / 2;
+
+        // Normalized to the input rate; lower it when decimating to keep out of the new Nyquist
+        double cutoff = std::min(1.0, conversionRatio) * parameters.passbandFraction;
+        double windowScale = 1.0 / besselI0(parameters.kaiserBeta);
+
+        auto filter = std::make_shared<PolyphaseFilter>();
+        filter->numTaps = numTaps;
+        filter->numPhases = numPhases;
+        filter->coefficients.reset(new float[static_cast<size_t>(numPhases) * numTaps]);
+
+        for (int32_t phase = 0; phase < numPhases; phase++) {
+            float* row = filter->coefficients.get() + static_cast<size_t>(phase) * numTaps;
+            double sum = 0.0;
+            for (int32_t tap = 0; tap < numTaps; tap++) {
+                // Distance, in input frames, from the output position to this tap
+                double x = tap - (halfTaps - 1) - (double) phase / numPhases;
+                double sinc = x == 0.0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+                double t = x / halfTaps;
+                double window = t * t < 1.0
+                                ? besselI0(parameters.kaiserBeta * sqrt(1.0 - t * t)) * windowScale
+                                : 0.0;
+                row[tap] = static_cast<float>(sinc * window);
+                sum += row[tap];
+            }
+
+            // Unity gain at DC for every phase
+            for (int32_t tap = 0; tap < numTaps; tap++) {
+                row[tap] = static_cast<float>(row[tap] / sum);
+            }
+        }
+
+        return filter;
+    }
+
+    // Tables are shared by every resampler with the same ratio and quality
+    static std::shared_ptr<const PolyphaseFilter> getFilter(int32_t numPhases,
+                                                            int32_t inputRate, int32_t outputRate,
+                                                            ResamplerQuality quality) {
+        static std::mutex sLock;
+        static std::map<std::tuple<int32_t, int32_t, int32_t, ResamplerQuality>,
+                        std::weak_ptr<const PolyphaseFilter>> sFilters;
+
+        std::lock_guard<std::mutex> lock(sLock);
+        auto key = std::make_tuple(numPhases, inputRate, outputRate, quality);
+        std::shared_ptr<const PolyphaseFilter> filter = sFilters[key].lock();
+        if (filter == nullptr) {
+            filter = createFilter(numPhases, (double) outputRate / inputRate, quality);
+            sFilters[key] = filter;
+        }
+        return filter;
+    }
+
+/*
+ * Dot products. numTaps is always a multiple of 8.
+ */
+#if defined(__ARM_NEON)
+    static inline float dotProduct(const float* a, const float* b, int32_t n) {
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        for (int32_t index = 0; index < n; index += 8) {
+            sum0 = vmlaq_f32(sum0, vld1q_f32(a + index), vld1q_f32(b + index));
+            sum1 = vmlaq_f32(sum1, vld1q_f32(a + index + 4), vld1q_f32(b + index + 4));
+        }
+        float32x4_t sum = vaddq_f32(sum0, sum1);
+#if defined(__aarch64__)
+        return vaddvq_f32(sum);
+#else
+        float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+        return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+    }
+#elif defined(__SSE2__)
+    static inline float dotProduct(const float* a, const float* b, int32_t n) {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (int32_t index = 0; index < n; index += 8) {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + index), _mm_loadu_ps(b + index)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + index + 4),
+                                               _mm_loadu_ps(b + index + 4)));
+        }
+        __m128 sum = _mm_add_ps(sum0, sum1);
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+#else
+    static inline float dotProduct(const float* a, const float* b, int32_t n) {
+        float sum = 0.0f;
+        for (int32_t index = 0; index < n; index++) {
+            sum += a[index] * b[index];
+        }
+        return sum;
+    }
+#endif
+
+    Resampler::Resampler()
+            : mChannelCount(0), mInputRate(0), mOutputRate(0), mNumTaps(0),
+              mNumPhases(1), mStep(1), mFilterPhases(1), mPhase(0), mHistoryIndex(0)
+    {}
+
+    Resampler::~Resampler() {}
+
+    void Resampler::configure(int32_t channelCount, int32_t inputRate, int32_t outputRate,
+                              ResamplerQuality quality) {
+        int32_t divisor = std::gcd(inputRate, outputRate);
+        mNumPhases = outputRate / divisor;
+        mStep = inputRate / divisor;
+
+        // Unusual ratios (e.g. 44056 -> 48000) still keep exact time, only the filter phase
+        // is rounded to the nearest of kMaxPhases
+        mFilterPhases = std::min(mNumPhases, kMaxPhases);
+        mFilter = getFilter(mFilterPhases, mStep, mNumPhases, quality);
+        mChannelCount = channelCount;
+        mInputRate = inputRate;
+        mOutputRate = outputRate;
+        mNumTaps = mFilter->numTaps;
+        mHistory.reset(new float[static_cast<size_t>(channelCount) * mNumTaps * 2]);
+
+        reset(0);
+    }
+
+    int64_t Resampler::getOutputFrames(int64_t numInputFrames) const {
+        return (numInputFrames * mNumPhases + mStep - 1) / mStep;
+    }
+
+    int64_t Resampler::reset(int64_t outputFrame) {
+        memset(mHistory.get(), 0, static_cast<size_t>(mChannelCount) * mNumTaps * 2 * sizeof(float));
+        mHistoryIndex = 0;
+
+        // The output frame sits between input frames centerFrame and centerFrame + 1, which
+        // are taps (halfTaps - 1) and halfTaps of the filter
+        int64_t position = outputFrame * mStep;
+        int64_t centerFrame = position / mNumPhases;
+        int32_t phase = static_cast<int32_t>(position % mNumPhases);
+        int32_t halfTaps = mNumTaps / 2;
+
+        int64_t newestFrame = centerFrame + halfTaps;
+        int64_t firstFrame = std::max<int64_t>(0, newestFrame - mNumTaps + 1);
+        mPhase = phase + static_cast<int32_t>(newestFrame - firstFrame + 1) * mNumPhases;
+        return firstFrame;
+    }
+
+    void Resampler::pushFrame(const float* frame) {
+        int32_t historySize = mNumTaps * 2;
+        for (int32_t channel = 0; channel < mChannelCount; channel++) {
+            float* history = mHistory.get() + channel * historySize;
+            history[mHistoryIndex] = frame[channel];
+            history[mHistoryIndex + mNumTaps] = frame[channel];
+        }
+        mHistoryIndex = mHistoryIndex + 1 < mNumTaps ? mHistoryIndex + 1 : 0;
+    }
+
+    int32_t Resampler::process(const float* input, int32_t numInputFrames,
+                               int32_t* numInputFramesUsed, float* output,
+                               int32_t numOutputFrames) {
+        int32_t channelCount = mChannelCount;
+        int32_t numTaps = mNumTaps;
+        int32_t historySize = numTaps * 2;
+        const float* coefficients = mFilter->coefficients.get();
+
+        int32_t numUsed = 0;
+        int32_t numProduced = 0;
+        while (numProduced < numOutputFrames) {
+            while (mPhase >= mNumPhases) {
+                if (numUsed == numInputFrames) {
+                    *numInputFramesUsed = numUsed;
+                    return numProduced;
+                }
+                pushFrame(input + numUsed * channelCount);
+                numUsed++;
+                mPhase -= mNumPhases;
+            }
+
+            int32_t filterPhase = mFilterPhases == mNumPhases
+                    ? mPhase
+                    : static_cast<int32_t>(static_cast<int64_t>(mPhase) * mFilterPhases / mNumPhases);
+            const float* row = coefficients + static_cast<size_t>(filterPhase) * numTaps;
+            const float* window = mHistory.get() + mHistoryIndex;
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                output[channel] = dotProduct(window + channel * historySize, row, numTaps);
+            }
+            output += channelCount;
+            numProduced++;
+            mPhase += mStep;
+        }
+
+        *numInputFramesUsed = numUsed;
+        return numProduced;
+    }
+
+} // namespace iolib
@@ -0,0 +1,94 @@
+#ifndef _PLAYER_RESAMPLER_H_
+#define _PLAYER_RESAMPLER_H_
+
+#include <cstdint>
+#include <memory>
+
+namespace iolib {
+
+    /**
+     * Resampler filter length/steepness trade-off.
+     */
+    enum class ResamplerQuality : int32_t {
+        Low = 0,        // 16 taps
+        Medium = 1,     // 32 taps
+        High = 2,       // 64 taps
+    };
+
+    struct PolyphaseFilter;
+
+/**
+ * A polyphase windowed-sinc (Kaiser) sample rate converter for interleaved float frames.
+ *
+ * The conversion ratio is reduced to outputRate/inputRate = L/M and one filter phase is
+ * precomputed for each of the L output positions between two input frames. Ratios that need
+ * more than kMaxPhases phases use the nearest of kMaxPhases phases, timing stays exact.
+ * Filter tables are shared between resamplers with the same ratio and quality.
+ *
+ * Output is aligned with the input: output frame n corresponds to input time n * M / L, the
+ * filter delay is compensated for by reset().
+ *
+ * configure() allocates, process() never does.
+ */
+    class Resampler {
+    public:
+        static constexpr int32_t kMaxPhases = 1024;
+
+        Resampler();
+        ~Resampler();
+
+        /**
+         * Control thread only.
+         */
+        void configure(int32_t channelCount, int32_t inputRate, int32_t outputRate,
+                       ResamplerQuality quality);
+
+        int32_t getInputRate() { return mInputRate; }
+        int32_t getOutputRate() { return mOutputRate; }
+
+        /**
+         * Number of output frames produced from numInputFrames input frames.
+         */
+        int64_t getOutputFrames(int64_t numInputFrames) const;
+
+        /**
+         * Clears the filter history so that the next output frame is outputFrame. Returns the
+         * input frame the caller must feed from. Frames before input frame 0 are taken as silence.
+         */
+        int64_t reset(int64_t outputFrame);
+
+        /**
+         * Converts up to numInputFrames input frames into up to numOutputFrames output frames.
+         * Stops when either runs out. The number of input frames consumed is returned in
+         * numInputFramesUsed, the number of output frames written is the return value.
+         * Feed silence after the end of the input to flush out the last output frames.
+         */
+        int32_t process(const float* input, int32_t numInputFrames, int32_t* numInputFramesUsed,
+                        float* output, int32_t numOutputFrames);
+
+    private:
+        void pushFrame(const float* frame);
+
+        std::shared_ptr<const PolyphaseFilter> mFilter;
+
+        int32_t mChannelCount;
+        int32_t mInputRate;
+        int32_t mOutputRate;
+        int32_t mNumTaps;
+        int32_t mNumPhases;     // L
+        int32_t mStep;          // M
+        int32_t mFilterPhases;  // rows in the filter table, L capped at kMaxPhases
+
+        // Position of the next output frame relative to the newest input frame, in 1/L frames.
+        // Input frames are pushed while it is >= L.
+        int32_t mPhase;
+
+        // Per channel, the last mNumTaps input frames, stored twice so the filter always sees
+        // them contiguously (oldest first) at mHistory + mHistoryIndex.
+        std::unique_ptr<float[]> mHistory;
+        int32_t mHistoryIndex;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_RESAMPLER_H_
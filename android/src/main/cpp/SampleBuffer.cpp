@@ -0,0 +1,73 @@
+#include <vector>
+
+#include "SampleBuffer.h"
+#include "wav/AudioStreamReader.h"
+
+namespace iolib {
+
+    SampleBuffer::SampleBuffer(int32_t numChannels, int32_t sampleRate, int32_t numFrames)
+            : mData(new float[static_cast<size_t>(numFrames) * numChannels]),
+              mNumChannels(numChannels),
+              mSampleRate(sampleRate),
+              mNumFrames(numFrames)
+    {}
+
+    std::shared_ptr<const SampleBuffer> SampleBuffer::decode(parselib::AudioStreamReader& reader) {
+        if (!reader.isValid()) {
+            return nullptr;
+        }
+        int32_t numChannels = reader.getNumChannels();
+        int64_t numFileFrames = reader.getNumSampleFrames();
+        if (numFileFrames * numChannels > INT32_MAX) {
+            return nullptr; // too big to hold in memory, it can only be streamed
+        }
+        int32_t numFrames = static_cast<int32_t>(numFileFrames);
+
+        std::shared_ptr<SampleBuffer> buffer(
+                new SampleBuffer(numChannels, reader.getSampleRate(), numFrames));
+
+        reader.positionToAudio();
+        int32_t numRead = reader.getDataFloat(buffer->mData.get(), numFrames);
+        if (numRead < 0) {
+            return nullptr;
+        }
+        // A truncated file has fewer frames than its header claims, the rest of the buffer
+        // was never written
+        buffer->mNumFrames = numRead;
+
+        return buffer;
+    }
+
+    std::shared_ptr<const SampleBuffer> SampleBuffer::resample(const SampleBuffer& source,
+                                                               int32_t sampleRate,
+                                                               ResamplerQuality quality) {
+        int32_t numChannels = source.mNumChannels;
+
+        Resampler resampler;
+        resampler.configure(numChannels, source.mSampleRate, sampleRate, quality);
+        int64_t numOutputFrames = resampler.getOutputFrames(source.mNumFrames);
+        if (numOutputFrames * numChannels > INT32_MAX) {
+            return nullptr;
+        }
+        int32_t numFrames = static_cast<int32_t>(numOutputFrames);
+
+        std::shared_ptr<SampleBuffer> buffer(new SampleBuffer(numChannels, sampleRate, numFrames));
+
+        int32_t numInputUsed;
+        resampler.reset(0);
+        int32_t numProduced = resampler.process(source.mData.get(), source.mNumFrames,
+                                                &numInputUsed, buffer->mData.get(), numFrames);
+
+        // Flush the filter with silence to get the last frames out
+        static constexpr int32_t kFlushFrames = 64;
+        std::vector<float> silence(kFlushFrames * numChannels, 0.0f);
+        while (numProduced < numFrames) {
+            numProduced += resampler.process(silence.data(), kFlushFrames, &numInputUsed,
+                                             buffer->mData.get() + numProduced * numChannels,
+                                             numFrames - numProduced);
+        }
+
+        return buffer;
+    }
+
+} // namespace iolib
@@ -0,0 +1,55 @@
+#ifndef _PLAYER_SAMPLEBUFFER_H_
+#define _PLAYER_SAMPLEBUFFER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "Resampler.h"
+
+namespace parselib {
+    class AudioStreamReader;
+}
+
+namespace iolib {
+
+/**
+ * A whole audio file decoded to interleaved float frames.
+ *
+ * Buffers are immutable once decode() returns and are shared, by reference count, between
+ * all SampleSources playing the same file (see SampleBufferCache).
+ */
+    class SampleBuffer {
+    public:
+        /**
+         * Decodes all of the reader's audio data. The reader must have been parse()d.
+         * Returns nullptr if the data can't be decoded. If the file ends before the frames
+         * its header claims, the buffer holds only those decoded.
+         */
+        static std::shared_ptr<const SampleBuffer> decode(parselib::AudioStreamReader& reader);
+
+        /**
+         * Returns a copy of source converted to sampleRate.
+         */
+        static std::shared_ptr<const SampleBuffer> resample(const SampleBuffer& source,
+                                                            int32_t sampleRate,
+                                                            ResamplerQuality quality);
+
+        const float* getData() const { return mData.get(); }
+
+        int32_t getNumChannels() const { return mNumChannels; }
+        int32_t getSampleRate() const { return mSampleRate; }
+        int32_t getNumFrames() const { return mNumFrames; }
+
+    private:
+        SampleBuffer(int32_t numChannels, int32_t sampleRate, int32_t numFrames);
+
+        std::unique_ptr<float[]> mData;
+
+        int32_t mNumChannels;
+        int32_t mSampleRate;
+        int32_t mNumFrames;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_SAMPLEBUFFER_H_
@@ -0,0 +1,40 @@
+#include "SampleBufferCache.h"
+
+namespace iolib {
+
+    SampleBufferCache& SampleBufferCache::getInstance() {
+        static SampleBufferCache sInstance;
+        return sInstance;
+    }
+
+    std::shared_ptr<const SampleBuffer> SampleBufferCache::find(const Key& key) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto entry = mBuffers.find(key);
+        return entry != mBuffers.end() ? entry->second.lock() : nullptr;
+    }
+
+    std::shared_ptr<const SampleBuffer> SampleBufferCache::insert(
+            const Key& key, std::shared_ptr<const SampleBuffer> buffer) {
+        std::lock_guard<std::mutex> lock(mLock);
+        purgeExpired();
+
+        auto& entry = mBuffers[key];
+        std::shared_ptr<const SampleBuffer> existing = entry.lock();
+        if (existing != nullptr) {
+            return existing;
+        }
+        entry = buffer;
+        return buffer;
+    }
+
+    void SampleBufferCache::purgeExpired() {
+        for (auto entry = mBuffers.begin(); entry != mBuffers.end();) {
+            if (entry->second.expired()) {
+                entry = mBuffers.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+    }
+
+} // namespace iolib
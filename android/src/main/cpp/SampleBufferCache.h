@@ -0,0 +1,66 @@
+#ifndef _PLAYER_SAMPLEBUFFERCACHE_H_
+#define _PLAYER_SAMPLEBUFFERCACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "SampleBuffer.h"
+
+namespace iolib {
+
+/**
+ * Process-wide registry of preloaded SampleBuffers, so loading the same (unchanged) file twice
+ * decodes it once. Entries are weak: a buffer is freed as soon as the last source using it is.
+ *
+ * Thread-safe.
+ */
+    class SampleBufferCache {
+    public:
+        /**
+         * Identifies a file's contents: the path plus its modification time and size, and
+         * the rate (and converter quality) it was resampled to. sampleRate 0 is the file's own.
+         */
+        struct Key {
+            std::string path;
+            int64_t modifiedNanos;
+            int64_t size;
+            int32_t sampleRate;
+            ResamplerQuality quality;
+
+            bool operator<(const Key& other) const {
+                return std::tie(path, modifiedNanos, size, sampleRate, quality)
+                       < std::tie(other.path, other.modifiedNanos, other.size,
+                                  other.sampleRate, other.quality);
+            }
+        };
+
+        static SampleBufferCache& getInstance();
+
+        /**
+         * Returns the live buffer for key, or nullptr.
+         */
+        std::shared_ptr<const SampleBuffer> find(const Key& key);
+
+        /**
+         * Registers buffer for key. If another thread registered one first, that one is
+         * returned instead (and should be used in place of buffer).
+         */
+        std::shared_ptr<const SampleBuffer> insert(const Key& key,
+                                                   std::shared_ptr<const SampleBuffer> buffer);
+
+    private:
+        SampleBufferCache() {}
+
+        void purgeExpired();
+
+        std::mutex mLock;
+        std::map<Key, std::weak_ptr<const SampleBuffer>> mBuffers;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_SAMPLEBUFFERCACHE_H_
@@ -14,175 +14,599 @@
  * limitations under the License.
  */
 
-#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+#include "SampleBufferCache.h"
 #include "SampleSource.h"
+#include "stream/BufferedInputStream.h"
+#include "stream/FileInputStream.h"
+#include "stream/MappedInputStream.h"
+
+// Appended to the audio file's path to name its PeakPyramid sidecar
+static const char* kPeaksFileSuffix = ".peaks";
 
-static const char *TAG = "SampleSource";
-static const float MIN_DB = -40;
+// Largest single decode performed by serviceStream(), keeps each source's turn on the
+// I/O thread short so one track can't starve the others
+static constexpr int32_t kStreamChunkFrames = 4096;
 
 namespace iolib {
 
-    SampleSource::SampleSource(const char* fileName, float pan)
+    // Prefer mapping the file, so the reader can decode straight out of the page cache,
+    // otherwise read it in large blocks
+    static std::unique_ptr<parselib::InputStream> openInputStream(int fileDescriptor) {
+        auto mappedStream = std::make_unique<parselib::MappedInputStream>(fileDescriptor);
+        if (mappedStream->isValid()) {
+            return mappedStream;
+        }
+        return std::make_unique<parselib::BufferedInputStream>(
+                std::make_unique<parselib::FileInputStream>(fileDescriptor));
+    }
+
+    SampleSource::SampleSource(const char* fileName, float pan, LoadPolicy loadPolicy)
             :
-              mFileName(fileName),
-              mFileDescriptor(open(fileName, O_RDONLY)),
-              mStream(parselib::FileInputStream(mFileDescriptor)),  // Initialize mStream with the file descriptor
-              mReader(parselib::WavStreamReader(&mStream)),  // Initialize the reader with the stream
-              mCurSampleIndex(0),
+              mCurFrame(0),
+              mNextTransportFrame(0),
               mIsPlaying(false),
-              mGain(1.0f)
+              mGain(1.0f),
+              mFileDescriptor(-1),
+              mFileName(fileName),
+              mNumChannels(0),
+              mSampleRate(0),
+              mNumFrames(0)
     {
-        mReader.parse();
         setPan(pan);
 
-        auto total = mReader.getNumSampleFrames();
+        struct stat fileStat;
+        bool fileExists = stat(fileName, &fileStat) == 0;
+        if (fileExists) {
+            mFileModifiedNanos = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000
+                                 + fileStat.st_mtim.tv_nsec;
+            mFileSize = static_cast<int64_t>(fileStat.st_size);
+        }
 
-        float minDecibels = 0;
-        float maxDecibels = MIN_DB;
+        bool preloadFile = loadPolicy == LoadPolicy::Preload;
+        if (loadPolicy == LoadPolicy::Auto) {
+            preloadFile = fileExists && mFileSize <= kAutoPreloadMaxBytes;
+        }
 
-        // We'll take average for a chunk since that is a good practical approximation
-        int chunkSize = 2048;
-        float* buffer = new float[2048];
-        for (int i = 0; i < total; i+=chunkSize) {
-            // Skipping last chunk to avoid dealing with end-of-data bounds
-            if ((total - i) < chunkSize)
-                continue;
+        if (preloadFile && fileExists) {
+            preload();
+        }
+        if (mPreloadedBuffer == nullptr) {
+            openStream();
+        }
 
-            // Calculate average amplitude for the chunk
-            float minAmplitude = 1;
-            float maxAmplitude = 0;
-            mReader.getDataFloat(buffer, 2048 / mReader.getNumChannels());
-            for (int j = 0; j < chunkSize; j++) {
-                float f = buffer[j];
-                if (f < 0) f *= -1;
+        loadPeaks();
 
-                if (f > maxAmplitude)
-                    maxAmplitude = f;
+        prepareToPlay(kDefaultMaxFramesPerCallback, kDefaultOutputChannels);
+    }
 
-                if (f < minAmplitude)
-                    minAmplitude = f;
-            }
+    void SampleSource::openStream() {
+        mFileDescriptor = open(mFileName.c_str(), O_RDONLY);
+        mStream = openInputStream(mFileDescriptor);
+        mReader = parselib::AudioStreamReader::create(mStream.get());
+        mReader->parse();
+        if (!mReader->isValid()) {
+            // Missing, or not a WAV or FLAC file we can play: getNumChannels() reports 0
+            mReader.reset();
+            mStream.reset();
+            return;
+        }
 
-            float tmpMinDecibels;
-            if (minAmplitude == 0)
-                tmpMinDecibels = MIN_DB;
-            else tmpMinDecibels = fmax(MIN_DB, log10(minAmplitude) * (float)10);
-            if (tmpMinDecibels < minDecibels)
-                minDecibels = tmpMinDecibels;
+        mNumChannels = mReader->getNumChannels();
+        mSampleRate = mReader->getSampleRate();
+        mNumFrames = mReader->getNumSampleFrames();
+        mFileSampleRate = mSampleRate;
+        mNumFileFrames = mNumFrames;
+    }
 
-            float tmpMaxDecibels = log10(maxAmplitude) * (float)10;
-            if (tmpMaxDecibels > maxDecibels)
-                maxDecibels = tmpMaxDecibels;
+    void SampleSource::preload() {
+        std::shared_ptr<const SampleBuffer> buffer =
+                loadPreloadedBuffer(0, ResamplerQuality::Medium);
+        if (buffer == nullptr) {
+            return;
         }
 
-        delete[] buffer;
-        mMinDecibels = minDecibels;
-        mMaxDecibels = maxDecibels;
+        mPreloadedBuffer = buffer;
+        mNumChannels = buffer->getNumChannels();
+        mSampleRate = buffer->getSampleRate();
+        mNumFrames = buffer->getNumFrames();
+        mFileSampleRate = mSampleRate;
+        mNumFileFrames = mNumFrames;
     }
 
-    void SampleSource::mixAudio(float* outBuff, int numChannels, int32_t numFrames) {
-        int32_t sampleChannels = mReader.getNumChannels();
-        int32_t numSamples = mReader.getNumSampleFrames() * sampleChannels;
-        int32_t samplesLeft = numSamples - mCurSampleIndex;
-        int32_t numWriteFrames = mIsPlaying
-                                 ? std::min(numFrames, samplesLeft / sampleChannels)
-                                 : 0;
+    std::shared_ptr<const SampleBuffer> SampleSource::loadPreloadedBuffer(int32_t sampleRate,
+                                                                          ResamplerQuality quality) {
+        if (sampleRate == 0) {
+            quality = ResamplerQuality::Medium; // irrelevant, keep a single key for the original
+        }
+        SampleBufferCache::Key key { mFileName, mFileModifiedNanos, mFileSize, sampleRate, quality };
+
+        // Another source may already have this exact file in memory
+        SampleBufferCache& cache = SampleBufferCache::getInstance();
+        std::shared_ptr<const SampleBuffer> buffer = cache.find(key);
+        if (buffer != nullptr) {
+            return buffer;
+        }
+
+        if (sampleRate == 0) {
+            int fileDescriptor = open(mFileName.c_str(), O_RDONLY);
+            if (fileDescriptor < 0) {
+                return nullptr;
+            }
+            {
+                std::unique_ptr<parselib::InputStream> stream = openInputStream(fileDescriptor);
+                std::unique_ptr<parselib::AudioStreamReader> reader =
+                        parselib::AudioStreamReader::create(stream.get());
+                reader->parse();
+                buffer = SampleBuffer::decode(*reader);
+            }
+            close(fileDescriptor);
+        } else {
+            std::shared_ptr<const SampleBuffer> original =
+                    loadPreloadedBuffer(0, ResamplerQuality::Medium);
+            if (original == nullptr || original->getSampleRate() == sampleRate) {
+                return original;
+            }
+            buffer = SampleBuffer::resample(*original, sampleRate, quality);
+        }
 
-        float* buffer = new float[numWriteFrames * sampleChannels];
+        if (buffer == nullptr) {
+            return nullptr;
+        }
+        return cache.insert(key, buffer);
+    }
 
-        mReader.getDataFloat(buffer, numWriteFrames);
+    void SampleSource::loadPeaks() {
+        if (mNumChannels <= 0) {
+            return;
+        }
 
-        float amplitudeMax = 0;
+        // Decoding the whole file is only needed the first time it is loaded
+        std::string sidecarPath = mFileName + kPeaksFileSuffix;
+        std::shared_ptr<const PeakPyramid> peaks =
+                PeakPyramid::load(sidecarPath, mFileSize, mFileModifiedNanos);
+        if (peaks != nullptr && (peaks->getNumChannels() != mNumChannels
+                                 || peaks->getSampleRate() != mFileSampleRate
+                                 || peaks->getNumFrames() != mNumFileFrames)) {
+            peaks = nullptr;
+        }
 
-        if (numWriteFrames != 0) {
-            if ((sampleChannels == 1) && (numChannels == 1)) {
-                // MONO output from MONO samples
-                for (int32_t frameIndex = 0; frameIndex < numWriteFrames * sampleChannels;) {
-                    mCurSampleIndex++;
-                    if (abs(buffer[frameIndex]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex]);
-                    }
-                    outBuff[frameIndex] += buffer[frameIndex++] * mGain;
+        if (peaks == nullptr) {
+            int64_t frameIndex = 0;
+            auto readFrames = [this, &frameIndex](float* buff, int32_t numFrames) -> int32_t {
+                if (mPreloadedBuffer != nullptr) {
+                    numFrames = static_cast<int32_t>(
+                            std::min<int64_t>(numFrames, mNumFileFrames - frameIndex));
+                    memcpy(buff, mPreloadedBuffer->getData() + frameIndex * mNumChannels,
+                           numFrames * mNumChannels * sizeof(float));
+                    frameIndex += numFrames;
+                    return numFrames;
                 }
-            } else if ((sampleChannels == 1) && (numChannels == 2)) {
-                // STEREO output from MONO samples
-                int dstSampleIndex = 0;
-                for (int32_t frameIndex = 0; frameIndex < numWriteFrames * sampleChannels;) {
-                    mCurSampleIndex++;
-                    if (abs(buffer[frameIndex]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex]);
-                    }
-                    outBuff[dstSampleIndex++] += buffer[frameIndex] * mLeftGain;
-                    outBuff[dstSampleIndex++] += buffer[frameIndex++] * mRightGain;
-                }
-            } else if ((sampleChannels == 2) && (numChannels == 1)) {
-                // MONO output from STEREO samples
-                int dstSampleIndex = 0;
-                for (int32_t frameIndex = 0; frameIndex < numWriteFrames * sampleChannels;) {
-                    mCurSampleIndex += 2;
-                    if (abs(buffer[frameIndex]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex]);
-                    }
-                    if (abs(buffer[frameIndex + 1]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex + 1]);
-                    }
-                    outBuff[dstSampleIndex++] += buffer[frameIndex++] * mLeftGain +
-                                                 buffer[frameIndex++] * mRightGain;
+                return mReader->getDataFloat(buff, numFrames);
+            };
+            std::shared_ptr<const PeakPyramid> built = PeakPyramid::build(
+                    mNumChannels, mFileSampleRate, mNumFileFrames, readFrames);
+            if (mReader != nullptr) {
+                // The scan above left the reader at the end of the data
+                mReader->positionToAudio();
+                mReaderFrame = 0;
+            }
+            if (built == nullptr) {
+                return;
+            }
+            built->save(sidecarPath, mFileSize, mFileModifiedNanos);
+            peaks = built;
+        }
+
+        mPeaks = peaks;
+    }
+
+    void SampleSource::getWaveform(int64_t startFrame, int64_t endFrame, int32_t numPeaks,
+                                   PeakPyramid::Peak* peaks) {
+        if (mPeaks == nullptr || mSampleRate <= 0) {
+            memset(peaks, 0, std::max(0, numPeaks) * sizeof(PeakPyramid::Peak));
+            return;
+        }
+        // The overview is of the file, at its own rate
+        mPeaks->getPeaks(startFrame * mFileSampleRate / mSampleRate,
+                         endFrame * mFileSampleRate / mSampleRate, numPeaks, peaks);
+    }
+
+    void SampleSource::setOutputSampleRate(int32_t sampleRate, ResamplerQuality quality) {
+        if (mNumChannels <= 0 || sampleRate <= 0) {
+            return;
+        }
+
+        if (mPreloadedBuffer != nullptr) {
+            bool isConverted = mPreloadedBuffer->getSampleRate() != mFileSampleRate;
+            if (mPreloadedBuffer->getSampleRate() != sampleRate
+                    || (isConverted && quality != mResamplerQuality)) {
+                std::shared_ptr<const SampleBuffer> buffer = loadPreloadedBuffer(sampleRate, quality);
+                if (buffer != nullptr) {
+                    mPreloadedBuffer = buffer;
                 }
-            } else if ((sampleChannels == 2) && (numChannels == 2)) {
-                // STEREO output from STEREO samples
-                int dstSampleIndex = 0;
-
-                for (int32_t frameIndex = 0; frameIndex < numWriteFrames * sampleChannels;) {
-                    mCurSampleIndex += 2;
-                    if (abs(buffer[frameIndex]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex]);
-                    }
-                    if (abs(buffer[frameIndex + 1]) > amplitudeMax) {
-                        amplitudeMax = abs(buffer[frameIndex + 1]);
-                    }
-                    outBuff[dstSampleIndex++] += buffer[frameIndex++] * mLeftGain;
-                    outBuff[dstSampleIndex++] += buffer[frameIndex++] * mRightGain;
+            }
+            mSampleRate = mPreloadedBuffer->getSampleRate();
+            mNumFrames = mPreloadedBuffer->getNumFrames();
+        } else if (isStreaming()) {
+            mResampling = sampleRate != mFileSampleRate;
+            mNumFrames = mNumFileFrames;
+            int64_t firstFileFrame = 0;
+            if (mResampling) {
+                mResampler.configure(mNumChannels, mFileSampleRate, sampleRate, quality);
+                mNumFrames = mResampler.getOutputFrames(mNumFileFrames);
+                firstFileFrame = mResampler.reset(0);
+                if (mResampleInput == nullptr) {
+                    mResampleInput.reset(new float[kStreamChunkFrames * mNumChannels]);
                 }
             }
+            mSampleRate = sampleRate;
+
+            // Not serviced by the I/O thread right now, so restart the stream directly
+            mReader->setDataPosition(firstFileFrame);
+            mReaderFrame = firstFileFrame;
+            mStreamFrame = 0;
+            mResampleInputFrames = 0;
+            mResampleInputOffset = 0;
+
+            uint32_t request = mSeekRequest.load(std::memory_order_relaxed);
+            mSeekDone.store(request, std::memory_order_relaxed);
+            mSeekFlushed.store(request, std::memory_order_relaxed);
+            mSeekPending = false;
+            mPriming = true;
+            mStarvedFramesToSkip = 0;
+            mCueReadFrame = 0;
+            mCueEndFrame = 0;
+        }
+
+        mResamplerQuality = quality;
+        mCueRequested = false;
+        mCurFrame = 0;
+        mNextTransportFrame = 0;
+    }
+
+    void SampleSource::prepareToPlay(int32_t maxFramesPerCallback, int32_t numOutputChannels) {
+        int32_t numSamples = maxFramesPerCallback * mNumChannels;
+        if (maxFramesPerCallback > mScratchFrames) {
+            mScratchBuffer.reset(new float[numSamples]);
+            mScratchFrames = maxFramesPerCallback;
+        }
+        selectMixKernel(numOutputChannels);
+    }
 
-            if (mCurSampleIndex >= numSamples) {
-                mIsPlaying = false;
+    void SampleSource::selectMixKernel(int32_t numOutputChannels) {
+        mMixKernel = MixKernels::select(mNumChannels, numOutputChannels);
+        mMixChannels = numOutputChannels;
+        calcGainFactors();
+    }
+
+    static inline int64_t nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void SampleSource::mixAudio(float* outBuff, int numChannels, int64_t transportFrame,
+                                int32_t numFrames) {
+        int64_t startNanos = nowNanos();
+        if (transportFrame != mNextTransportFrame) {
+            seekTo(transportFrame);
+        }
+        mNextTransportFrame = transportFrame + numFrames;
+
+        int32_t sampleChannels = mNumChannels;
+        int32_t numWriteFrames = mIsPlaying
+                                 ? static_cast<int32_t>(std::max<int64_t>(0,
+                                         std::min<int64_t>(numFrames, mNumFrames - mCurFrame)))
+                                 : 0;
+
+        // Normally chosen by prepareToPlay(), this only catches a caller mixing into a
+        // different layout. Selecting a kernel doesn't allocate.
+        if (numChannels != mMixChannels) {
+            selectMixKernel(numChannels);
+        }
+
+        MixLevel level { 0.0f, 0.0f };
+        int32_t numLevelSamples = numWriteFrames * sampleChannels;
+
+        // The callback may ask for more frames than the scratch buffer holds (e.g. after the
+        // stream was reconfigured), so mix in scratch-sized slices rather than allocating.
+        while (numWriteFrames > 0 && mScratchFrames > 0) {
+            int32_t numSliceFrames = std::min(numWriteFrames, mScratchFrames);
+            const float* buffer;
+            if (mPreloadedBuffer != nullptr) {
+                // Mix straight out of the shared buffer
+                buffer = mPreloadedBuffer->getData() + mCurFrame * sampleChannels;
+            } else {
+                readStreamFrames(mScratchBuffer.get(), numSliceFrames);
+                buffer = mScratchBuffer.get();
             }
+
+            MixLevel sliceLevel = mMixKernel(buffer, sampleChannels, outBuff, numChannels,
+                                             numSliceFrames, mMixMatrix);
+            level.peak = std::max(level.peak, sliceLevel.peak);
+            level.sumOfSquares += sliceLevel.sumOfSquares;
+            mCurFrame += numSliceFrames;
+
+            outBuff += numSliceFrames * numChannels;
+            numWriteFrames -= numSliceFrames;
         }
 
-        float logPower = fmax((float)MIN_DB, log10(amplitudeMax) * (float)10);
-        __android_log_print(ANDROID_LOG_INFO, TAG, "log power %f", logPower);
-        __android_log_print(ANDROID_LOG_INFO, TAG, "min decibels %f", mMinDecibels);
-        __android_log_print(ANDROID_LOG_INFO, TAG, "max decibels %f", mMaxDecibels);
-        float scaledPower = fmin((float)1, (logPower - mMinDecibels) / (mMaxDecibels - mMinDecibels));
-        mLastAmplitude = scaledPower * mGain;
-        delete[] buffer;
+        // Raw values, the conversion to dB is left to the LevelMeters reader
+        mLastPeak = level.peak;
+        mLastMeanSquare = numLevelSamples > 0 ? level.sumOfSquares / numLevelSamples : 0.0f;
 
         // silence
         // no need as the output buffer would need to have been filled with silence
         // to be mixed into
+
+        mMixNanos += nowNanos() - startNanos;
     }
 
-    float SampleSource::getPosition() {
-        auto current = static_cast<float>(mCurSampleIndex);
-        auto total = static_cast<float>(mReader.getNumSampleFrames());
+    void SampleSource::seekTo(int64_t transportFrame) {
+        int64_t frameIndex = std::min(transportFrame, mNumFrames);
 
-        return current / total;
+        mCurFrame = frameIndex;
+        if (isStreaming()) {
+            requestSeek(frameIndex);
+        }
     }
 
-    void SampleSource::setPosition(float position) {
-        auto total = static_cast<float>(mReader.getNumSampleFrames());
-        auto newPosition = static_cast<int>(position * total);
-        if (newPosition % 2 == 1)
-            newPosition--;
+    void SampleSource::allocateStreamBuffer(int32_t capacityFrames) {
+        mStreamBuffer.allocate(capacityFrames, mNumChannels);
+        for (std::unique_ptr<float[]>& cueBuffer : mCueBuffers) {
+            cueBuffer.reset(new float[kSeekPrefetchFrames * mNumChannels]);
+        }
+        mCueReadFrame = 0;
+        mCueEndFrame = 0;
+    }
 
-        mCurSampleIndex = newPosition;
-        mReader.setDataPosition(mCurSampleIndex);
+    void SampleSource::requestSeek(int64_t frameIndex) {
+        mSeekFrame.store(frameIndex, std::memory_order_relaxed);
+        mSeekRequest.store(mSeekRequest.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_release);
+        mSeekPending = true;
+        mPriming = true;
+        mStarvedFramesToSkip = 0;
+        mCueRequested = false; // superseded, switchToCue() has nothing to do
+    }
+
+    void SampleSource::acceptSeek(uint32_t request) {
+        // The I/O thread has prefetched the target and is waiting for us, so everything in
+        // the ring is from before the seek.
+        mStreamBuffer.flush();
+        int32_t cueBufferIndex = 1 - mCueBufferIndex.load(std::memory_order_relaxed);
+        mCueBufferIndex.store(cueBufferIndex, std::memory_order_relaxed);
+        mCueReadFrame = 0;
+        mCueEndFrame = mCueBufferFrames[cueBufferIndex];
+        mSeekFlushed.store(request, std::memory_order_release);
+    }
+
+    void SampleSource::cueFrame(int64_t transportFrame) {
+        mCueFrame = std::max<int64_t>(0, std::min(transportFrame, mNumFrames));
+        mCueRequested = true;
+        if (!isStreaming()) {
+            return;
+        }
+
+        if (mSeekPending) {
+            // Still waiting on a jump, nothing buffered is from the current position
+            mStreamBuffer.flush();
+            mCueReadFrame = mCueEndFrame;
+            mSeekPending = false;
+            mPriming = true;
+        }
+        mSeekFrame.store(mCueFrame, std::memory_order_relaxed);
+        mSeekRequest.store(mSeekRequest.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_release);
     }
 
-    float SampleSource::getAmplitude() {
-        return mLastAmplitude;
+    bool SampleSource::isCued() {
+        return !mCueRequested || !isStreaming()
+               || mSeekDone.load(std::memory_order_acquire)
+                  == mSeekRequest.load(std::memory_order_relaxed);
+    }
+
+    void SampleSource::switchToCue() {
+        if (!mCueRequested) {
+            return; // added after the seek was requested, it will catch up by itself
+        }
+        if (isStreaming()) {
+            acceptSeek(mSeekRequest.load(std::memory_order_relaxed));
+            mPriming = true;
+            mStarvedFramesToSkip = 0;
+        }
+        mCurFrame = mCueFrame;
+        mNextTransportFrame = mCueFrame;
+        mCueRequested = false;
+    }
+
+    int32_t SampleSource::getBufferedFrames() {
+        if (!isStreaming()) {
+            return INT32_MAX;
+        }
+        if (mSeekPending) {
+            return 0;
+        }
+        int64_t numBuffered = (mCueEndFrame - mCueReadFrame) + mStreamBuffer.getReadableFrames()
+                              - mStarvedFramesToSkip;
+        if (numBuffered >= mNumFrames - mCurFrame) {
+            return INT32_MAX;
+        }
+        return static_cast<int32_t>(std::max<int64_t>(0, numBuffered));
+    }
+
+    void SampleSource::readStreamFrames(float* buffer, int32_t numFrames) {
+        int32_t numChannels = mNumChannels;
+
+        if (mSeekPending) {
+            uint32_t request = mSeekRequest.load(std::memory_order_relaxed);
+            if (mSeekDone.load(std::memory_order_acquire) == request) {
+                acceptSeek(request);
+                mSeekPending = false;
+            }
+        }
+
+        int32_t numRead = 0;
+        if (!mSeekPending) {
+            // Drop frames that were already played as silence
+            if (mStarvedFramesToSkip > 0) {
+                int32_t numSkipped = std::min(mStarvedFramesToSkip, mCueEndFrame - mCueReadFrame);
+                mCueReadFrame += numSkipped;
+                mStarvedFramesToSkip -= numSkipped;
+                mStarvedFramesToSkip -= mStreamBuffer.skip(mStarvedFramesToSkip);
+            }
+            if (mStarvedFramesToSkip == 0) {
+                // What is left of the prefetched seek target comes first
+                numRead = std::min(numFrames, mCueEndFrame - mCueReadFrame);
+                if (numRead > 0) {
+                    const float* cueBuffer =
+                            mCueBuffers[mCueBufferIndex.load(std::memory_order_relaxed)].get();
+                    memcpy(buffer, cueBuffer + mCueReadFrame * numChannels,
+                           numRead * numChannels * sizeof(float));
+                    mCueReadFrame += numRead;
+                }
+                numRead += mStreamBuffer.read(buffer + numRead * numChannels, numFrames - numRead);
+            }
+        }
+
+        if (numRead > 0) {
+            mPriming = false;
+        }
+
+        if (numRead < numFrames) {
+            memset(buffer + numRead * numChannels, 0,
+                   (numFrames - numRead) * numChannels * sizeof(float));
+            mStarvedFramesToSkip += numFrames - numRead;
+
+            // Waiting for the first data after a seek is expected, not a starvation
+            if (!mPriming) {
+                mNumStarvations.fetch_add(1, std::memory_order_relaxed);
+                mNumStarvedFrames.fetch_add(numFrames - numRead, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    int32_t SampleSource::serviceStream(int32_t lowWatermarkFrames, int32_t highWatermarkFrames) {
+        if (!isStreaming()) {
+            return 0;
+        }
+
+        uint32_t request = mSeekRequest.load(std::memory_order_acquire);
+        if (request != mSeekDone.load(std::memory_order_relaxed)) {
+            int64_t frameIndex = mSeekFrame.load(std::memory_order_relaxed);
+            int64_t fileFrameIndex = frameIndex;
+            if (mResampling) {
+                fileFrameIndex = mResampler.reset(frameIndex);
+                mResampleInputFrames = 0;
+                mResampleInputOffset = 0;
+            }
+            mReader->setDataPosition(fileFrameIndex);
+            mReaderFrame = fileFrameIndex;
+            mStreamFrame = frameIndex;
+
+            // Prefetch the start of the target, so the audio thread can switch over without
+            // waiting on the ring
+            int32_t cueBufferIndex = 1 - mCueBufferIndex.load(std::memory_order_relaxed);
+            float* cueBuffer = mCueBuffers[cueBufferIndex].get();
+            int32_t numToCue = static_cast<int32_t>(
+                    std::min<int64_t>(kSeekPrefetchFrames, mNumFrames - mStreamFrame));
+            int32_t numCued = 0;
+            while (numCued < numToCue) {
+                int32_t numRead = decodeStreamFrames(
+                        cueBuffer + numCued * mNumChannels,
+                        std::min(numToCue - numCued, kStreamChunkFrames));
+                if (numRead <= 0) {
+                    break;
+                }
+                numCued += numRead;
+            }
+            mCueBufferFrames[cueBufferIndex] = numCued;
+            mStreamFrame += numCued;
+
+            mSeekDone.store(request, std::memory_order_release);
+            return numCued;
+        }
+
+        if (mSeekFlushed.load(std::memory_order_acquire) != request) {
+            return 0; // the audio thread hasn't dropped the pre-seek frames yet
+        }
+
+        int32_t numBuffered = mStreamBuffer.getReadableFrames();
+        if (numBuffered >= lowWatermarkFrames) {
+            return 0;
+        }
+
+        int64_t totalFrames = mNumFrames;
+        int32_t numDecoded = 0;
+        while (numBuffered < highWatermarkFrames && mStreamFrame < totalFrames) {
+            int32_t numFrames;
+            float* region = mStreamBuffer.getWriteRegion(&numFrames);
+            numFrames = static_cast<int32_t>(std::min<int64_t>(
+                    std::min({ numFrames, highWatermarkFrames - numBuffered, kStreamChunkFrames }),
+                    totalFrames - mStreamFrame));
+            if (numFrames <= 0) {
+                break;
+            }
+
+            int32_t numRead = decodeStreamFrames(region, numFrames);
+            if (numRead <= 0) {
+                break;
+            }
+            mStreamBuffer.commitWrite(numRead);
+
+            mStreamFrame += numRead;
+            numBuffered += numRead;
+            numDecoded += numRead;
+            if (numRead < numFrames) {
+                break; // end of data
+            }
+        }
+
+        return numDecoded;
+    }
+
+    int32_t SampleSource::decodeStreamFrames(float* buffer, int32_t numFrames) {
+        if (mResampling) {
+            return resampleStreamFrames(buffer, numFrames);
+        }
+        int32_t numRead = mReader->getDataFloat(buffer, numFrames);
+        mReaderFrame += std::max(0, numRead);
+        return numRead;
+    }
+
+    int32_t SampleSource::resampleStreamFrames(float* buffer, int32_t numFrames) {
+        int32_t numChannels = mNumChannels;
+        int32_t numProduced = 0;
+        while (numProduced < numFrames) {
+            if (mResampleInputOffset == mResampleInputFrames) {
+                int32_t numToRead = static_cast<int32_t>(
+                        std::min<int64_t>(kStreamChunkFrames, mNumFileFrames - mReaderFrame));
+                int32_t numRead = numToRead > 0
+                                  ? std::max(0, mReader->getDataFloat(mResampleInput.get(), numToRead))
+                                  : 0;
+                mReaderFrame += numRead;
+                if (numRead == 0) {
+                    // Past the end of the file, silence flushes the last frames out of the filter
+                    memset(mResampleInput.get(), 0, kStreamChunkFrames * numChannels * sizeof(float));
+                    numRead = kStreamChunkFrames;
+                }
+                mResampleInputFrames = numRead;
+                mResampleInputOffset = 0;
+            }
+
+            int32_t numUsed;
+            numProduced += mResampler.process(
+                    mResampleInput.get() + mResampleInputOffset * numChannels,
+                    mResampleInputFrames - mResampleInputOffset, &numUsed,
+                    buffer + numProduced * numChannels, numFrames - numProduced);
+            mResampleInputOffset += numUsed;
+        }
+        return numProduced;
     }
 
 }
\ No newline at end of file
@@ -17,16 +17,33 @@
 #ifndef _PLAYER_SAMPLESOURCE_
 #define _PLAYER_SAMPLESOURCE_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <string>
 
-#include "stream/FileInputStream.h"
-#include "wav/WavStreamReader.h"
+#include "FrameRingBuffer.h"
+#include "MixKernels.h"
+#include "PeakPyramid.h"
+#include "Resampler.h"
+#include "SampleBuffer.h"
+#include "stream/InputStream.h"
+#include "wav/AudioStreamReader.h"
 #include "fstream"
 #include <fcntl.h>
 #include <unistd.h>
-#include <android/log.h>
 
 namespace iolib {
+
+    /**
+     * How a SampleSource gets its audio at play time.
+     */
+    enum class LoadPolicy : int32_t {
+        Stream = 0,     // decode from disk on the DiskStreamer I/O thread
+        Preload = 1,    // decode the whole file into memory at load, shared between identical files
+        Auto = 2,       // Preload files up to kAutoPreloadMaxBytes, Stream bigger ones
+    };
+
     class SampleSource {
     public:
         // Pan position of the audio in a stereo mix
@@ -35,14 +52,44 @@ namespace iolib {
         static constexpr float PAN_HARDRIGHT = 1.0f;
         static constexpr float PAN_CENTER = 0.0f;
 
-        SampleSource(const char* fileName, float pan);
+        // LoadPolicy::Auto preloads files up to this size on disk
+        static constexpr int64_t kAutoPreloadMaxBytes = 16 * 1024 * 1024;
+
+        SampleSource(const char* fileName, float pan, LoadPolicy loadPolicy = LoadPolicy::Stream);
         virtual ~SampleSource() {
-            close(mFileDescriptor);
+            if (mFileDescriptor >= 0) {
+                close(mFileDescriptor);
+            }
         }
 
-        void setPlayMode() { mCurSampleIndex = 0; mIsPlaying = true; }
-        void setStopMode() { mIsPlaying = false; mCurSampleIndex = 0; }
-        float getDuration() { return mReader.getNumSampleFrames() / (float)mReader.getSampleRate(); }
+        /**
+         * Enables/disables the source in the mix. Its position is always taken from the
+         * player's transport clock (see mixAudio()), so re-enabling a source doesn't restart it.
+         */
+        void setPlayMode() { mIsPlaying = true; }
+        void setStopMode() { mIsPlaying = false; }
+        float getDuration() { return mNumFrames / (float)mSampleRate; }
+
+        int64_t getNumFrames() { return mNumFrames; }
+
+        /**
+         * Converts the source to the output rate, so that getNumFrames() and mixAudio() are in
+         * output frames. Preloaded sources are resampled here (and the result shared through
+         * the SampleBufferCache), streaming sources are resampled on the I/O thread as they
+         * are decoded. Also moves the source back to frame 0.
+         * Control thread only, while the source is neither mixed nor registered with the
+         * DiskStreamer.
+         */
+        void setOutputSampleRate(int32_t sampleRate, ResamplerQuality quality);
+
+        int32_t getNumChannels() { return mNumChannels; }
+        int32_t getSampleRate() { return mSampleRate; }
+        const char* getFileName() { return mFileName.c_str(); }
+
+        /**
+         * true if the audio is read from disk by the DiskStreamer, false if it is preloaded.
+         */
+        bool isStreaming() { return mReader != nullptr; }
 
         bool isPlaying() { return mIsPlaying; }
 
@@ -70,13 +117,97 @@ namespace iolib {
             return mGain;
         }
 
-        virtual void mixAudio(float* outBuff, int numChannels, int32_t numFrames);
-        float getPosition();
-        void setPosition(float position);
-        float getAmplitude();
+        /**
+         * Makes sure the scratch memory used by mixAudio() can hold at least
+         * maxFramesPerCallback frames, and picks the mix kernel for numOutputChannels. May
+         * allocate, so call it from the control thread only, while this source is not being
+         * mixed (or before it is added to the player).
+         */
+        void prepareToPlay(int32_t maxFramesPerCallback, int32_t numOutputChannels);
+
+        /**
+         * Mixes numFrames frames of this source, starting at frame transportFrame of the
+         * player's transport, into outBuff. If transportFrame isn't where the previous call
+         * left off (the transport was moved, or the source was disabled for a while) the
+         * source repositions itself first. Frames past the end of the source are left silent.
+         */
+        virtual void mixAudio(float* outBuff, int numChannels, int64_t transportFrame,
+                              int32_t numFrames);
+
+        /**
+         * Level of the audio the last mixAudio() call mixed, before gain and pan: the largest
+         * absolute sample and the mean square over all channels. Zero if nothing was mixed.
+         */
+        float getLastPeak() { return mLastPeak; }
+        float getLastMeanSquare() { return mLastMeanSquare; }
+
+        /**
+         * Time spent in mixAudio() since the last call, in nanoseconds. For the thread that
+         * owns the mix, once the block's mixing is complete.
+         */
+        int64_t takeMixNanos() {
+            int64_t nanos = mMixNanos;
+            mMixNanos = 0;
+            return nanos;
+        }
+
+        /*
+         * Disk streaming. The audio thread only ever reads decoded frames from the stream
+         * buffer; the DiskStreamer I/O thread keeps it topped up via serviceStream().
+         */
+
+        /**
+         * Allocates the decoded-frame ring and the seek prefetch buffers. Control thread,
+         * before the source is mixed.
+         */
+        void allocateStreamBuffer(int32_t capacityFrames);
+
+        /**
+         * Called on the I/O thread. If fewer than lowWatermarkFrames frames are buffered, decodes
+         * until highWatermarkFrames are buffered (or the end of the data). Also carries out any
+         * seek requested by the audio thread, prefetching kSeekPrefetchFrames frames of its
+         * target first. Returns the number of frames decoded.
+         */
+        int32_t serviceStream(int32_t lowWatermarkFrames, int32_t highWatermarkFrames);
+
+        /*
+         * Seeking without a gap (see SeekCoordinator), audio thread only. cueFrame() has the
+         * I/O thread prefetch the audio at transportFrame while mixAudio() carries on from the
+         * current position with what is already buffered. Once isCued(), switchToCue() makes
+         * the next mixAudio() continue from transportFrame, straight out of the prefetched
+         * frames. Preloaded sources are always cued.
+         */
+        void cueFrame(int64_t transportFrame);
+        bool isCued();
+        void switchToCue();
+
+        /**
+         * Frames mixAudio() can still play from the current position before it needs the I/O
+         * thread, INT32_MAX if the rest of the source is there. Audio thread.
+         */
+        int32_t getBufferedFrames();
+
+        /**
+         * Number of callbacks in which the stream buffer could not supply all of the frames
+         * that were due, and the total number of frames replaced by silence.
+         */
+        uint32_t getStarvationCount() { return mNumStarvations.load(std::memory_order_relaxed); }
+        uint32_t getStarvedFrames() { return mNumStarvedFrames.load(std::memory_order_relaxed); }
+
+        /**
+         * Waveform overview of [startFrame, endFrame) (output frames, like the transport) in
+         * numPeaks equal slices, from the peak sidecar. Never touches the audio data.
+         * Any thread.
+         */
+        void getWaveform(int64_t startFrame, int64_t endFrame, int32_t numPeaks,
+                         PeakPyramid::Peak* peaks);
 
     protected:
-        int32_t mCurSampleIndex;
+        // Output frame index of the next frame to mix
+        int64_t mCurFrame;
+
+        // Transport frame the next mixAudio() call is expected to start at
+        int64_t mNextTransportFrame;
 
         bool mIsPlaying;
 
@@ -92,20 +223,127 @@ namespace iolib {
 
     private:
         int mFileDescriptor;
-        const char* mFileName;
-        float mMinDecibels;
-        float mMaxDecibels;
-        float mLastAmplitude = 0.0f;
+        std::string mFileName;
+        int64_t mFileModifiedNanos = 0;
+        int64_t mFileSize = 0;
+
+        int32_t mNumChannels;
+        int32_t mSampleRate;    // output rate, once setOutputSampleRate() was called
+        int64_t mNumFrames;     // at mSampleRate
+        int32_t mFileSampleRate = 0;
+        int64_t mNumFileFrames = 0;
+        ResamplerQuality mResamplerQuality = ResamplerQuality::Medium;
+        float mLastPeak = 0.0f;
+        float mLastMeanSquare = 0.0f;
+        int64_t mMixNanos = 0;
+
+        // Decode buffer for mixAudio(), sized by prepareToPlay() so the callback never allocates
+        static constexpr int32_t kDefaultMaxFramesPerCallback = 1024;
+        static constexpr int32_t kDefaultOutputChannels = 2;
+        std::unique_ptr<float[]> mScratchBuffer;
+        int32_t mScratchFrames = 0;
 
-        parselib::FileInputStream mStream;
-        parselib::WavStreamReader mReader;
+        // Decoded frames, written by the I/O thread and read by the audio thread
+        FrameRingBuffer mStreamBuffer;
+
+        // Seek handshake between the audio thread (requests) and the I/O thread.
+        // 1. audio thread: stores mSeekFrame, then bumps mSeekRequest.
+        // 2. I/O thread: repositions the reader, decodes the start of the target into the cue
+        //    buffer the audio thread isn't playing, publishes mSeekDone = request and stops
+        //    writing until the audio thread has switched over.
+        // 3. audio thread, whenever it is ready to: flushes the ring, plays the new cue buffer
+        //    ahead of it and publishes mSeekFlushed = request.
+        std::atomic<int64_t> mSeekFrame { 0 };
+        std::atomic<uint32_t> mSeekRequest { 0 };
+        std::atomic<uint32_t> mSeekDone { 0 };
+        std::atomic<uint32_t> mSeekFlushed { 0 };
+
+        // File frame index of the next frame the reader will decode, and output frame index
+        // of the next frame that will be written to the ring. I/O thread only.
+        int64_t mReaderFrame = 0;
+        int64_t mStreamFrame = 0;
+
+        // Streaming sample rate conversion, I/O thread only (after setOutputSampleRate()).
+        // Decoded file frames are staged in mResampleInput before conversion.
+        bool mResampling = false;
+        Resampler mResampler;
+        std::unique_ptr<float[]> mResampleInput;
+        int32_t mResampleInputFrames = 0;
+        int32_t mResampleInputOffset = 0;
+
+        int32_t resampleStreamFrames(float* buffer, int32_t numFrames);
+
+        // Decodes (and converts) up to numFrames frames at the reader, I/O thread
+        int32_t decodeStreamFrames(float* buffer, int32_t numFrames);
+
+        // The start of the seek target, decoded by the I/O thread before it reports the seek
+        // done. Two, so it can fill one while the audio thread still plays out the other.
+        static constexpr int32_t kSeekPrefetchFrames = 8192;
+        std::unique_ptr<float[]> mCueBuffers[2];
+        int32_t mCueBufferFrames[2] = { 0, 0 };     // written by the I/O thread before mSeekDone
+        std::atomic<int32_t> mCueBufferIndex { 0 };  // the one played, switched by the audio thread
+
+        // Audio thread: the unread part of the cue buffer played, which comes before the ring
+        int32_t mCueReadFrame = 0;
+        int32_t mCueEndFrame = 0;
+
+        // Audio thread: the target of cueFrame() until switchToCue()
+        int64_t mCueFrame = 0;
+        bool mCueRequested = false;
+
+        // Frames the audio thread played as silence while starved. They are dropped from the
+        // ring once they arrive so the source stays in sync with the others. Audio thread only.
+        int32_t mStarvedFramesToSkip = 0;
+
+        // Audio thread only
+        bool mSeekPending = false;
+        bool mPriming = true;   // no data has arrived since loading or the last seek
+
+        std::atomic<uint32_t> mNumStarvations { 0 };
+        std::atomic<uint32_t> mNumStarvedFrames { 0 };
+
+        void seekTo(int64_t transportFrame);
+        void requestSeek(int64_t frameIndex);
+        void acceptSeek(uint32_t request);
+        void readStreamFrames(float* buffer, int32_t numFrames);
+
+        // Streaming: memory-mapped when possible, plain file reads otherwise
+        std::unique_ptr<parselib::InputStream> mStream;
+        std::unique_ptr<parselib::AudioStreamReader> mReader;
+
+        // Preloaded: the whole file, decoded (possibly shared with other sources)
+        std::shared_ptr<const SampleBuffer> mPreloadedBuffer;
+
+        void openStream();
+        void preload();
+
+        // Min/max/RMS overview of the file
+        std::shared_ptr<const PeakPyramid> mPeaks;
+
+        void loadPeaks();
+
+        /**
+         * The whole file decoded and, unless sampleRate is 0, converted to sampleRate.
+         * Shared through the SampleBufferCache.
+         */
+        std::shared_ptr<const SampleBuffer> loadPreloadedBuffer(int32_t sampleRate,
+                                                                ResamplerQuality quality);
+
+        // Channel routing into the output, for mMixChannels output channels
+        MixKernel mMixKernel = nullptr;
+        MixMatrix mMixMatrix {};
+        int32_t mMixChannels = 0;
+
+        void selectMixKernel(int32_t numOutputChannels);
 
         void calcGainFactors() {
             // useful panning information: http://www.cs.cmu.edu/~music/icm-online/readings/panlaws/
             float rightPan = (mPan * 0.5) + 0.5;
             mRightGain = rightPan * mGain;
-            mLeftGain = (1.0 - rightPan) * mGain;    }
-
+            mLeftGain = (1.0 - rightPan) * mGain;
+            MixKernels::buildMatrix(mNumChannels, mMixChannels, mLeftGain, mRightGain,
+                                    &mMixMatrix);
+        }
 
     };
 
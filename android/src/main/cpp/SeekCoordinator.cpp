@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BusMixer.h"
+#include "SampleSource.h"
+#include "SeekCoordinator.h"
+
+namespace iolib {
+
+    SeekCoordinator::SeekCoordinator()
+            : mPending(false),
+              mCued(false),
+              mHolding(false),
+              mTargetFrame(0),
+              mMaxFrames(0),
+              mNumChannels(0)
+    {}
+
+    void SeekCoordinator::prepare(int32_t maxFrames, int32_t numChannels) {
+        if (maxFrames * numChannels > mMaxFrames * mNumChannels) {
+            mTargetBuffer.reset(new float[maxFrames * numChannels]);
+        }
+        mMaxFrames = maxFrames;
+        mNumChannels = numChannels;
+    }
+
+    void SeekCoordinator::requestSeek(int64_t frame) {
+        mPending = true;
+        mCued = false;
+        mTargetFrame = frame;
+    }
+
+    void SeekCoordinator::reset() {
+        mPending = false;
+        mCued = false;
+        mHolding = false;
+    }
+
+    void SeekCoordinator::cueTracks(SampleSource* const* tracks, int32_t numTracks) {
+        // Stopped tracks too, so that enabling one before the switch doesn't leave it behind
+        for (int32_t index = 0; index < numTracks; index++) {
+            if (tracks[index] != nullptr) {
+                tracks[index]->cueFrame(mTargetFrame);
+            }
+        }
+        mCued = true;
+    }
+
+    bool SeekCoordinator::areTracksCued(SampleSource* const* tracks, int32_t numTracks) {
+        for (int32_t index = 0; index < numTracks; index++) {
+            if (tracks[index] != nullptr && !tracks[index]->isCued()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SeekCoordinator::switchTracks(SampleSource* const* tracks, int32_t numTracks,
+                                       int64_t* transportFrame) {
+        for (int32_t index = 0; index < numTracks; index++) {
+            if (tracks[index] != nullptr) {
+                tracks[index]->switchToCue();
+            }
+        }
+        *transportFrame = mTargetFrame;
+        mPending = false;
+        mCued = false;
+        mHolding = false;
+    }
+
+    int32_t SeekCoordinator::getBufferedFrames(SampleSource* const* tracks, int32_t numTracks) {
+        int32_t numBuffered = INT32_MAX;
+        for (int32_t index = 0; index < numTracks; index++) {
+            SampleSource* track = tracks[index];
+            if (track != nullptr && track->isPlaying()) {
+                numBuffered = std::min(numBuffered, track->getBufferedFrames());
+            }
+        }
+        return numBuffered;
+    }
+
+    bool SeekCoordinator::mix(BusMixer* mixer, SampleSource* const* tracks, int32_t numTracks,
+                              float* outBuff, int32_t numChannels,
+                              int64_t* transportFrame, int32_t numFrames,
+                              ParallelMixer* parallelMixer, int32_t sampleRate) {
+        if (!mPending) {
+            mixer->mix(tracks, numTracks, outBuff, numChannels, *transportFrame, numFrames,
+                       parallelMixer, sampleRate);
+            return true;
+        }
+
+        if (!mCued) {
+            cueTracks(tracks, numTracks);
+        }
+        int32_t numFadeFrames = std::min(numFrames, kCrossfadeFrames);
+        const float kQuarterTurn = static_cast<float>(M_PI / 2.0);
+
+        if (areTracksCued(tracks, numTracks)) {
+            // Equal power, the old and new audio aren't correlated
+            bool fromOld = !mHolding && getBufferedFrames(tracks, numTracks) >= numFrames;
+            bool crossfade = numFrames <= mMaxFrames && numChannels == mNumChannels;
+            if (fromOld && crossfade) {
+                mixer->mix(tracks, numTracks, outBuff, numChannels, *transportFrame, numFrames,
+                           parallelMixer, sampleRate);
+            }
+            switchTracks(tracks, numTracks, transportFrame);
+            if (!crossfade) {
+                memset(outBuff, 0, static_cast<size_t>(numFrames) * numChannels * sizeof(float));
+                mixer->mix(tracks, numTracks, outBuff, numChannels, *transportFrame, numFrames,
+                           parallelMixer, sampleRate);
+                return true;
+            }
+
+            float* targetBuff = mTargetBuffer.get();
+            memset(targetBuff, 0, static_cast<size_t>(numFrames) * numChannels * sizeof(float));
+            mixer->mix(tracks, numTracks, targetBuff, numChannels, *transportFrame, numFrames,
+                       parallelMixer, sampleRate);
+            for (int32_t frame = 0; frame < numFrames; frame++) {
+                float fadeIn = 1.0f;
+                float fadeOut = 0.0f;
+                if (frame < numFadeFrames) {
+                    float phase = (frame + 0.5f) / numFadeFrames * kQuarterTurn;
+                    fadeIn = sinf(phase);
+                    fadeOut = cosf(phase);
+                }
+                for (int32_t channel = 0; channel < numChannels; channel++) {
+                    int32_t sample = frame * numChannels + channel;
+                    outBuff[sample] = outBuff[sample] * fadeOut + targetBuff[sample] * fadeIn;
+                }
+            }
+            return true;
+        }
+
+        if (mHolding) {
+            return false;
+        }
+
+        // Play on from the old position while the tracks have it
+        int32_t numBuffered = getBufferedFrames(tracks, numTracks);
+        mixer->mix(tracks, numTracks, outBuff, numChannels, *transportFrame, numFrames,
+                   parallelMixer, sampleRate);
+        if (numBuffered < 2 * numFrames) {
+            // Maybe the last whole block, fade out and wait for the target in silence
+            for (int32_t frame = 0; frame < numFrames; frame++) {
+                float fadeOut = frame < numFadeFrames
+                                ? cosf((frame + 0.5f) / numFadeFrames * kQuarterTurn)
+                                : 0.0f;
+                for (int32_t channel = 0; channel < numChannels; channel++) {
+                    outBuff[frame * numChannels + channel] *= fadeOut;
+                }
+            }
+            mHolding = true;
+        }
+        return true;
+    }
+
+    bool SeekCoordinator::switchIfCued(SampleSource* const* tracks, int32_t numTracks,
+                                       int64_t* transportFrame) {
+        if (!mPending) {
+            return false;
+        }
+        if (!mCued) {
+            cueTracks(tracks, numTracks);
+        }
+        if (!areTracksCued(tracks, numTracks)) {
+            return false;
+        }
+        switchTracks(tracks, numTracks, transportFrame);
+        return true;
+    }
+
+} // namespace iolib
@@ -0,0 +1,96 @@
+#ifndef _PLAYER_SEEKCOORDINATOR_H_
+#define _PLAYER_SEEKCOORDINATOR_H_
+
+#include <cstdint>
+#include <memory>
+
+namespace iolib {
+
+    class BusMixer;
+    class ParallelMixer;
+    class SampleSource;
+
+/**
+ * Moves the transport without stalling the audio thread or playing some tracks before others.
+ *
+ * A seek only asks every playing track to prefetch its target (SampleSource::cueFrame()), and
+ * the mix carries on from the old position meanwhile. Once every track is cued they all switch
+ * over in the same block, crossfading from the old position to the new one over
+ * kCrossfadeFrames. If a track runs out of old audio first, the mix fades out and holds the
+ * transport in silence until the switch, which then fades in. A seek requested before the
+ * switch replaces the pending one.
+ *
+ * prepare() allocates and is for the control thread. Everything else is for the audio thread,
+ * and never allocates or blocks.
+ */
+    class SeekCoordinator {
+    public:
+        // ~5ms at 48kHz
+        static constexpr int32_t kCrossfadeFrames = 256;
+
+        SeekCoordinator();
+
+        /**
+         * Sizes the buffer the target is mixed into for the crossfade. Larger blocks switch
+         * without one.
+         */
+        void prepare(int32_t maxFrames, int32_t numChannels);
+
+        /**
+         * Seeks to frame at the next mix() or switchIfCued().
+         */
+        void requestSeek(int64_t frame);
+
+        /**
+         * Forgets the pending seek, e.g. after the sources were reset.
+         */
+        void reset();
+
+        bool isPending() const { return mPending; }
+        int64_t getTargetFrame() const { return mTargetFrame; }
+
+        /**
+         * Starts the next mix() from silence rather than the old position, for a seek
+         * pending when the transport starts.
+         */
+        void holdUntilCued() { mHolding = mPending; }
+
+        /**
+         * Mixes numFrames frames of tracks at *transportFrame into outBuff (cleared by the
+         * caller) through mixer, as BusMixer::mix(), carrying out the pending seek when it is
+         * ready: then *transportFrame is set to the target, the block starting there. Returns
+         * false if the transport is held in silence and mustn't advance.
+         */
+        bool mix(BusMixer* mixer, SampleSource* const* tracks, int32_t numTracks,
+                 float* outBuff, int32_t numChannels,
+                 int64_t* transportFrame, int32_t numFrames,
+                 ParallelMixer* parallelMixer, int32_t sampleRate);
+
+        /**
+         * For a stopped transport: switches the tracks to the pending seek as soon as they are
+         * cued, without mixing, and sets *transportFrame to the target. Returns true if it did.
+         */
+        bool switchIfCued(SampleSource* const* tracks, int32_t numTracks, int64_t* transportFrame);
+
+    private:
+        bool mPending;
+        bool mCued;             // the tracks were asked to prefetch mTargetFrame
+        bool mHolding;          // faded out, waiting in silence
+        int64_t mTargetFrame;
+
+        // The target, mixed for the crossfade
+        std::unique_ptr<float[]> mTargetBuffer;
+        int32_t mMaxFrames;
+        int32_t mNumChannels;
+
+        void cueTracks(SampleSource* const* tracks, int32_t numTracks);
+        bool areTracksCued(SampleSource* const* tracks, int32_t numTracks);
+        void switchTracks(SampleSource* const* tracks, int32_t numTracks, int64_t* transportFrame);
+
+        // Frames every playing track can still play from the old position
+        int32_t getBufferedFrames(SampleSource* const* tracks, int32_t numTracks);
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_SEEKCOORDINATOR_H_
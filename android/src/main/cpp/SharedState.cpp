@@ -0,0 +1,55 @@
+#include "LevelMeters.h"
+#include "SharedState.h"
+
+namespace iolib {
+
+    static_assert(kSharedStateMaxTracks == LevelMeters::kMaxTracks
+                  && kSharedStateValuesPerTrack == LevelMeters::kValuesPerTrack,
+                  "The shared meters mirror LevelMeters");
+
+    SharedState::SharedState()
+            : mBlock(new SharedStateBlock()) {
+        mBlock->magic = kSharedStateMagic;
+        mBlock->version = kSharedStateVersion;
+        mBlock->sequence.store(0, std::memory_order_relaxed);
+        mBlock->numTracks.store(0, std::memory_order_relaxed);
+        mBlock->transportFrame.store(0, std::memory_order_relaxed);
+        mBlock->totalFrames.store(0, std::memory_order_relaxed);
+        mBlock->sampleRate.store(0, std::memory_order_relaxed);
+        mBlock->playing.store(0, std::memory_order_relaxed);
+        mBlock->xRunCount.store(0, std::memory_order_relaxed);
+        mBlock->reserved.store(0, std::memory_order_relaxed);
+        mBlock->meterFrame.store(0, std::memory_order_relaxed);
+        for (std::atomic<float>& value : mBlock->meters) {
+            value.store(0.0f, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void SharedState::publish(int64_t transportFrame, int64_t totalFrames, int32_t sampleRate,
+                              bool playing, int32_t xRunCount, const LevelMeters* meters) {
+        SharedStateBlock& block = *mBlock;
+        uint32_t sequence = block.sequence.load(std::memory_order_relaxed);
+        block.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        block.transportFrame.store(transportFrame, std::memory_order_relaxed);
+        block.totalFrames.store(totalFrames, std::memory_order_relaxed);
+        block.sampleRate.store(sampleRate, std::memory_order_relaxed);
+        block.playing.store(playing ? 1 : 0, std::memory_order_relaxed);
+        block.xRunCount.store(xRunCount, std::memory_order_relaxed);
+
+        if (meters != nullptr) {
+            float levels[kSharedStateMaxTracks * kSharedStateValuesPerTrack];
+            int32_t numTracks = meters->copyLevels(levels, kSharedStateMaxTracks);
+            for (int32_t index = 0; index < numTracks * kSharedStateValuesPerTrack; index++) {
+                block.meters[index].store(levels[index], std::memory_order_relaxed);
+            }
+            block.numTracks.store(numTracks, std::memory_order_relaxed);
+            block.meterFrame.store(meters->getFramesMeasured(), std::memory_order_relaxed);
+        }
+
+        block.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+} // namespace iolib
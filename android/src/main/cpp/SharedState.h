@@ -0,0 +1,86 @@
+#ifndef _PLAYER_SHAREDSTATE_H_
+#define _PLAYER_SHAREDSTATE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace iolib {
+
+    class LevelMeters;
+
+    static constexpr uint32_t kSharedStateMagic = 0x584d4e52;   // "RNMX"
+    static constexpr uint32_t kSharedStateVersion = 1;
+    static constexpr int32_t kSharedStateMaxTracks = 128;
+    static constexpr int32_t kSharedStateValuesPerTrack = 3;
+
+/**
+ * Engine state the UI polls, in one block of memory that is shared rather than queried: the
+ * audio thread writes it, and readers (Java through a direct ByteBuffer, or SharedStateReader)
+ * read it without any call into the engine.
+ *
+ * The layout is fixed, in native byte order, and changes bump kSharedStateVersion. The
+ * offsets are part of the ABI (the Kotlin module mirrors them), so fields are only ever
+ * appended.
+ *
+ * Writes are guarded by a sequence counter: odd while the writer is inside the block. A reader
+ * copies what it needs between two reads of an even, unchanged sequence, and otherwise retries.
+ */
+    struct SharedStateBlock {
+        uint32_t magic;                         // kSharedStateMagic
+        uint32_t version;                       // kSharedStateVersion
+        std::atomic<uint32_t> sequence;
+        std::atomic<int32_t> numTracks;         // tracks with meters
+
+        std::atomic<int64_t> transportFrame;
+        std::atomic<int64_t> totalFrames;
+        std::atomic<int32_t> sampleRate;
+        std::atomic<int32_t> playing;           // 1 while the transport runs
+        std::atomic<int32_t> xRunCount;         // as reported by the output stream
+        std::atomic<int32_t> reserved;
+
+        // Audio frames measured when the meters were last published, they change at the
+        // meter refresh rate only
+        std::atomic<int64_t> meterFrame;
+
+        // Per track, linear: peak, mean square, peak hold (see LevelMeters)
+        std::atomic<float> meters[kSharedStateMaxTracks * kSharedStateValuesPerTrack];
+    };
+
+    // The byte offsets shared with other languages
+    static_assert(offsetof(SharedStateBlock, sequence) == 8, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, numTracks) == 12, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, transportFrame) == 16, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, totalFrames) == 24, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, sampleRate) == 32, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, playing) == 36, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, xRunCount) == 40, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, meterFrame) == 48, "SharedStateBlock layout");
+    static_assert(offsetof(SharedStateBlock, meters) == 56, "SharedStateBlock layout");
+
+/**
+ * Owns a SharedStateBlock and writes it. There must be one writer thread at a time (the audio
+ * thread), the block itself may be read from anywhere for as long as the SharedState lives.
+ */
+    class SharedState {
+    public:
+        SharedState();
+
+        SharedStateBlock* getBlock() { return mBlock.get(); }
+        size_t getSize() const { return sizeof(SharedStateBlock); }
+
+        /**
+         * Writer thread: updates the transport fields, and the meters if meters isn't
+         * nullptr (when it has just published). Doesn't allocate or block.
+         */
+        void publish(int64_t transportFrame, int64_t totalFrames, int32_t sampleRate,
+                     bool playing, int32_t xRunCount, const LevelMeters* meters);
+
+    private:
+        std::unique_ptr<SharedStateBlock> mBlock;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_SHAREDSTATE_H_
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SharedStateReader.h"
+
+namespace iolib {
+
+    static float toDecibels(float amplitude) {
+        return amplitude > 0.0f
+               ? std::max(SharedStateReader::kSilenceDecibels, 20.0f * log10f(amplitude))
+               : SharedStateReader::kSilenceDecibels;
+    }
+
+    SharedStateReader::SharedStateReader(const void* block, size_t size)
+            : mBlock(nullptr) {
+        const SharedStateBlock* candidate = static_cast<const SharedStateBlock*>(block);
+        if (candidate != nullptr && size >= sizeof(SharedStateBlock)
+            && candidate->magic == kSharedStateMagic
+            && candidate->version == kSharedStateVersion) {
+            mBlock = candidate;
+        }
+    }
+
+    bool SharedStateReader::read(SharedStateSnapshot* snapshot, int32_t maxAttempts) const {
+        if (mBlock == nullptr) {
+            return false;
+        }
+
+        const SharedStateBlock& block = *mBlock;
+        SharedStateSnapshot copy;
+        float levels[kSharedStateMaxTracks * kSharedStateValuesPerTrack];
+        for (int32_t attempt = 0; attempt < maxAttempts; attempt++) {
+            uint32_t sequence = block.sequence.load(std::memory_order_acquire);
+            if (sequence & 1) {
+                continue;
+            }
+
+            copy.sequence = sequence;
+            copy.transportFrame = block.transportFrame.load(std::memory_order_relaxed);
+            copy.totalFrames = block.totalFrames.load(std::memory_order_relaxed);
+            copy.sampleRate = block.sampleRate.load(std::memory_order_relaxed);
+            copy.playing = block.playing.load(std::memory_order_relaxed) != 0;
+            copy.xRunCount = block.xRunCount.load(std::memory_order_relaxed);
+            copy.meterFrame = block.meterFrame.load(std::memory_order_relaxed);
+            copy.numTracks = std::max(0, std::min(block.numTracks.load(std::memory_order_relaxed),
+                                                  kSharedStateMaxTracks));
+            for (int32_t index = 0; index < copy.numTracks * kSharedStateValuesPerTrack; index++) {
+                levels[index] = block.meters[index].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (block.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+
+            // Consistent, the dB conversion can take its time
+            for (int32_t track = 0; track < copy.numTracks; track++) {
+                const float* level = levels + track * kSharedStateValuesPerTrack;
+                float* meter = copy.meters + track * kSharedStateValuesPerTrack;
+                meter[0] = toDecibels(level[0]);
+                meter[1] = toDecibels(sqrtf(level[1]));
+                meter[2] = toDecibels(level[2]);
+            }
+            *snapshot = copy;
+            return true;
+        }
+        return false;
+    }
+
+    bool SharedStateReader::hasChanged(const SharedStateSnapshot& snapshot) const {
+        return mBlock != nullptr
+               && mBlock->sequence.load(std::memory_order_acquire) != snapshot.sequence;
+    }
+
+} // namespace iolib
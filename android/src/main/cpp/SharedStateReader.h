@@ -0,0 +1,62 @@
+#ifndef _PLAYER_SHAREDSTATEREADER_H_
+#define _PLAYER_SHAREDSTATEREADER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SharedState.h"
+
+namespace iolib {
+
+    /**
+     * A consistent copy of a SharedStateBlock. Meters are in dBFS.
+     */
+    struct SharedStateSnapshot {
+        uint32_t sequence;
+        int64_t transportFrame;
+        int64_t totalFrames;
+        int32_t sampleRate;
+        bool playing;
+        int32_t xRunCount;
+        int64_t meterFrame;
+        int32_t numTracks;
+
+        // Per track: peak, RMS, peak hold
+        float meters[kSharedStateMaxTracks * kSharedStateValuesPerTrack];
+    };
+
+/**
+ * Reads a SharedStateBlock from any thread, or process, that can see its memory. Needs nothing
+ * but the block, so it also serves host-side tools and tests.
+ */
+    class SharedStateReader {
+    public:
+        // The dBFS reported for silence, as LevelMeters
+        static constexpr float kSilenceDecibels = -100.0f;
+
+        /**
+         * block: the shared memory, size bytes long. isValid() tells whether it holds a block
+         * of this layout.
+         */
+        SharedStateReader(const void* block, size_t size);
+
+        bool isValid() const { return mBlock != nullptr; }
+
+        /**
+         * Copies the state into snapshot. Returns false if the writer kept overtaking the
+         * copy (or the block isn't valid), snapshot is then unchanged.
+         */
+        bool read(SharedStateSnapshot* snapshot, int32_t maxAttempts = 8) const;
+
+        /**
+         * True if the block may have changed since snapshot was read, without copying it.
+         */
+        bool hasChanged(const SharedStateSnapshot& snapshot) const;
+
+    private:
+        const SharedStateBlock* mBlock;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_SHAREDSTATEREADER_H_
@@ -14,13 +14,20 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <android/log.h>
 
 // parselib includes
+#include "stream/FileOutputStream.h"
 #include "wav/WavStreamReader.h"
 
 // local includes
+#include "OfflineRenderer.h"
+#include "RealtimeAllocationCheck.h"
 #include "SimpleMultiPlayer.h"
+#include "Telemetry.h"
 
 #include "fstream"
 #include "stream/FileInputStream.h"
@@ -34,35 +41,91 @@ using namespace parselib;
 
 namespace iolib {
 
-    constexpr int32_t kBufferSizeInBursts = 2; // Use 2 bursts as the buffer size (double buffer)
-
     SimpleMultiPlayer::SimpleMultiPlayer()
-            : mChannelCount(0), mOutputReset(false), mSampleRate(0), mNumSampleSources(0), position(0)
-    {}
+            : mChannelCount(0), mOutputReset(false), mSampleRate(0), mMaxFramesPerCallback(0),
+              mResamplerQuality(ResamplerQuality::Medium), mNumSampleSources(0),
+              mMixSources(kMaxSampleSources, nullptr), mTransportFrame(0), mTransportRunning(false),
+              mPublishedFrame(0), mTotalFrames(0), mMixdownProgress(0.0f), mMixdownSpeed(0.0f),
+              mLatencyTunable(false),
+              mUnretiredSchedule(nullptr), mFencesQueued(0), mFenceAcknowledged(0)
+    {
+        for (int32_t index = 0; index < kMaxSampleSources; index++) {
+            mSampleSources[index].store(nullptr, std::memory_order_relaxed);
+        }
+    }
 
     DataCallbackResult SimpleMultiPlayer::MyDataCallback::onAudioReady(AudioStream *oboeStream,
                                                                        void *audioData,
                                                                        int32_t numFrames) {
+        // Debug builds can verify that nothing below touches the heap
+        ScopedRealtimeSection realtimeSection;
+        mParent->mProfiler.beginCallback();
+
         StreamState streamState = oboeStream->getState();
         if (streamState != StreamState::Open && streamState != StreamState::Started) {
-            __android_log_print(ANDROID_LOG_ERROR, TAG, "  streamState:%d", streamState);
+            TELEMETRY_ERROR(TelemetryEvent::StreamState, -1, static_cast<float>(streamState));
         }
         if (streamState == StreamState::Disconnected) {
-            __android_log_print(ANDROID_LOG_ERROR, TAG, "  streamState::Disconnected");
+            TELEMETRY_ERROR(TelemetryEvent::StreamDisconnected, -1);
         }
 
+        // Apply any pending parameter/transport changes at the block boundary
+        mParent->processCommands();
+
         memset(audioData, 0, static_cast<size_t>(numFrames) * static_cast<size_t>(mParent->mChannelCount) * sizeof(float));
 
-        for(int32_t index = 0; index < mParent->mNumSampleSources; index++) {
-            if (mParent->mSampleSources[index]->isPlaying()) {
-                mParent->mSampleSources[index]->mixAudio(
-                    (float*)audioData,
-                    mParent->mChannelCount,
-                    numFrames
-                );
+        // Tracks still loading have no source yet (nullptr), the BusMixer skips them
+        int32_t numSampleSources = mParent->mNumSampleSources.load(std::memory_order_acquire);
+        for (int32_t index = 0; index < numSampleSources; index++) {
+            mParent->mMixSources[index] =
+                    mParent->mSampleSources[index].load(std::memory_order_acquire);
+        }
+
+        if (!mParent->mTransportRunning) {
+            // A seek while stopped takes effect once the tracks are ready
+            if (mParent->mSeekCoordinator.switchIfCued(mParent->mMixSources.data(),
+                                                       numSampleSources,
+                                                       &mParent->mTransportFrame)) {
+                mParent->mPublishedFrame.store(mParent->mTransportFrame, std::memory_order_relaxed);
             }
+            // Stopped blocks still count, so the meters fall back
+            bool metersPublished = mParent->mMeters.endBlock(numFrames);
+            mParent->finishCallback(oboeStream, numFrames, metersPublished);
+            return DataCallbackResult::Continue;
         }
 
+        bool advanced = mParent->mSeekCoordinator.mix(&mParent->mBusMixer,
+                                                      mParent->mMixSources.data(), numSampleSources,
+                                                      (float*)audioData, mParent->mChannelCount,
+                                                      &mParent->mTransportFrame, numFrames,
+                                                      &mParent->mParallelMixer, mParent->mSampleRate);
+
+        for (int32_t index = 0; index < numSampleSources; index++) {
+            SampleSource* source = mParent->mMixSources[index];
+            if (source != nullptr) {
+                mParent->mProfiler.addTrackCost(index, source->takeMixNanos());
+            }
+            if (source != nullptr && source->isPlaying()) {
+                float gain = source->getGain();
+                mParent->mMeters.addLevel(index, source->getLastPeak() * fabsf(gain),
+                                          source->getLastMeanSquare() * gain * gain);
+            }
+        }
+        bool metersPublished = mParent->mMeters.endBlock(numFrames);
+        if (metersPublished) {
+            // Once per meter refresh, not per block: per block, 40 stems would flood the ring
+            for (int32_t index = 0; index < numSampleSources; index++) {
+                SampleSource* source = mParent->mMixSources[index];
+                if (source != nullptr && source->isPlaying()) {
+                    TELEMETRY_DEBUG(TelemetryEvent::TrackLevel, index, source->getLastPeak(),
+                                    source->getLastMeanSquare(), source->getGain());
+                }
+            }
+        }
+
+        mParent->advanceTransport(advanced ? numFrames : 0);
+        mParent->finishCallback(oboeStream, numFrames, metersPublished);
+
         return DataCallbackResult::Continue;
     }
 
@@ -75,14 +138,166 @@ namespace iolib {
         }
     }
 
-    void SimpleMultiPlayer::setPosition(float position) {
-        this->position = position;
-        // set data position for each source stream
-        for(int32_t index = 0; index < mNumSampleSources; index++) {
-            mSampleSources[index]->setPosition(position);
+    bool SimpleMultiPlayer::pushCommand(PlayerCommand::Type type, int32_t index, float value,
+                                        int64_t frame) {
+        if (!pushCommand({ type, index, value, frame, nullptr })) {
+            __android_log_print(ANDROID_LOG_WARN, TAG, "command queue full, dropped command:%d", type);
+            return false;
+        }
+        return true;
+    }
+
+    bool SimpleMultiPlayer::pushCommand(const PlayerCommand& command) {
+        // JNI threads, bus edits and Oboe's error thread all push, the queue takes one at a time
+        std::lock_guard<std::mutex> lock(mCommandLock);
+        return mCommandQueue.push(command);
+    }
+
+    void SimpleMultiPlayer::processCommands() {
+        if (mUnretiredSchedule != nullptr && mRetiredSchedules.push(mUnretiredSchedule)) {
+            mUnretiredSchedule = nullptr;
+        }
+        PlayerCommand command;
+        while (mCommandQueue.pop(command)) {
+            applyCommand(command);
+        }
+    }
+
+    void SimpleMultiPlayer::applyCommand(const PlayerCommand& command) {
+        switch (command.type) {
+            case PlayerCommand::TransportStart:
+                if (!mSeekCoordinator.isPending()
+                        && mTransportFrame >= mTotalFrames.load(std::memory_order_relaxed)) {
+                    mSeekCoordinator.requestSeek(0); // restart from the top once the end was reached
+                }
+                // Not from the old position, which was left on purpose
+                mSeekCoordinator.holdUntilCued();
+                mTransportRunning = true;
+                mPublishedFrame.store(getReportedFrame(), std::memory_order_relaxed);
+                return;
+
+            case PlayerCommand::TransportStop:
+                mTransportRunning = false;
+                return;
+
+            case PlayerCommand::TransportSeek:
+                // The tracks prefetch the target while the old position plays on
+                mSeekCoordinator.requestSeek(std::max<int64_t>(0, command.frame));
+                mPublishedFrame.store(getReportedFrame(), std::memory_order_relaxed);
+                return;
+
+            case PlayerCommand::SetBusGain:
+                mBusMixer.setBusGain(command.index, command.value);
+                return;
+
+            case PlayerCommand::SetBusPan:
+                mBusMixer.setBusPan(command.index, command.value);
+                return;
+
+            case PlayerCommand::SetBusMute:
+                mBusMixer.setBusMute(command.index, command.value != 0.0f);
+                return;
+
+            case PlayerCommand::Fence:
+                mFenceAcknowledged.store(command.frame, std::memory_order_release);
+                return;
+
+            case PlayerCommand::SetSchedule: {
+                const MixSchedule* previous = mBusMixer.setSchedule(command.schedule);
+                if (previous != nullptr && !mRetiredSchedules.push(previous)) {
+                    // Can't happen with the queues sized alike, but never leak one: the next
+                    // block hands it back
+                    mUnretiredSchedule = previous;
+                }
+                return;
+            }
+
+            default:
+                break;
+        }
+
+        if (command.index < 0 || command.index >= mNumSampleSources.load(std::memory_order_acquire)) {
+            return; // the source was unloaded after the command was queued
+        }
+
+        SampleSource* source = mSampleSources[command.index].load(std::memory_order_acquire);
+        if (source == nullptr) {
+            return; // not loaded yet
+        }
+        switch (command.type) {
+            case PlayerCommand::SetGain:
+                source->setGain(command.value);
+                break;
+
+            case PlayerCommand::SetPan:
+                source->setPan(command.value);
+                break;
+
+            case PlayerCommand::Play:
+                source->setPlayMode();
+                break;
+
+            case PlayerCommand::Stop:
+                source->setStopMode();
+                break;
+
+            default:
+                break;
         }
     }
 
+    void SimpleMultiPlayer::finishCallback(AudioStream* stream, int32_t numFrames,
+                                           bool metersPublished) {
+        // Not every stream counts xruns (OpenSL ES doesn't)
+        ResultWithValue<int32_t> xRunCount = stream->getXRunCount();
+        int32_t numXRuns = xRunCount ? xRunCount.value() : -1;
+        if (mProfiler.endCallback(numFrames, mSampleRate, numXRuns)) {
+            TELEMETRY_WARN(TelemetryEvent::LateCallback, -1, mProfiler.getLastWallLoad(),
+                           static_cast<float>(numFrames));
+        }
+
+        if (mLatencyTunable) {
+            int32_t bufferFrames = mLatencyTuner.update(numXRuns, numFrames);
+            if (bufferFrames != mLatencyTuner.getBufferSizeInFrames()) {
+                // As oboe::LatencyTuner does, from the callback. The stream rounds and clamps.
+                ResultWithValue<int32_t> result = stream->setBufferSizeInFrames(bufferFrames);
+                mLatencyTuner.setActualBufferSize(result ? result.value()
+                                                         : stream->getBufferSizeInFrames());
+            }
+        }
+
+        mSharedState.publish(getReportedFrame(), mTotalFrames.load(std::memory_order_relaxed),
+                             mSampleRate, mTransportRunning, std::max(0, numXRuns),
+                             metersPublished ? &mMeters : nullptr);
+    }
+
+    void SimpleMultiPlayer::advanceTransport(int32_t numFrames) {
+        mTransportFrame += numFrames;
+        if (mTransportFrame >= mTotalFrames.load(std::memory_order_relaxed)
+                && !mSeekCoordinator.isPending()) {
+            // Ran off the end of the longest source
+            mTransportFrame = mTotalFrames.load(std::memory_order_relaxed);
+            mTransportRunning = false;
+        }
+        mPublishedFrame.store(getReportedFrame(), std::memory_order_relaxed);
+    }
+
+    void SimpleMultiPlayer::startTransport() {
+        pushCommand(PlayerCommand::TransportStart, -1, 0.0f);
+    }
+
+    void SimpleMultiPlayer::stopTransport() {
+        pushCommand(PlayerCommand::TransportStop, -1, 0.0f);
+    }
+
+    void SimpleMultiPlayer::seekToFrame(int64_t frame) {
+        pushCommand(PlayerCommand::TransportSeek, -1, 0.0f, frame);
+    }
+
+    void SimpleMultiPlayer::setPosition(float position) {
+        seekToFrame(static_cast<int64_t>(position * getTotalFrames()));
+    }
+
     bool SimpleMultiPlayer::openStream() {
         __android_log_print(ANDROID_LOG_INFO, TAG, "openStream()");
 
@@ -93,12 +308,13 @@ namespace iolib {
         // Create an audio stream
         AudioStreamBuilder builder;
         builder.setChannelCount(mChannelCount);
-        // we will resample source data to device rate, so take default sample rate
+        // Take the device's native rate, the sources are resampled to it by the engine so the
+        // stream needs no framework conversion (and can get the low latency path)
         builder.setDataCallback(mDataCallback);
         builder.setErrorCallback(mErrorCallback);
         builder.setPerformanceMode(PerformanceMode::LowLatency);
         builder.setSharingMode(SharingMode::Exclusive);
-        builder.setSampleRateConversionQuality(SampleRateConversionQuality::Medium);
+        builder.setSampleRateConversionQuality(SampleRateConversionQuality::None);
 
         Result result = builder.openStream(mAudioStream);
         if (result != Result::OK){
@@ -109,20 +325,71 @@ namespace iolib {
             return false;
         }
 
-        // Reduce stream latency by setting the buffer size to a multiple of the burst size
+        // Reduce stream latency by setting the buffer size to a multiple of the burst size,
+        // starting as small as the tuner allows and growing it on xruns
         // Note: this will fail with ErrorUnimplemented if we are using a callback with OpenSL ES
         // See oboe::AudioStreamBuffered::setBufferSizeInFrames
-        result = mAudioStream->setBufferSizeInFrames(
-                mAudioStream->getFramesPerBurst() * kBufferSizeInBursts);
-        if (result != Result::OK) {
+        int32_t bufferFrames = mLatencyTuner.reset(mAudioStream->getFramesPerBurst(),
+                                                   mAudioStream->getBufferCapacityInFrames(),
+                                                   mAudioStream->getSampleRate());
+        ResultWithValue<int32_t> bufferResult = mAudioStream->setBufferSizeInFrames(bufferFrames);
+        if (bufferResult) {
+            mLatencyTuner.setActualBufferSize(bufferResult.value());
+        } else {
             __android_log_print(
                     ANDROID_LOG_WARN,
                     TAG,
-                    "setBufferSizeInFrames failed. Error: %s", convertToText(result));
+                    "setBufferSizeInFrames failed. Error: %s",
+                    convertToText(bufferResult.error()));
+            mLatencyTuner.setActualBufferSize(mAudioStream->getBufferSizeInFrames());
         }
+        // Tuning needs both a settable buffer and an xrun count to follow
+        mLatencyTunable = bufferResult && mAudioStream->getXRunCount();
 
+        int32_t previousSampleRate = mSampleRate;
         mSampleRate = mAudioStream->getSampleRate();
 
+        // The stream isn't started yet, so it is safe to reconfigure the sources here.
+        // Oboe never asks for more than the buffer capacity in a single callback.
+        mMaxFramesPerCallback = std::max(mAudioStream->getBufferCapacityInFrames(),
+                                         mAudioStream->getFramesPerBurst()
+                                         * LatencyTuner::kFallbackBursts);
+        mParallelMixer.prepare(mMaxFramesPerCallback, mChannelCount);
+        mBusMixer.prepare(mMaxFramesPerCallback, mChannelCount);
+        mSeekCoordinator.prepare(mMaxFramesPerCallback, mChannelCount);
+        mMeters.setSampleRate(mSampleRate);
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        int64_t totalFrames = 0;
+        for (int32_t index = 0; index < mNumSampleSources.load(); index++) {
+            SampleSource* source = mSampleSources[index].load();
+            if (source == nullptr) {
+                continue;
+            }
+            source->prepareToPlay(mMaxFramesPerCallback, mChannelCount);
+            if (source->isStreaming()) {
+                mDiskStreamer.removeSource(source);
+                configureSource(source);
+                mDiskStreamer.addSource(source);
+            } else {
+                configureSource(source);
+            }
+            totalFrames = std::max<int64_t>(totalFrames, source->getNumFrames());
+        }
+        mTotalFrames.store(totalFrames, std::memory_order_relaxed);
+
+        // The sources were moved back to frame 0, so a pending seek is now a plain jump that
+        // they catch up with on their own
+        if (mSeekCoordinator.isPending()) {
+            mTransportFrame = mSeekCoordinator.getTargetFrame();
+            mSeekCoordinator.reset();
+        }
+
+        // Keep the transport at the same time if the device rate changed
+        if (previousSampleRate != 0 && previousSampleRate != mSampleRate) {
+            mTransportFrame = mTransportFrame * mSampleRate / previousSampleRate;
+            mPublishedFrame.store(mTransportFrame, std::memory_order_relaxed);
+        }
+
         return true;
     }
 
@@ -158,6 +425,10 @@ namespace iolib {
     __android_log_print(ANDROID_LOG_INFO, TAG, "setupAudioStream()");
     mChannelCount = channelCount;
 
+    Telemetry::getInstance().start();
+    mDiskStreamer.start();
+    mParallelMixer.start();
+
     openStream();
 }
 
@@ -169,36 +440,173 @@ void SimpleMultiPlayer::teardownAudioStream() {
         mAudioStream->close();
         mAudioStream.reset();
     }
+
+    mParallelMixer.stop();
+    mDiskStreamer.stop();
+    Telemetry::getInstance().stop();
 }
 
-void SimpleMultiPlayer::addSampleSource(SampleSource* source) {
-    mSampleSources.push_back(source);
-    mNumSampleSources++;
+void SimpleMultiPlayer::configureSource(SampleSource* source) {
+    if (mSampleRate > 0) {
+        source->setOutputSampleRate(mSampleRate, mResamplerQuality);
+    }
+}
+
+int32_t SimpleMultiPlayer::addSampleSource(SampleSource* source) {
+    int32_t index;
+    {
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        index = mNumSampleSources.load();
+        if (index >= kMaxSampleSources) {
+            return -1;
+        }
+        mNumSampleSources.store(index + 1, std::memory_order_release);
+    }
+    publishSampleSource(index, source);
+    return index;
+}
+
+int32_t SimpleMultiPlayer::loadSampleSources(const std::vector<std::string>& fileNames,
+                                             float pan, LoadPolicy loadPolicy) {
+    // Let a previous batch finish before reserving after it
+    mTrackLoader.wait();
+
+    int32_t firstIndex;
+    {
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        firstIndex = mNumSampleSources.load();
+        int32_t numSources = static_cast<int32_t>(fileNames.size());
+        if (firstIndex + numSources > kMaxSampleSources) {
+            return -1;
+        }
+        mNumSampleSources.store(firstIndex + numSources, std::memory_order_release);
+    }
+
+    mTrackLoader.start(fileNames, pan, loadPolicy,
+                       [this, firstIndex](int32_t batchIndex, SampleSource* source) {
+                           publishSampleSource(firstIndex + batchIndex, source);
+                       });
+    return firstIndex;
+}
+
+void SimpleMultiPlayer::publishSampleSource(int32_t index, SampleSource* source) {
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    if (mMaxFramesPerCallback > 0) {
+        source->prepareToPlay(mMaxFramesPerCallback, mChannelCount);
+    }
+    configureSource(source);
+    if (source->isStreaming()) {
+        mDiskStreamer.addSource(source);
+    }
+
+    // Fully set up before the audio thread can see it
+    mSampleSources[index].store(source, std::memory_order_release);
+
+    if (source->getNumFrames() > mTotalFrames.load(std::memory_order_relaxed)) {
+        mTotalFrames.store(source->getNumFrames(), std::memory_order_relaxed);
+    }
+}
+
+SampleSource* SimpleMultiPlayer::getSampleSource(int32_t index) {
+    if (index < 0 || index >= mNumSampleSources.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return mSampleSources[index].load(std::memory_order_acquire);
+}
+
+float SimpleMultiPlayer::getDuration(int32_t index) {
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    SampleSource* source = getSampleSource(index);
+    return source != nullptr ? source->getDuration() : 0.0f;
+}
+
+bool SimpleMultiPlayer::getWaveform(int32_t index, int64_t startFrame, int64_t endFrame,
+                                    int32_t numPeaks, PeakPyramid::Peak* peaks) {
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    SampleSource* source = getSampleSource(index);
+    if (source == nullptr) {
+        return false;
+    }
+    source->getWaveform(startFrame, endFrame, numPeaks, peaks);
+    return true;
+}
+
+void SimpleMultiPlayer::waitForAudioThread() {
+    std::unique_lock<std::mutex> commandLock(mCommandLock);
+    int64_t fence = ++mFencesQueued;
+    bool queued = mCommandQueue.push({ PlayerCommand::Fence, -1, 0.0f, fence, nullptr });
+    commandLock.unlock();
+
+    // A few callbacks' worth, the stream may be about to stop by itself
+    for (int32_t tries = 0; queued && tries < 200; tries++) {
+        if (mFenceAcknowledged.load(std::memory_order_acquire) >= fence) {
+            return;
+        }
+        if (!mAudioStream || mAudioStream->getState() != StreamState::Started) {
+            break;
+        }
+        usleep(1000);
+    }
+
+    // Not calling back (paused, stopped, no stream) or stuck: stop() returns once no callback
+    // is running, then nothing else consumes the queue until the stream is started again
+    bool restart = false;
+    if (mAudioStream) {
+        StreamState state = mAudioStream->getState();
+        restart = state == StreamState::Starting || state == StreamState::Started;
+        mAudioStream->stop();
+    }
+    if (mFenceAcknowledged.load(std::memory_order_acquire) < fence) {
+        commandLock.lock();
+        processCommands();
+        mFenceAcknowledged.store(fence, std::memory_order_release);
+        commandLock.unlock();
+    }
+    if (restart) {
+        mAudioStream->start();
+    }
 }
 
 void SimpleMultiPlayer::unloadSampleData() {
     __android_log_print(ANDROID_LOG_INFO, TAG, "unloadSampleData()");
+    mTrackLoader.cancel();
+    mTrackLoader.wait();
+
     resetAll();
+    mDiskStreamer.removeAllSources();
+
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    int32_t numSampleSources = mNumSampleSources.load();
+    SampleSource* unloaded[kMaxSampleSources];
+    mNumSampleSources.store(0, std::memory_order_release);
+    for (int32_t i = 0; i < numSampleSources; i++) {
+        unloaded[i] = mSampleSources[i].exchange(nullptr);
+    }
 
-    for (int32_t i = 0; i < mNumSampleSources; i++) {
-        delete mSampleSources[i];
+    // The block in progress may still be mixing them, and the Stops resetAll() queued must be
+    // applied before the track numbers are reused
+    waitForAudioThread();
+    for (int32_t i = 0; i < numSampleSources; i++) {
+        delete unloaded[i];
     }
 
-    mSampleSources.clear();
+    mTotalFrames.store(0, std::memory_order_relaxed);
 
-    mNumSampleSources = 0;
+    // Track numbers will be reused, the buses stay
+    std::lock_guard<std::mutex> busLock(mBusLock);
+    mBusGraph.resetTrackRouting();
+    updateSchedule();
 }
 
 void SimpleMultiPlayer::triggerDown(int32_t index) {
-    if (index < mNumSampleSources) {
-        mSampleSources[index]->setPlayMode();
-        mSampleSources[index]->setPosition(0);
+    if (index < getNumSampleSources()) {
+        pushCommand(PlayerCommand::Play, index, 0.0f);
     }
 }
 
 void SimpleMultiPlayer::triggerUp(int32_t index) {
-    if (index < mNumSampleSources) {
-        mSampleSources[index]->setStopMode();
+    if (index < getNumSampleSources()) {
+        pushCommand(PlayerCommand::Stop, index, 0.0f);
     }
 }
 
@@ -211,25 +619,218 @@ void SimpleMultiPlayer::resume() {
 }
 
 void SimpleMultiPlayer::resetAll() {
-    for (int32_t i = 0; i < mNumSampleSources; i++) {
-        mSampleSources[i]->setStopMode();
+    stopTransport();
+    seekToFrame(0);
+    for (int32_t i = 0; i < getNumSampleSources(); i++) {
+        pushCommand(PlayerCommand::Stop, i, 0.0f);
     }
 }
 
 void SimpleMultiPlayer::setPan(int index, float pan) {
-    mSampleSources[index]->setPan(pan);
+    pushCommand(PlayerCommand::SetPan, index, pan);
 }
 
 float SimpleMultiPlayer::getPan(int index) {
-    return mSampleSources[index]->getPan();
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    SampleSource* source = getSampleSource(index);
+    return source != nullptr ? source->getPan() : SampleSource::PAN_CENTER;
 }
 
 void SimpleMultiPlayer::setGain(int index, float gain) {
-    mSampleSources[index]->setGain(gain);
+    pushCommand(PlayerCommand::SetGain, index, gain);
 }
 
 float SimpleMultiPlayer::getGain(int index) {
-    return mSampleSources[index]->getGain();
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    SampleSource* source = getSampleSource(index);
+    return source != nullptr ? source->getGain() : 1.0f;
 }
 
-}
\ No newline at end of file
+void SimpleMultiPlayer::setStreamingWatermarks(int32_t lowWatermarkFrames,
+                                               int32_t highWatermarkFrames) {
+    mDiskStreamer.setWatermarks(lowWatermarkFrames, highWatermarkFrames);
+}
+
+uint32_t SimpleMultiPlayer::getStarvationCount(int index) {
+    std::lock_guard<std::mutex> lock(mSourcesLock);
+    SampleSource* source = getSampleSource(index);
+    return source != nullptr ? source->getStarvationCount() : 0;
+}
+
+void SimpleMultiPlayer::updateSchedule() {
+    const MixSchedule* retired;
+    while (mRetiredSchedules.pop(retired)) {
+        delete retired;
+    }
+
+    auto schedule = new MixSchedule;
+    mBusGraph.compile(schedule);
+    if (!pushCommand({ PlayerCommand::SetSchedule, -1, 0.0f, 0, schedule })) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "command queue full, dropped bus routing");
+        delete schedule;
+    }
+}
+
+int32_t SimpleMultiPlayer::createBus() {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    int32_t bus = mBusGraph.createBus();
+    if (bus >= 0) {
+        // Reset whatever a previous bus with this id left in the mixer
+        pushCommand(PlayerCommand::SetBusGain, bus, 1.0f);
+        pushCommand(PlayerCommand::SetBusPan, bus, 0.0f);
+        pushCommand(PlayerCommand::SetBusMute, bus, 0.0f);
+        updateSchedule();
+    }
+    return bus;
+}
+
+bool SimpleMultiPlayer::removeBus(int32_t bus) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (!mBusGraph.removeBus(bus)) {
+        return false;
+    }
+    updateSchedule();
+    return true;
+}
+
+bool SimpleMultiPlayer::setBusOutput(int32_t bus, int32_t outputBus) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (!mBusGraph.setBusOutput(bus, outputBus)) {
+        return false;
+    }
+    updateSchedule();
+    return true;
+}
+
+bool SimpleMultiPlayer::setTrackBus(int32_t track, int32_t bus) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (!mBusGraph.setTrackBus(track, bus)) {
+        return false;
+    }
+    updateSchedule();
+    return true;
+}
+
+void SimpleMultiPlayer::setBusGain(int32_t bus, float gain) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (mBusGraph.isBus(bus)) {
+        mBusGraph.getParameters(bus).gain = gain;
+        pushCommand(PlayerCommand::SetBusGain, bus, gain);
+    }
+}
+
+void SimpleMultiPlayer::setBusPan(int32_t bus, float pan) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (mBusGraph.isBus(bus)) {
+        mBusGraph.getParameters(bus).pan = std::max(-1.0f, std::min(pan, 1.0f));
+        pushCommand(PlayerCommand::SetBusPan, bus, pan);
+    }
+}
+
+void SimpleMultiPlayer::setBusMute(int32_t bus, bool muted) {
+    std::lock_guard<std::mutex> lock(mBusLock);
+    if (mBusGraph.isBus(bus)) {
+        mBusGraph.getParameters(bus).muted = muted;
+        pushCommand(PlayerCommand::SetBusMute, bus, muted ? 1.0f : 0.0f);
+    }
+}
+
+bool SimpleMultiPlayer::renderMixdown(const char* path, WavStreamWriter::Format format) {
+    // Render from our own copies of the tracks so playback is left alone. Only their settings
+    // are taken under the lock: opening the files (parsing, maybe preloading and building peaks)
+    // would hold up loading and unloading. Preloaded files come straight out of the
+    // SampleBufferCache.
+    struct TrackSettings {
+        int32_t index;
+        std::string fileName;
+        float pan;
+        float gain;
+        LoadPolicy loadPolicy;
+    };
+    std::vector<TrackSettings> tracks;
+    int32_t sampleRate = mSampleRate;
+    {
+        std::lock_guard<std::mutex> lock(mSourcesLock);
+        for (int32_t index = 0; index < mNumSampleSources.load(); index++) {
+            SampleSource* liveSource = mSampleSources[index].load();
+            if (liveSource == nullptr) {
+                continue; // still loading
+            }
+            tracks.push_back({ index, liveSource->getFileName(), liveSource->getPan(),
+                               liveSource->getGain(),
+                               liveSource->isStreaming() ? LoadPolicy::Stream
+                                                         : LoadPolicy::Preload });
+            if (sampleRate <= 0) {
+                sampleRate = liveSource->getSampleRate();
+            }
+        }
+    }
+    if (tracks.empty() || sampleRate <= 0) {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<SampleSource>> sources;
+    std::vector<int32_t> trackIndices;
+    for (const TrackSettings& track : tracks) {
+        auto source = std::make_unique<SampleSource>(track.fileName.c_str(), track.pan,
+                                                     track.loadPolicy);
+        if (source->getNumChannels() <= 0) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "renderMixdown() can't open %s",
+                                track.fileName.c_str());
+            return false;
+        }
+        source->setGain(track.gain);
+        source->setPlayMode();
+        sources.push_back(std::move(source));
+        trackIndices.push_back(track.index);
+    }
+
+    int fileDescriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "renderMixdown() can't create %s", path);
+        return false;
+    }
+
+    OfflineRenderer renderer(mChannelCount > 0 ? mChannelCount : 2, sampleRate);
+    renderer.setResamplerQuality(mResamplerQuality);
+    for (auto& source : sources) {
+        renderer.addSampleSource(source.get());
+    }
+
+    // The renderer numbers the tracks in the order they were added
+    {
+        std::lock_guard<std::mutex> busLock(mBusLock);
+        MixSchedule schedule;
+        mBusGraph.compile(&schedule);
+        for (size_t index = 0; index < trackIndices.size(); index++) {
+            schedule.trackBus[index] = schedule.trackBus[trackIndices[index]];
+        }
+        BusParameters parameters[kMaxBuses];
+        for (int32_t bus = 0; bus < kMaxBuses; bus++) {
+            parameters[bus] = mBusGraph.getParameters(bus);
+        }
+        renderer.setBusRouting(schedule, parameters);
+    }
+
+    mMixdownProgress.store(0.0f, std::memory_order_relaxed);
+    mMixdownSpeed.store(0.0f, std::memory_order_relaxed);
+    renderer.setProgressCallback([this](const OfflineRenderer::Progress& progress) {
+        mMixdownProgress.store(progress.totalFrames > 0
+                               ? progress.framesRendered / (float) progress.totalFrames
+                               : 1.0f, std::memory_order_relaxed);
+        mMixdownSpeed.store(static_cast<float>(progress.realtimeMultiple),
+                            std::memory_order_relaxed);
+    });
+
+    FileOutputStream stream(fileDescriptor);
+    WavStreamWriter writer(&stream, mChannelCount > 0 ? mChannelCount : 2, sampleRate, format);
+    bool result = renderer.render(&writer);
+    close(fileDescriptor);
+
+    __android_log_print(ANDROID_LOG_INFO, TAG, "renderMixdown() %lld frames at %.1fx realtime",
+                        (long long) renderer.getLastProgress().framesRendered,
+                        renderer.getLastProgress().realtimeMultiple);
+    return result;
+}
+
+}
@@ -17,11 +17,26 @@
 #ifndef _PLAYER_SIMPLEMULTIPLAYER_H_
 #define _PLAYER_SIMPLEMULTIPLAYER_H_
 
+#include <atomic>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <oboe/Oboe.h>
 
+#include "BusGraph.h"
+#include "BusMixer.h"
+#include "CallbackProfiler.h"
+#include "DiskStreamer.h"
+#include "LatencyTuner.h"
+#include "LevelMeters.h"
+#include "LockFreeQueue.h"
+#include "ParallelMixer.h"
 #include "SampleSource.h"
+#include "SeekCoordinator.h"
+#include "SharedState.h"
+#include "TrackLoader.h"
+#include "wav/WavStreamWriter.h"
 
 namespace iolib {
 
@@ -40,10 +55,50 @@ namespace iolib {
 
         int getSampleRate() { return mSampleRate; }
 
-        void addSampleSource(SampleSource* source);
+        static constexpr int32_t kMaxSampleSources = 128;
+        static_assert(kMaxSampleSources == kMaxScheduleTracks, "every track must be routable");
+
+        /**
+         * Takes ownership of source and adds it to the mix. Returns its track index, or -1 (and
+         * the source is not taken) if the player is full.
+         */
+        int32_t addSampleSource(SampleSource* source);
+
+        /**
+         * Loads the files in the background, in parallel (see TrackLoader). Track indices are
+         * reserved up front, consecutively from the returned one (-1 if the player is full),
+         * and each track joins the mix once it is ready. Until then getSampleSource() returns
+         * nullptr for it, and commands addressed to it are ignored.
+         */
+        int32_t loadSampleSources(const std::vector<std::string>& fileNames, float pan,
+                                  LoadPolicy loadPolicy);
+        void cancelLoading() { mTrackLoader.cancel(); }
+
+        /**
+         * State of the batchIndex-th file of the last loadSampleSources() call.
+         */
+        TrackLoader::TrackState getLoadState(int32_t batchIndex) {
+            return mTrackLoader.getTrackState(batchIndex);
+        }
+        bool isLoading() { return !mTrackLoader.isDone(); }
+
+        int32_t getNumSampleSources() { return mNumSampleSources.load(std::memory_order_acquire); }
+
+        /**
+         * Duration of the track at index in seconds, 0 if it isn't loaded (yet).
+         */
+        float getDuration(int32_t index);
+
+        /**
+         * numPeaks peaks of the track at index between two frames, see
+         * SampleSource::getWaveform(). Returns false if it isn't loaded (yet).
+         */
+        bool getWaveform(int32_t index, int64_t startFrame, int64_t endFrame, int32_t numPeaks,
+                         PeakPyramid::Peak* peaks);
 
         /**
          * Deallocates and deletes all added source/buffer (see addSampleSource()).
+         * Cancels a background load first, and waits for the audio thread to let go of them.
          */
         void unloadSampleData();
 
@@ -63,9 +118,184 @@ namespace iolib {
 
         void setGain(int index, float gain);
         float getGain(int index);
+
+        /**
+         * Master transport. All sources are positioned by a single frame clock, so starting,
+         * stopping and seeking take effect for every track at the same frame (at the start of
+         * the next audio callback). A seek completes once every track has prefetched its
+         * target, with a short crossfade (see SeekCoordinator); getCurrentFrame() reports the
+         * target meanwhile.
+         */
+        void startTransport();
+        void stopTransport();
+        void seekToFrame(int64_t frame);
+
+        /**
+         * Seek to a fraction [0.0, 1.0] of getTotalFrames().
+         */
         void setPosition(float position);
 
+        /**
+         * Transport position as of the end of the last audio callback, in frames.
+         */
+        int64_t getCurrentFrame() { return mPublishedFrame.load(std::memory_order_relaxed); }
+
+        /**
+         * Length of the longest source, in frames.
+         */
+        int64_t getTotalFrames() { return mTotalFrames.load(std::memory_order_relaxed); }
+
+        /**
+         * Disk streaming configuration and diagnostics.
+         */
+        void setStreamingWatermarks(int32_t lowWatermarkFrames, int32_t highWatermarkFrames);
+        uint32_t getStarvationCount(int index);
+
+        /**
+         * Sources are converted to the stream's native rate by the engine. The quality applies
+         * to sources added, and streams opened, from now on.
+         */
+        void setResamplerQuality(ResamplerQuality quality) { mResamplerQuality = quality; }
+
+        /**
+         * Mixing across cores for large track counts, see ParallelMixer. On by default with
+         * its default thresholds. Any thread.
+         */
+        void setParallelMixing(bool enabled, int32_t minSources, float minLoad) {
+            mParallelMixer.setEnabled(enabled);
+            mParallelMixer.setThresholds(minSources, minLoad);
+        }
+
+        /**
+         * Submix buses (see BusGraph). Tracks and buses feed kMasterBus until routed
+         * elsewhere. Routing changes are compiled into a new MixSchedule, which the audio
+         * thread switches to at the next block boundary. Control thread.
+         */
+        int32_t createBus();
+        bool removeBus(int32_t bus);
+        bool setBusOutput(int32_t bus, int32_t outputBus);
+        bool setTrackBus(int32_t track, int32_t bus);
+
+        void setBusGain(int32_t bus, float gain);
+        void setBusPan(int32_t bus, float pan);
+        void setBusMute(int32_t bus, bool muted);
+
+        /**
+         * Peak, RMS and peak-hold dBFS of the first numTracks tracks, after their gain, into
+         * values (LevelMeters::kValuesPerTrack per track). Returns the number of tracks
+         * filled. Doesn't allocate. Any thread.
+         */
+        int32_t readMeters(float* values, int32_t numTracks) {
+            return mMeters.read(values, numTracks);
+        }
+
+        void setMeterBallistics(float refreshHz, float releaseDecibelsPerSecond, float holdSeconds) {
+            mMeters.setBallistics(refreshHz, releaseDecibelsPerSecond, holdSeconds);
+        }
+
+        /**
+         * Transport, meters and xrun count, updated by the audio thread every callback, to
+         * be read in place rather than polled (see SharedStateBlock). Lives as long as the
+         * player.
+         */
+        SharedStateBlock* getSharedState() { return mSharedState.getBlock(); }
+        size_t getSharedStateSize() const { return mSharedState.getSize(); }
+
+        /**
+         * Callback timing against the burst budget, xruns and the costliest tracks since
+         * the last reset (see CallbackProfiler). Any thread.
+         */
+        void getCallbackReport(CallbackProfiler::Report* report, int32_t maxOffenders) const {
+            mProfiler.getReport(report, maxOffenders);
+        }
+        void resetCallbackReport() { mProfiler.reset(); }
+
+        /**
+         * Adaptive output latency (see LatencyTuner). The buffer starts at one burst and
+         * grows on xruns up to the ceiling; with tuning off, streams opened after get two
+         * bursts. Any thread.
+         */
+        void setAdaptiveLatency(bool enabled) { mLatencyTuner.setEnabled(enabled); }
+        void setMaxLatencyMillis(float maxLatencyMillis) {
+            mLatencyTuner.setMaxLatencyMillis(maxLatencyMillis);
+        }
+
+        // The latency the stream's buffer currently adds, in milliseconds
+        float getOutputLatencyMillis() const { return mLatencyTuner.getLatencyMillis(); }
+        int32_t getBufferSizeInFrames() const { return mLatencyTuner.getBufferSizeInFrames(); }
+
+        /**
+         * Renders every loaded track, with its current gain, pan and bus routing, from start to end into a
+         * WAV file at the stream's rate. Runs as fast as the CPU allows on the calling thread
+         * (not the audio thread) and doesn't disturb playback. Returns false on error.
+         */
+        bool renderMixdown(const char* path, parselib::WavStreamWriter::Format format);
+
+        /**
+         * Progress [0.0, 1.0] of the current/last renderMixdown(), and its speed as a multiple
+         * of real time. May be polled from any thread.
+         */
+        float getMixdownProgress() { return mMixdownProgress.load(std::memory_order_relaxed); }
+        float getMixdownSpeed() { return mMixdownSpeed.load(std::memory_order_relaxed); }
+
     private:
+        /**
+         * A parameter change or transport command sent from the control (JNI) thread
+         * to the audio thread. Commands are applied at the top of the next audio block.
+         */
+        struct PlayerCommand {
+            enum Type : int32_t {
+                SetGain,
+                SetPan,
+                Play,               // enable the source
+                Stop,               // disable the source
+                TransportStart,     // transport commands ignore index
+                TransportStop,
+                TransportSeek,      // frame: new transport position
+                SetBusGain,         // index: bus
+                SetBusPan,
+                SetBusMute,         // value: 0 or 1
+                SetSchedule,        // schedule: the new routing, ignores index
+                Fence,              // frame: number to acknowledge, see waitForAudioThread()
+            };
+
+            Type    type;
+            int32_t index;
+            float   value;
+            int64_t frame;
+            const MixSchedule* schedule;
+        };
+
+        static constexpr uint32_t kCommandQueueSize = 512;
+
+        bool pushCommand(PlayerCommand::Type type, int32_t index, float value, int64_t frame = 0);
+        bool pushCommand(const PlayerCommand& command);
+
+        // Compiles mBusGraph and hands the result to the audio thread. Call with mBusLock held.
+        void updateSchedule();
+
+        /**
+         * Returns once the audio thread has applied every command queued before the call, at
+         * the top of a block that started after it, so it no longer holds a source unpublished
+         * before the call. If the stream isn't calling back, stops it (no callback can be
+         * running then) and applies the commands here. Control thread.
+         */
+        void waitForAudioThread();
+
+        // Called on the audio thread only
+        void processCommands();
+        void applyCommand(const PlayerCommand& command);
+        void advanceTransport(int32_t numFrames);
+
+        // The transport position to report, the target of a pending seek
+        int64_t getReportedFrame() {
+            return mSeekCoordinator.isPending() ? mSeekCoordinator.getTargetFrame()
+                                                : mTransportFrame;
+        }
+
+        // Audio thread, at the end of each callback: profiling and the shared state
+        void finishCallback(oboe::AudioStream* stream, int32_t numFrames, bool metersPublished);
+
         class MyDataCallback : public oboe::AudioStreamDataCallback {
         public:
             MyDataCallback(SimpleMultiPlayer *parent) : mParent(parent) {}
@@ -99,16 +329,91 @@ namespace iolib {
         int32_t mChannelCount;
         int32_t mSampleRate;
 
-        // Sample Data
-        int32_t mNumSampleSources;
-        std::vector<SampleSource*>  mSampleSources;
+        // Largest callback we expect from the current stream, used to size source scratch memory
+        int32_t mMaxFramesPerCallback;
+
+        ResamplerQuality mResamplerQuality;
+
+        // Converts a source to the output rate, control thread only while it isn't mixed
+        void configureSource(SampleSource* source);
+
+        // Makes a loaded source part of the mix, any control or loader thread
+        void publishSampleSource(int32_t index, SampleSource* source);
+
+        // The track at index, or nullptr if it isn't loaded (yet). Call with mSourcesLock held,
+        // and let go of it before releasing the lock: unloadSampleData() deletes it.
+        SampleSource* getSampleSource(int32_t index);
+
+        // Sample Data. Track indices are handed out (mNumSampleSources) before their sources are
+        // ready; a slot stays nullptr until its source is published.
+        std::atomic<int32_t> mNumSampleSources;
+        std::atomic<SampleSource*> mSampleSources[kMaxSampleSources];
+
+        // Serializes adding, publishing, reconfiguring and deleting sources. Never taken by
+        // the audio thread.
+        std::mutex mSourcesLock;
+
+        // The published sources, gathered by the audio thread for MixEngine
+        std::vector<SampleSource*> mMixSources;
+
+        TrackLoader mTrackLoader;
 
         bool    mOutputReset;
 
+        // Transport clock. Owned by the audio thread, published for the control thread.
+        int64_t mTransportFrame;
+        bool    mTransportRunning;
+        std::atomic<int64_t> mPublishedFrame;
+        std::atomic<int64_t> mTotalFrames;
+
+        // Carries out transport seeks without gaps, audio thread
+        SeekCoordinator mSeekCoordinator;
+
+        std::atomic<float> mMixdownProgress;
+        std::atomic<float> mMixdownSpeed;
+
+        // Keeps the sources' decoded-frame buffers filled
+        DiskStreamer mDiskStreamer;
+
+        ParallelMixer mParallelMixer;
+
+        // Bus routing as edited by the control thread
+        std::mutex mBusLock;
+        BusGraph mBusGraph;
+
+        // Bus routing as executed by the audio thread
+        BusMixer mBusMixer;
+
+        // Written by the audio thread, read by the control thread
+        LevelMeters mMeters;
+        SharedState mSharedState;
+        CallbackProfiler mProfiler;
+
+        // Grows the stream's buffer on xruns, shrinks it when they stop. Tunes only streams
+        // that allow it (set in openStream(), read by the audio thread).
+        LatencyTuner mLatencyTuner;
+        bool mLatencyTunable;
+
+        // Schedules the audio thread has switched away from, deleted by the control thread.
+        // Each comes from a SetSchedule command, and updateSchedule() drains these before
+        // queueing another, so there are never more than the command queue holds.
+        static constexpr uint32_t kRetiredScheduleQueueSize = kCommandQueueSize;
+        LockFreeQueue<const MixSchedule*, kRetiredScheduleQueueSize> mRetiredSchedules;
+
+        // A schedule the audio thread couldn't retire yet, pushed again at the next block
+        const MixSchedule* mUnretiredSchedule;
+
+        // Control thread -> audio thread. Pushed only through pushCommand(), which takes
+        // mCommandLock: the queue has a single producer, but commands come from several threads.
+        LockFreeQueue<PlayerCommand, kCommandQueueSize> mCommandQueue;
+        std::mutex mCommandLock;
+
+        // The last Fence command queued (under mCommandLock), and applied by the audio thread
+        int64_t mFencesQueued;
+        std::atomic<int64_t> mFenceAcknowledged;
+
         std::shared_ptr<MyDataCallback> mDataCallback;
         std::shared_ptr<MyErrorCallback> mErrorCallback;
-
-        float position;
     };
 
 }
@@ -0,0 +1,177 @@
+#include <chrono>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+#include "Telemetry.h"
+
+static const char* TAG = "Telemetry";
+
+// Nice value for the drain thread, it must never compete with the audio thread
+static constexpr int kDrainThreadNice = 10;
+
+namespace iolib {
+
+    Telemetry& Telemetry::getInstance() {
+        static Telemetry sInstance;
+        return sInstance;
+    }
+
+    Telemetry::Telemetry()
+            : mNumDropped(0), mNumDroppedReported(0), mRunning(false), mFileSink(nullptr)
+    {}
+
+    Telemetry::~Telemetry() {
+        stop();
+        setFileSink(nullptr);
+    }
+
+    void Telemetry::post(int32_t level, TelemetryEvent event, int32_t index,
+                         float value0, float value1, float value2) {
+        TelemetryRecord record;
+        record.timeNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        record.event = event;
+        record.level = level;
+        record.index = index;
+        record.values[0] = value0;
+        record.values[1] = value1;
+        record.values[2] = value2;
+
+        if (!mRing.push(record)) {
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Telemetry::start() {
+        if (mRunning.exchange(true)) {
+            return; // already running
+        }
+        mDrainThread = std::thread(&Telemetry::drainLoop, this);
+    }
+
+    void Telemetry::stop() {
+        if (!mRunning.exchange(false)) {
+            return;
+        }
+        if (mDrainThread.joinable()) {
+            mDrainThread.join();
+        }
+        drain(); // flush whatever arrived after the last pass
+    }
+
+    bool Telemetry::setFileSink(const char* path) {
+        FILE* file = nullptr;
+        if (path != nullptr) {
+            file = fopen(path, "a");
+            if (file == nullptr) {
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mSinkLock);
+        if (mFileSink != nullptr) {
+            fclose(mFileSink);
+        }
+        mFileSink = file;
+        return true;
+    }
+
+    void Telemetry::drainLoop() {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), kDrainThreadNice);
+
+        while (mRunning.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(kDrainPeriodMillis));
+        }
+    }
+
+    void Telemetry::drain() {
+        std::lock_guard<std::mutex> lock(mSinkLock);
+
+        TelemetryRecord record;
+        while (mRing.pop(record)) {
+            emit(record);
+        }
+
+        uint32_t numDropped = mNumDropped.load(std::memory_order_relaxed);
+        if (numDropped != mNumDroppedReported) {
+            char text[64];
+            snprintf(text, sizeof(text), "%u telemetry records dropped",
+                     numDropped - mNumDroppedReported);
+            mNumDroppedReported = numDropped;
+
+            if (mFileSink != nullptr) {
+                fprintf(mFileSink, "W %s: %s\n", TAG, text);
+            } else {
+#ifdef __ANDROID__
+                __android_log_write(ANDROID_LOG_WARN, TAG, text);
+#else
+                fprintf(stderr, "W %s: %s\n", TAG, text);
+#endif
+            }
+        }
+
+        if (mFileSink != nullptr) {
+            fflush(mFileSink);
+        }
+    }
+
+    void Telemetry::emit(const TelemetryRecord& record) {
+        char text[128];
+        switch (record.event) {
+            case TelemetryEvent::TrackLevel:
+                snprintf(text, sizeof(text), "track:%d peak %f mean square %f gain %f",
+                         record.index, record.values[0], record.values[1], record.values[2]);
+                break;
+
+            case TelemetryEvent::StreamState:
+                snprintf(text, sizeof(text), "  streamState:%d", static_cast<int>(record.values[0]));
+                break;
+
+            case TelemetryEvent::StreamDisconnected:
+                snprintf(text, sizeof(text), "  streamState::Disconnected");
+                break;
+
+            case TelemetryEvent::LateCallback:
+                snprintf(text, sizeof(text), "late callback: %.0f%% of the budget for %d frames",
+                         100.0f * record.values[0], static_cast<int>(record.values[1]));
+                break;
+
+            default:
+                snprintf(text, sizeof(text), "event:%d index:%d [%f %f %f]",
+                         static_cast<int>(record.event), record.index,
+                         record.values[0], record.values[1], record.values[2]);
+                break;
+        }
+
+        static const char kLevelChars[] = { 'V', 'D', 'I', 'W', 'E' };
+        char levelChar = record.level >= 0 && record.level < IOLIB_TELEMETRY_LEVEL_SILENT
+                         ? kLevelChars[record.level] : '?';
+
+        if (mFileSink != nullptr) {
+            fprintf(mFileSink, "%lld %c %s\n", static_cast<long long>(record.timeNanos), levelChar,
+                    text);
+            return;
+        }
+
+#ifdef __ANDROID__
+        static const int kAndroidPriorities[] = {
+                ANDROID_LOG_VERBOSE, ANDROID_LOG_DEBUG, ANDROID_LOG_INFO,
+                ANDROID_LOG_WARN, ANDROID_LOG_ERROR
+        };
+        int priority = record.level >= 0 && record.level < IOLIB_TELEMETRY_LEVEL_SILENT
+                       ? kAndroidPriorities[record.level] : ANDROID_LOG_INFO;
+        __android_log_write(priority, TAG, text);
+#else
+        fprintf(stderr, "%lld %c %s: %s\n", static_cast<long long>(record.timeNanos), levelChar,
+                TAG, text);
+#endif
+    }
+
+} // namespace iolib
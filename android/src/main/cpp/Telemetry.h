@@ -0,0 +1,129 @@
+#ifndef _PLAYER_TELEMETRY_H_
+#define _PLAYER_TELEMETRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "LockFreeQueue.h"
+
+/*
+ * Compile-time telemetry levels. Records below IOLIB_TELEMETRY_LEVEL are compiled out entirely,
+ * including the evaluation of their arguments. Release (NDEBUG) builds default to SILENT so the
+ * audio path emits nothing; override with -DIOLIB_TELEMETRY_LEVEL=<n>.
+ */
+#define IOLIB_TELEMETRY_LEVEL_VERBOSE   0
+#define IOLIB_TELEMETRY_LEVEL_DEBUG     1
+#define IOLIB_TELEMETRY_LEVEL_INFO      2
+#define IOLIB_TELEMETRY_LEVEL_WARN      3
+#define IOLIB_TELEMETRY_LEVEL_ERROR     4
+#define IOLIB_TELEMETRY_LEVEL_SILENT    5
+
+#ifndef IOLIB_TELEMETRY_LEVEL
+#ifdef NDEBUG
+#define IOLIB_TELEMETRY_LEVEL IOLIB_TELEMETRY_LEVEL_SILENT
+#else
+#define IOLIB_TELEMETRY_LEVEL IOLIB_TELEMETRY_LEVEL_DEBUG
+#endif
+#endif
+
+#define IOLIB_TELEMETRY(level, event, index, ...) \
+    do { \
+        if constexpr ((level) >= IOLIB_TELEMETRY_LEVEL) { \
+            iolib::Telemetry::getInstance().post((level), (event), (index), ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define TELEMETRY_VERBOSE(event, index, ...) \
+    IOLIB_TELEMETRY(IOLIB_TELEMETRY_LEVEL_VERBOSE, event, index, ##__VA_ARGS__)
+#define TELEMETRY_DEBUG(event, index, ...) \
+    IOLIB_TELEMETRY(IOLIB_TELEMETRY_LEVEL_DEBUG, event, index, ##__VA_ARGS__)
+#define TELEMETRY_INFO(event, index, ...) \
+    IOLIB_TELEMETRY(IOLIB_TELEMETRY_LEVEL_INFO, event, index, ##__VA_ARGS__)
+#define TELEMETRY_WARN(event, index, ...) \
+    IOLIB_TELEMETRY(IOLIB_TELEMETRY_LEVEL_WARN, event, index, ##__VA_ARGS__)
+#define TELEMETRY_ERROR(event, index, ...) \
+    IOLIB_TELEMETRY(IOLIB_TELEMETRY_LEVEL_ERROR, event, index, ##__VA_ARGS__)
+
+namespace iolib {
+
+    enum class TelemetryEvent : int32_t {
+        TrackLevel,         // per meter refresh; index: track, values: peak, mean square
+                            // (before gain), gain
+        StreamState,        // values: oboe::StreamState
+        StreamDisconnected,
+        LateCallback,       // values: wall time / budget, frames
+    };
+
+    /**
+     * A fixed-size binary record. Formatting into text only happens on the drain thread.
+     */
+    struct TelemetryRecord {
+        int64_t        timeNanos;
+        TelemetryEvent event;
+        int32_t        level;
+        int32_t        index;
+        float          values[3];
+    };
+
+/**
+ * Collects binary telemetry records from the audio thread in a lock-free ring and forwards
+ * them, formatted, to logcat (or a file / stderr on other platforms) from a low-priority
+ * drain thread.
+ *
+ * post() may be called from a single producer thread (the audio callback) at a time.
+ */
+    class Telemetry {
+    public:
+        static Telemetry& getInstance();
+
+        ~Telemetry();
+
+        /**
+         * Queue a record. Never blocks or allocates; if the ring is full the record is
+         * counted as dropped.
+         */
+        void post(int32_t level, TelemetryEvent event, int32_t index,
+                  float value0 = 0.0f, float value1 = 0.0f, float value2 = 0.0f);
+
+        /**
+         * Starts/stops the drain thread. Control thread only.
+         */
+        void start();
+        void stop();
+
+        /**
+         * Write formatted records to the specified file instead of the platform default sink
+         * (logcat on Android, stderr elsewhere). Pass nullptr to restore the default.
+         */
+        bool setFileSink(const char* path);
+
+        uint32_t getDroppedCount() { return mNumDropped.load(std::memory_order_relaxed); }
+
+    private:
+        Telemetry();
+
+        static constexpr uint32_t kRingSize = 1024;
+        static constexpr int32_t kDrainPeriodMillis = 50;
+
+        void drainLoop();
+        void drain();
+        void emit(const TelemetryRecord& record);
+
+        LockFreeQueue<TelemetryRecord, kRingSize> mRing;
+        std::atomic<uint32_t> mNumDropped;
+        uint32_t mNumDroppedReported;
+
+        std::thread mDrainThread;
+        std::atomic<bool> mRunning;
+
+        // Guards the sink, which is swapped on the control thread and used on the drain thread
+        std::mutex mSinkLock;
+        FILE* mFileSink;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_TELEMETRY_H_
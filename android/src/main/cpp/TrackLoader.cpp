@@ -0,0 +1,114 @@
+#include <algorithm>
+
+#include "TrackLoader.h"
+
+namespace iolib {
+
+    TrackLoader::~TrackLoader() {
+        cancel();
+        wait();
+    }
+
+    void TrackLoader::start(const std::vector<std::string>& fileNames, float pan,
+                            LoadPolicy loadPolicy, PublishFunction publish, int32_t numThreads) {
+        wait();
+
+        std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+        batch->fileNames = fileNames;
+        batch->pan = pan;
+        batch->loadPolicy = loadPolicy;
+        batch->publish = publish;
+
+        int32_t numTracks = batch->getNumTracks();
+        batch->trackStates.reset(new std::atomic<int32_t>[numTracks]);
+        for (int32_t index = 0; index < numTracks; index++) {
+            batch->trackStates[index].store(static_cast<int32_t>(TrackState::Pending),
+                                            std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mBatchLock);
+            mBatch = batch;
+        }
+
+        if (numThreads <= 0) {
+            numThreads = static_cast<int32_t>(std::thread::hardware_concurrency());
+        }
+        numThreads = std::min(std::max(numThreads, 1), numTracks);
+        for (int32_t index = 0; index < numThreads; index++) {
+            mWorkers.emplace_back(&TrackLoader::workerLoop, batch);
+        }
+    }
+
+    void TrackLoader::cancel() {
+        std::shared_ptr<Batch> batch = getBatch();
+        if (batch != nullptr) {
+            batch->cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void TrackLoader::wait() {
+        for (std::thread& worker : mWorkers) {
+            worker.join();
+        }
+        mWorkers.clear();
+    }
+
+    int32_t TrackLoader::getNumTracks() {
+        std::shared_ptr<Batch> batch = getBatch();
+        return batch != nullptr ? batch->getNumTracks() : 0;
+    }
+
+    bool TrackLoader::isDone() {
+        std::shared_ptr<Batch> batch = getBatch();
+        return batch == nullptr
+               || batch->numCompleted.load(std::memory_order_acquire) == batch->getNumTracks();
+    }
+
+    TrackLoader::TrackState TrackLoader::getTrackState(int32_t index) {
+        std::shared_ptr<Batch> batch = getBatch();
+        if (batch == nullptr || index < 0 || index >= batch->getNumTracks()) {
+            return TrackState::Failed;
+        }
+        return static_cast<TrackState>(batch->trackStates[index].load(std::memory_order_acquire));
+    }
+
+    std::shared_ptr<TrackLoader::Batch> TrackLoader::getBatch() {
+        std::lock_guard<std::mutex> lock(mBatchLock);
+        return mBatch;
+    }
+
+    void TrackLoader::Batch::complete(int32_t index, TrackState state) {
+        trackStates[index].store(static_cast<int32_t>(state), std::memory_order_release);
+        numCompleted.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void TrackLoader::workerLoop(std::shared_ptr<Batch> batch) {
+        int32_t numTracks = batch->getNumTracks();
+        while (true) {
+            int32_t index = batch->nextTrack.fetch_add(1, std::memory_order_relaxed);
+            if (index >= numTracks) {
+                return;
+            }
+            if (batch->cancelled.load(std::memory_order_relaxed)) {
+                batch->complete(index, TrackState::Cancelled);
+                continue;
+            }
+
+            batch->trackStates[index].store(static_cast<int32_t>(TrackState::Loading),
+                                            std::memory_order_release);
+            std::unique_ptr<SampleSource> source = std::make_unique<SampleSource>(
+                    batch->fileNames[index].c_str(), batch->pan, batch->loadPolicy);
+
+            if (source->getNumChannels() <= 0) {
+                batch->complete(index, TrackState::Failed);
+            } else if (batch->cancelled.load(std::memory_order_relaxed)) {
+                batch->complete(index, TrackState::Cancelled);
+            } else {
+                batch->publish(index, source.release());
+                batch->complete(index, TrackState::Ready);
+            }
+        }
+    }
+
+} // namespace iolib
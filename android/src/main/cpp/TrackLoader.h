@@ -0,0 +1,98 @@
+#ifndef _PLAYER_TRACKLOADER_H_
+#define _PLAYER_TRACKLOADER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SampleSource.h"
+
+namespace iolib {
+
+/**
+ * Loads a batch of tracks (open, parse, preload and peak analysis, see SampleSource) on a pool
+ * of worker threads, one per core, so a song loads in about the time of its slowest track.
+ *
+ * Each track is handed to the publish function as soon as it is ready, on the worker thread
+ * that loaded it; tracks are claimed in order but may finish in any order.
+ *
+ * A batch's state is shared by its workers and whoever queries it, so a query racing the
+ * next start() reads one batch or the other, never one being torn down.
+ */
+    class TrackLoader {
+    public:
+        enum class TrackState : int32_t {
+            Pending = 0,
+            Loading = 1,
+            Ready = 2,
+            Failed = 3,
+            Cancelled = 4,
+        };
+
+        /**
+         * Takes ownership of source. trackIndex is the track's position in the batch.
+         */
+        typedef std::function<void(int32_t trackIndex, SampleSource* source)> PublishFunction;
+
+        TrackLoader() {}
+        ~TrackLoader();
+
+        /**
+         * Starts loading fileNames, with the given initial pan. numThreads 0 uses one thread
+         * per core. A previous batch is finished (or cancelled) first. Control thread only.
+         */
+        void start(const std::vector<std::string>& fileNames, float pan, LoadPolicy loadPolicy,
+                   PublishFunction publish, int32_t numThreads = 0);
+
+        /**
+         * Tracks that haven't started loading are dropped, tracks already loading are
+         * discarded once done instead of being published. Any thread.
+         */
+        void cancel();
+
+        /**
+         * Blocks until every track of the batch is Ready, Failed or Cancelled.
+         * Control thread only.
+         */
+        void wait();
+
+        // Any thread, of the last batch started
+        int32_t getNumTracks();
+        bool isDone();
+        TrackState getTrackState(int32_t index);
+
+    private:
+        struct Batch {
+            // Fixed for the lifetime of the batch
+            std::vector<std::string> fileNames;
+            float pan;
+            LoadPolicy loadPolicy;
+            PublishFunction publish;
+
+            std::unique_ptr<std::atomic<int32_t>[]> trackStates;
+            std::atomic<int32_t> numCompleted { 0 };
+            std::atomic<int32_t> nextTrack { 0 };
+            std::atomic<bool> cancelled { false };
+
+            int32_t getNumTracks() const { return static_cast<int32_t>(fileNames.size()); }
+            void complete(int32_t index, TrackState state);
+        };
+
+        std::shared_ptr<Batch> getBatch();
+        static void workerLoop(std::shared_ptr<Batch> batch);
+
+        std::mutex mBatchLock;
+        std::shared_ptr<Batch> mBatch;      // guarded by mBatchLock
+
+        // Control thread only
+        std::vector<std::thread> mWorkers;
+    };
+
+} // namespace iolib
+
+#endif //_PLAYER_TRACKLOADER_H_
@@ -0,0 +1,118 @@
+/*
+ * Measures the throughput of the WAV sample-to-float converters (parselib::SampleConversion)
+ * for every implementation the host supports, and for the default per-encoding choice,
+ * converting callback-sized blocks.
+ *
+ * usage: conversion_benchmark [blockFrames] [channels]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "wav/SampleConversion.h"
+
+using namespace parselib;
+
+static constexpr double kMinSecondsPerRun = 0.25;
+static constexpr int32_t kSourceFrames = 1 << 16;
+
+struct Format {
+    const char* name;
+    int32_t sampleSize;
+    void (*convert)(const void* src, float* dst, int32_t numSamples);
+};
+
+static const Format kFormats[] = {
+        { "PCM8",  1, SampleConversion::convertPCM8 },
+        { "PCM16", 2, SampleConversion::convertPCM16 },
+        { "PCM24", 3, SampleConversion::convertPCM24 },
+        { "PCM32", 4, SampleConversion::convertPCM32 },
+};
+
+static const SampleConversion::Implementation kImplementations[] = {
+        SampleConversion::Implementation::Scalar,
+        SampleConversion::Implementation::Neon,
+        SampleConversion::Implementation::Sse2,
+        SampleConversion::Implementation::Avx2,
+};
+
+// Checks the current implementation against reference, returns its throughput in frames/sec
+static double measure(const Format& format, const uint8_t* sourceData, int32_t sourceSamples,
+                      int32_t blockFrames, int32_t channels, const std::vector<float>& reference,
+                      std::vector<float>& output, bool* matches) {
+    int32_t blockSamples = blockFrames * channels;
+
+    // Correctness: must be bit-identical to the scalar reference
+    memset(output.data(), 0, output.size() * sizeof(float));
+    format.convert(sourceData, output.data(), sourceSamples);
+    *matches = memcmp(output.data(), reference.data(), output.size() * sizeof(float)) == 0;
+
+    // Throughput
+    int64_t numFrames = 0;
+    double elapsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (elapsed < kMinSecondsPerRun) {
+        for (int32_t offset = 0; offset + blockSamples <= sourceSamples;
+             offset += blockSamples) {
+            format.convert(sourceData + offset * format.sampleSize,
+                           output.data() + offset, blockSamples);
+            numFrames += blockFrames;
+        }
+        elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+    return numFrames / elapsed;
+}
+
+int main(int argc, char** argv) {
+    int32_t blockFrames = argc > 1 ? atoi(argv[1]) : 192;
+    int32_t channels = argc > 2 ? atoi(argv[2]) : 2;
+    int32_t sourceSamples = kSourceFrames * channels;
+
+    // Deterministic pseudo-random source data, offset by one byte to exercise unaligned loads
+    std::vector<uint8_t> source(sourceSamples * 4 + 1);
+    uint32_t seed = 0x12345678;
+    for (auto& byte : source) {
+        seed = seed * 1664525 + 1013904223;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+    const uint8_t* sourceData = source.data() + 1;
+
+    std::vector<float> reference(sourceSamples);
+    std::vector<float> output(sourceSamples);
+
+    printf("block: %d frames x %d channels\n", blockFrames, channels);
+    printf("%-6s %-7s %14s %10s %s\n", "format", "impl", "frames/sec", "x scalar", "check");
+
+    for (const Format& format : kFormats) {
+        SampleConversion::setImplementation(SampleConversion::Implementation::Scalar);
+        format.convert(sourceData, reference.data(), sourceSamples);
+
+        double scalarRate = 0;
+        bool matches;
+        for (auto implementation : kImplementations) {
+            if (!SampleConversion::setImplementation(implementation)) {
+                continue;
+            }
+            double rate = measure(format, sourceData, sourceSamples, blockFrames, channels,
+                                  reference, output, &matches);
+            if (implementation == SampleConversion::Implementation::Scalar) {
+                scalarRate = rate;
+            }
+            printf("%-6s %-7s %14.0f %10.2f %s\n", format.name,
+                   SampleConversion::getImplementationName(implementation), rate,
+                   rate / scalarRate, matches ? "ok" : "MISMATCH");
+        }
+
+        // What the decoders use: the best implementation, or scalar where that is faster
+        SampleConversion::setDefaultImplementation();
+        double rate = measure(format, sourceData, sourceSamples, blockFrames, channels,
+                              reference, output, &matches);
+        printf("%-6s %-7s %14.0f %10.2f %s\n", format.name, "default", rate,
+               rate / scalarRate, matches ? "ok" : "MISMATCH");
+    }
+
+    return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * Drives the player's mixing path (SampleSources streamed by the DiskStreamer, mixed through a
+ * BusMixer on the ParallelMixer, metered by LevelMeters, as in the audio callback) from a
+ * simulated output stream (FakeStreamDriver), over a synthetic WAV corpus: 8/16/24/32-bit,
+ * mono/stereo, 44.1/48/96 kHz, mixed at the stream rate.
+ *
+ * For each file it reports the callback time percentiles and throughput at --tracks tracks,
+ * and the largest track count (up to kMaxScheduleTracks) that sustains the stream: no xruns,
+ * no starved reads, and a 99th percentile callback within kSustainableLoad of the burst period.
+ * Rows whose run starved are marked with a '*'.
+ *
+ * Streamed runs are paced at the stream rate by default: unpaced, the callbacks outrun the
+ * DiskStreamer as soon as the primed buffers are used up. Preloaded runs are unpaced by default.
+ *
+ * usage: engine_benchmark [--burst <frames>] [--rate <Hz>] [--channels <1|2>]
+ *                         [--tracks <n>] [--seconds <s>] [--dir <path>]
+ *                         [--preload] [--serial] [--paced | --unpaced]
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "BusMixer.h"
+#include "DiskStreamer.h"
+#include "LevelMeters.h"
+#include "ParallelMixer.h"
+#include "SampleSource.h"
+#include "host/FakeStreamDriver.h"
+
+using namespace iolib;
+
+static constexpr float kSustainableLoad = 0.8f;
+static constexpr int32_t kMaxTracks = kMaxScheduleTracks;
+
+struct CorpusFile {
+    int32_t bitsPerSample;
+    int32_t channels;
+    int32_t sampleRate;
+    std::string path;
+};
+
+struct Options {
+    int32_t burstFrames = 192;
+    int32_t sampleRate = 48000;
+    int32_t channelCount = 2;
+    int32_t numTracks = 16;
+    double seconds = 2.0;
+    std::string directory = "/tmp/engine_benchmark";
+    LoadPolicy loadPolicy = LoadPolicy::Stream;
+    bool parallel = true;
+    int32_t paced = -1;         // -1: paced when streaming
+};
+
+struct RunResult {
+    double percentiles[5];      // 50, 90, 99, 99.9, 100, in seconds
+    double framesPerSecond;     // output frames mixed per second of callback time
+    int32_t xRunCount;
+    uint32_t starvationCount;
+};
+
+static const double kPercentiles[] = { 50.0, 90.0, 99.0, 99.9, 100.0 };
+
+static void writeLittleEndian(FILE* file, uint32_t value, int32_t numBytes) {
+    for (int32_t index = 0; index < numBytes; index++) {
+        fputc(static_cast<int>((value >> (8 * index)) & 0xFF), file);
+    }
+}
+
+/*
+ * A tone with some noise, at -6 dBFS. Written by hand rather than with WavStreamWriter, which
+ * has no 8 or 32-bit integer output.
+ */
+static bool writeSyntheticWav(const CorpusFile& corpusFile, int32_t numFrames) {
+    FILE* file = fopen(corpusFile.path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    int32_t bytesPerSample = corpusFile.bitsPerSample / 8;
+    uint32_t dataBytes = static_cast<uint32_t>(numFrames) * corpusFile.channels * bytesPerSample;
+    fwrite("RIFF", 1, 4, file);
+    writeLittleEndian(file, 36 + dataBytes, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    writeLittleEndian(file, 16, 4);
+    writeLittleEndian(file, 1, 2);      // PCM
+    writeLittleEndian(file, corpusFile.channels, 2);
+    writeLittleEndian(file, corpusFile.sampleRate, 4);
+    writeLittleEndian(file, corpusFile.sampleRate * corpusFile.channels * bytesPerSample, 4);
+    writeLittleEndian(file, corpusFile.channels * bytesPerSample, 2);
+    writeLittleEndian(file, corpusFile.bitsPerSample, 2);
+    fwrite("data", 1, 4, file);
+    writeLittleEndian(file, dataBytes, 4);
+
+    uint32_t seed = 0x12345678;
+    float phase = 0.0f;
+    float phaseStep = 440.0f / corpusFile.sampleRate;
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        for (int32_t channel = 0; channel < corpusFile.channels; channel++) {
+            seed = seed * 1664525 + 1013904223;
+            float noise = static_cast<int32_t>(seed) / 2147483648.0f;
+            float triangle = 4.0f * std::abs(phase - 0.5f) - 1.0f;
+            float sample = 0.4f * triangle + 0.1f * noise;
+            if (corpusFile.bitsPerSample == 8) {
+                writeLittleEndian(file, static_cast<uint32_t>(128 + static_cast<int32_t>(sample * 127)), 1);
+            } else {
+                double scale = static_cast<double>(1u << (corpusFile.bitsPerSample - 2)) * 2 - 1;
+                writeLittleEndian(file, static_cast<uint32_t>(static_cast<int32_t>(sample * scale)),
+                                  bytesPerSample);
+            }
+        }
+        phase += phaseStep;
+        phase -= static_cast<int32_t>(phase);
+    }
+    bool written = ferror(file) == 0;
+    return fclose(file) == 0 && written;
+}
+
+static double percentile(std::vector<double>& sorted, double percent) {
+    size_t index = static_cast<size_t>(percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static bool runStream(const Options& options, const std::string& path, int32_t numTracks,
+                      ParallelMixer* parallelMixer, RunResult* result) {
+    std::vector<std::unique_ptr<SampleSource>> sources;
+    std::vector<SampleSource*> tracks;
+    DiskStreamer streamer;
+    for (int32_t track = 0; track < numTracks; track++) {
+        auto source = std::make_unique<SampleSource>(path.c_str(), SampleSource::PAN_CENTER,
+                                                     options.loadPolicy);
+        if (source->getNumChannels() <= 0) {
+            fprintf(stderr, "engine_benchmark: can't read %s\n", path.c_str());
+            return false;
+        }
+        source->setOutputSampleRate(options.sampleRate, ResamplerQuality::Medium);
+        source->prepareToPlay(options.burstFrames, options.channelCount);
+        source->setPlayMode();
+        if (source->isStreaming()) {
+            // Primed here, before the I/O thread starts, so the run starts with full buffers
+            streamer.addSource(source.get());
+            source->serviceStream(streamer.getHighWatermarkFrames(),
+                                  streamer.getHighWatermarkFrames());
+        }
+        tracks.push_back(source.get());
+        sources.push_back(std::move(source));
+    }
+    streamer.start();
+
+    FakeStreamDriver::Config config;
+    config.sampleRate = options.sampleRate;
+    config.channelCount = options.channelCount;
+    config.framesPerBurst = options.burstFrames;
+    config.paced = options.paced != 0;
+    FakeStreamDriver driver(config);
+
+    BusMixer busMixer;
+    busMixer.prepare(options.burstFrames, options.channelCount);
+    LevelMeters meters;
+    meters.setSampleRate(options.sampleRate);
+
+    // What SimpleMultiPlayer's data callback does once the transport runs
+    int64_t transportFrame = 0;
+    int64_t numCallbacks = static_cast<int64_t>(options.seconds * options.sampleRate
+                                                / options.burstFrames);
+    driver.run(numCallbacks, [&](float* audioData, int32_t numFrames) {
+        busMixer.mix(tracks.data(), numTracks, audioData, options.channelCount,
+                     transportFrame, numFrames, parallelMixer, options.sampleRate);
+        for (int32_t track = 0; track < numTracks; track++) {
+            SampleSource* source = tracks[track];
+            float gain = source->getGain();
+            meters.addLevel(track, source->getLastPeak() * gain,
+                            source->getLastMeanSquare() * gain * gain);
+        }
+        meters.endBlock(numFrames);
+        transportFrame += numFrames;
+        return true;
+    });
+    streamer.stop();
+
+    std::vector<double> sorted = driver.getCallbackSeconds();
+    std::sort(sorted.begin(), sorted.end());
+    double totalSeconds = 0.0;
+    for (double seconds : sorted) {
+        totalSeconds += seconds;
+    }
+    for (int32_t index = 0; index < 5; index++) {
+        result->percentiles[index] = percentile(sorted, kPercentiles[index]);
+    }
+    result->framesPerSecond = totalSeconds > 0.0
+                              ? sorted.size() * options.burstFrames / totalSeconds
+                              : 0.0;
+    result->xRunCount = driver.getXRunCount();
+    result->starvationCount = 0;
+    for (SampleSource* source : tracks) {
+        result->starvationCount += source->getStarvationCount();
+    }
+    return true;
+}
+
+static bool isSustainable(const Options& options, const RunResult& result) {
+    double burstSeconds = options.burstFrames / static_cast<double>(options.sampleRate);
+    return result.xRunCount == 0 && result.starvationCount == 0
+           && result.percentiles[2] <= kSustainableLoad * burstSeconds;
+}
+
+// Doubles, then bisects, the track count. 0 if even one track isn't sustainable.
+static int32_t findMaxTracks(const Options& options, const std::string& path,
+                             ParallelMixer* parallelMixer) {
+    RunResult result;
+    int32_t good = 0;
+    int32_t bad = kMaxTracks + 1;
+    for (int32_t numTracks = 1; numTracks <= kMaxTracks; numTracks *= 2) {
+        if (!runStream(options, path, numTracks, parallelMixer, &result)
+            || !isSustainable(options, result)) {
+            bad = numTracks;
+            break;
+        }
+        good = numTracks;
+    }
+    while (bad - good > 1) {
+        int32_t numTracks = (good + bad) / 2;
+        if (runStream(options, path, numTracks, parallelMixer, &result)
+            && isSustainable(options, result)) {
+            good = numTracks;
+        } else {
+            bad = numTracks;
+        }
+    }
+    return good;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: engine_benchmark [--burst <frames>] [--rate <Hz>] [--channels <1|2>]\n"
+                    "                        [--tracks <n>] [--seconds <s>] [--dir <path>]\n"
+                    "                        [--preload] [--serial] [--paced | --unpaced]\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+        bool hasValue = index + 1 < argc;
+        if (strcmp(arg, "--burst") == 0 && hasValue) {
+            options.burstFrames = atoi(argv[++index]);
+        } else if (strcmp(arg, "--rate") == 0 && hasValue) {
+            options.sampleRate = atoi(argv[++index]);
+        } else if (strcmp(arg, "--channels") == 0 && hasValue) {
+            options.channelCount = atoi(argv[++index]);
+        } else if (strcmp(arg, "--tracks") == 0 && hasValue) {
+            options.numTracks = atoi(argv[++index]);
+        } else if (strcmp(arg, "--seconds") == 0 && hasValue) {
+            options.seconds = atof(argv[++index]);
+        } else if (strcmp(arg, "--dir") == 0 && hasValue) {
+            options.directory = argv[++index];
+        } else if (strcmp(arg, "--preload") == 0) {
+            options.loadPolicy = LoadPolicy::Preload;
+        } else if (strcmp(arg, "--serial") == 0) {
+            options.parallel = false;
+        } else if (strcmp(arg, "--paced") == 0) {
+            options.paced = 1;
+        } else if (strcmp(arg, "--unpaced") == 0) {
+            options.paced = 0;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (options.burstFrames <= 0 || options.sampleRate <= 0 || options.channelCount < 1
+        || options.channelCount > 2 || options.numTracks < 1 || options.numTracks > kMaxTracks
+        || options.seconds <= 0.0) {
+        usage();
+        return 1;
+    }
+    if (options.paced < 0) {
+        options.paced = options.loadPolicy == LoadPolicy::Stream ? 1 : 0;
+    }
+
+    // The corpus, long enough for a whole run at any rate
+    mkdir(options.directory.c_str(), 0755);
+    std::vector<CorpusFile> corpus;
+    for (int32_t sampleRate : { 44100, 48000, 96000 }) {
+        for (int32_t channels : { 1, 2 }) {
+            for (int32_t bitsPerSample : { 8, 16, 24, 32 }) {
+                char name[64];
+                snprintf(name, sizeof(name), "/pcm%d_%dch_%d.wav", bitsPerSample, channels,
+                         sampleRate);
+                CorpusFile corpusFile { bitsPerSample, channels, sampleRate,
+                                        options.directory + name };
+                int32_t numFrames = static_cast<int32_t>((options.seconds + 1.0) * sampleRate);
+                if (!writeSyntheticWav(corpusFile, numFrames)) {
+                    fprintf(stderr, "engine_benchmark: can't write %s\n", corpusFile.path.c_str());
+                    return 1;
+                }
+                corpus.push_back(corpusFile);
+            }
+        }
+    }
+
+    std::unique_ptr<ParallelMixer> parallelMixer;
+    if (options.parallel) {
+        parallelMixer.reset(new ParallelMixer());
+        parallelMixer->prepare(options.burstFrames, options.channelCount);
+        parallelMixer->start();
+    }
+
+    double burstMicros = 1e6 * options.burstFrames / options.sampleRate;
+    printf("stream: %d Hz, %d channels, %d-frame bursts (%.0f us), %s, %s, %s mix, %d tracks\n",
+           options.sampleRate, options.channelCount, options.burstFrames, burstMicros,
+           options.loadPolicy == LoadPolicy::Preload ? "preloaded" : "streamed",
+           options.paced ? "paced" : "unpaced", options.parallel ? "parallel" : "serial",
+           options.numTracks);
+    printf("%-18s %8s %8s %8s %8s %8s %12s %6s %7s %10s\n", "file", "p50 us", "p90 us",
+           "p99 us", "p99.9 us", "max us", "frames/sec", "xruns", "starved", "max tracks");
+
+    int result = 0;
+    bool starved = false;
+    for (const CorpusFile& corpusFile : corpus) {
+        RunResult run;
+        if (!runStream(options, corpusFile.path, options.numTracks, parallelMixer.get(), &run)) {
+            result = 1;
+            continue;
+        }
+        int32_t maxTracks = findMaxTracks(options, corpusFile.path, parallelMixer.get());
+        printf("%-18s %8.1f %8.1f %8.1f %8.1f %8.1f %12.0f %6d %7u %10d%s\n",
+               corpusFile.path.c_str() + options.directory.size() + 1,
+               1e6 * run.percentiles[0], 1e6 * run.percentiles[1], 1e6 * run.percentiles[2],
+               1e6 * run.percentiles[3], 1e6 * run.percentiles[4], run.framesPerSecond,
+               run.xRunCount, run.starvationCount, maxTracks,
+               run.starvationCount > 0 ? " *" : "");
+        starved |= run.starvationCount > 0;
+        fflush(stdout);
+    }
+
+    if (starved) {
+        printf("* starved: the DiskStreamer fell behind and the mix read silence%s\n",
+               options.paced ? "" : " (unpaced; try --paced)");
+    }
+
+    if (parallelMixer) {
+        parallelMixer->stop();
+    }
+    return result;
+}
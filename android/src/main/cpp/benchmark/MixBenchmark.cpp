@@ -0,0 +1,180 @@
+/*
+ * Measures the throughput of the per-track mix kernels (iolib::MixKernels) for common channel
+ * layouts, against the branchy per-layout loops SampleSource::mixAudio() used before, mixing
+ * callback-sized blocks.
+ *
+ * usage: mix_benchmark [blockFrames]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "MixKernels.h"
+
+using namespace iolib;
+
+static constexpr double kMinSecondsPerRun = 0.25;
+static constexpr int32_t kSourceFrames = 1 << 16;
+static constexpr float kLeftGain = 0.3f;
+static constexpr float kRightGain = 0.7f;
+
+// The old loops, with the mono -> mono indexing fixed. Returns the peak like a kernel does
+// (they didn't measure energy).
+static MixLevel mixLegacy(const float* buffer, int32_t sampleChannels, float* outBuff,
+                          int32_t numChannels, int32_t numFrames, const MixMatrix&) {
+    float amplitudeMax = 0;
+    float gain = kLeftGain + kRightGain;
+    if ((sampleChannels == 1) && (numChannels == 1)) {
+        for (int32_t frameIndex = 0; frameIndex < numFrames; frameIndex++) {
+            if (std::abs(buffer[frameIndex]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex]);
+            }
+            outBuff[frameIndex] += buffer[frameIndex] * gain;
+        }
+    } else if ((sampleChannels == 1) && (numChannels == 2)) {
+        int dstSampleIndex = 0;
+        for (int32_t frameIndex = 0; frameIndex < numFrames; frameIndex++) {
+            if (std::abs(buffer[frameIndex]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex]);
+            }
+            outBuff[dstSampleIndex++] += buffer[frameIndex] * kLeftGain;
+            outBuff[dstSampleIndex++] += buffer[frameIndex] * kRightGain;
+        }
+    } else if ((sampleChannels == 2) && (numChannels == 1)) {
+        for (int32_t frameIndex = 0; frameIndex < numFrames * 2; frameIndex += 2) {
+            if (std::abs(buffer[frameIndex]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex]);
+            }
+            if (std::abs(buffer[frameIndex + 1]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex + 1]);
+            }
+            outBuff[frameIndex / 2] += buffer[frameIndex] * kLeftGain +
+                                       buffer[frameIndex + 1] * kRightGain;
+        }
+    } else if ((sampleChannels == 2) && (numChannels == 2)) {
+        for (int32_t frameIndex = 0; frameIndex < numFrames * 2; frameIndex += 2) {
+            if (std::abs(buffer[frameIndex]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex]);
+            }
+            if (std::abs(buffer[frameIndex + 1]) > amplitudeMax) {
+                amplitudeMax = std::abs(buffer[frameIndex + 1]);
+            }
+            outBuff[frameIndex] += buffer[frameIndex] * kLeftGain;
+            outBuff[frameIndex + 1] += buffer[frameIndex + 1] * kRightGain;
+        }
+    }
+    return { amplitudeMax, 0.0f };
+}
+
+// Straightforward matrix multiply, the reference for layouts the old loops didn't handle
+static MixLevel mixReference(const float* src, int32_t srcChannels, float* dst,
+                             int32_t dstChannels, int32_t numFrames, const MixMatrix& matrix) {
+    // Summed in double, so the kernels' float lanes are checked against an exact-ish value
+    float peak = 0.0f;
+    double sumOfSquares = 0.0;
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        for (int32_t out = 0; out < dstChannels; out++) {
+            for (int32_t in = 0; in < srcChannels; in++) {
+                dst[frame * dstChannels + out] += matrix.gains[out][in]
+                                                  * src[frame * srcChannels + in];
+            }
+        }
+        for (int32_t in = 0; in < srcChannels; in++) {
+            float sample = src[frame * srcChannels + in];
+            peak = std::max(peak, std::fabs(sample));
+            sumOfSquares += sample * sample;
+        }
+    }
+    return { peak, static_cast<float>(sumOfSquares) };
+}
+
+struct Layout {
+    const char* name;
+    int32_t srcChannels;
+    int32_t dstChannels;
+};
+
+static const Layout kLayouts[] = {
+        { "1->1", 1, 1 },
+        { "1->2", 1, 2 },
+        { "2->1", 2, 1 },
+        { "2->2", 2, 2 },
+        { "6->2", 6, 2 },
+        { "8->2", 8, 2 },
+        { "6->6", 6, 6 },
+};
+
+// Frames per second mixing the whole source in blockFrames blocks
+static double measure(MixKernel kernel, const Layout& layout, const std::vector<float>& source,
+                      std::vector<float>& output, int32_t blockFrames, const MixMatrix& matrix) {
+    int64_t numFrames = 0;
+    double elapsed = 0;
+    volatile float peak = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (elapsed < kMinSecondsPerRun) {
+        for (int32_t frame = 0; frame + blockFrames <= kSourceFrames; frame += blockFrames) {
+            peak = kernel(source.data() + frame * layout.srcChannels, layout.srcChannels,
+                          output.data() + frame * layout.dstChannels, layout.dstChannels,
+                          blockFrames, matrix).peak;
+            numFrames += blockFrames;
+        }
+        elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+    (void)peak;
+    return numFrames / elapsed;
+}
+
+int main(int argc, char** argv) {
+    int32_t blockFrames = argc > 1 ? atoi(argv[1]) : 192;
+    blockFrames = std::max(1, std::min(blockFrames, kSourceFrames));
+
+    printf("block: %d frames\n", blockFrames);
+    printf("%-6s %-8s %14s %10s %s\n", "layout", "impl", "frames/sec", "speedup", "check");
+
+    for (const Layout& layout : kLayouts) {
+        // Deterministic pseudo-random source data in [-1, 1)
+        std::vector<float> source(kSourceFrames * layout.srcChannels);
+        uint32_t seed = 0x12345678;
+        for (float& sample : source) {
+            seed = seed * 1664525 + 1013904223;
+            sample = static_cast<int32_t>(seed) / 2147483648.0f;
+        }
+
+        MixMatrix matrix;
+        MixKernels::buildMatrix(layout.srcChannels, layout.dstChannels, kLeftGain, kRightGain,
+                                &matrix);
+        bool hasLegacy = layout.srcChannels <= 2 && layout.dstChannels <= 2;
+        MixKernel baseline = hasLegacy ? mixLegacy : mixReference;
+        MixKernel kernel = MixKernels::select(layout.srcChannels, layout.dstChannels);
+
+        // Correctness: one pass over the whole source, compared with the baseline
+        std::vector<float> expected(kSourceFrames * layout.dstChannels, 0.0f);
+        std::vector<float> output(expected.size(), 0.0f);
+        MixLevel expectedLevel = baseline(source.data(), layout.srcChannels, expected.data(),
+                                          layout.dstChannels, kSourceFrames, matrix);
+        MixLevel level = kernel(source.data(), layout.srcChannels, output.data(),
+                                layout.dstChannels, kSourceFrames, matrix);
+        float maxError = 0;
+        for (size_t index = 0; index < output.size(); index++) {
+            maxError = std::max(maxError, std::fabs(output[index] - expected[index]));
+        }
+        bool matches = maxError < 1e-5f && level.peak == expectedLevel.peak;
+        if (!hasLegacy) {
+            matches &= std::fabs(level.sumOfSquares - expectedLevel.sumOfSquares)
+                       <= 1e-4f * expectedLevel.sumOfSquares;
+        }
+
+        double baselineRate = measure(baseline, layout, source, output, blockFrames, matrix);
+        double kernelRate = measure(kernel, layout, source, output, blockFrames, matrix);
+        printf("%-6s %-8s %14.0f %10s\n", layout.name, hasLegacy ? "legacy" : "naive",
+               baselineRate, "1.00");
+        printf("%-6s %-8s %14.0f %10.2f %s\n", layout.name, "kernel", kernelRate,
+               kernelRate / baselineRate, matches ? "ok" : "MISMATCH");
+    }
+
+    return 0;
+}
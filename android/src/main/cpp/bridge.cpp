@@ -1,6 +1,7 @@
 #include <jni.h>
 #include <android/log.h>
 
+#include "SharedStateReader.h"
 #include "SimpleMultiPlayer.h"
 #include "stream/FileInputStream.h"
 #include "wav/WavStreamReader.h"
@@ -9,7 +10,6 @@
 #include "vector"
 
 static iolib::SimpleMultiPlayer sPlayer;
-static std::vector<iolib::SampleSource*> sources;
 
 extern "C"
 JNIEXPORT jlong JNICALL
@@ -28,34 +28,85 @@ extern "C"
 JNIEXPORT void JNICALL
 Java_com_armsaudio_ArmsaudioModule_resetPlayer(JNIEnv *env, jobject thiz) {
     sPlayer.unloadSampleData();
-    sources.clear();
 }
 
 extern "C"
 JNIEXPORT jint JNICALL
-Java_com_armsaudio_ArmsaudioModule_loadTrack(JNIEnv *env, jobject thiz, jstring fileName) {
-    auto source = new iolib::SampleSource(env->GetStringUTFChars(fileName, 0), 1);
-    sPlayer.addSampleSource(source);
-    sources.push_back(source);
+Java_com_armsaudio_ArmsaudioModule_loadTrack(
+        JNIEnv *env,
+        jobject thiz,
+        jstring fileName,
+        jint load_policy) {
+    const char* fileNameChars = env->GetStringUTFChars(fileName, 0);
+    auto source = new iolib::SampleSource(fileNameChars, 1,
+                                          static_cast<iolib::LoadPolicy>(load_policy));
+    env->ReleaseStringUTFChars(fileName, fileNameChars);
 
-    return sources.size() - 1;
+    int32_t index = source->getNumChannels() > 0 ? sPlayer.addSampleSource(source) : -1;
+    if (index < 0) {
+        delete source;
+    }
+    return index;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_armsaudio_ArmsaudioModule_loadTracks(
+        JNIEnv *env,
+        jobject thiz,
+        jobjectArray fileNames,
+        jint load_policy) {
+    std::vector<std::string> fileNameStrings;
+    jsize numFiles = env->GetArrayLength(fileNames);
+    for (jsize index = 0; index < numFiles; index++) {
+        auto fileName = static_cast<jstring>(env->GetObjectArrayElement(fileNames, index));
+        const char* fileNameChars = env->GetStringUTFChars(fileName, 0);
+        fileNameStrings.emplace_back(fileNameChars);
+        env->ReleaseStringUTFChars(fileName, fileNameChars);
+        env->DeleteLocalRef(fileName);
+    }
+
+    return sPlayer.loadSampleSources(fileNameStrings, 1,
+                                     static_cast<iolib::LoadPolicy>(load_policy));
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_com_armsaudio_ArmsaudioModule_getTrackLoadStates(JNIEnv *env, jobject thiz, jint num_tracks) {
+    // iolib::TrackLoader::TrackState of each file of the last loadTracks() call
+    std::vector<jint> states(num_tracks, static_cast<jint>(iolib::TrackLoader::TrackState::Pending));
+    for (jint index = 0; index < num_tracks; index++) {
+        states[index] = static_cast<jint>(sPlayer.getLoadState(index));
+    }
+
+    jintArray result = env->NewIntArray(num_tracks);
+    env->SetIntArrayRegion(result, 0, num_tracks, states.data());
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_cancelTrackLoading(JNIEnv *env, jobject thiz) {
+    sPlayer.cancelLoading();
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_armsaudio_ArmsaudioModule_playAudioInternal(JNIEnv *env,jobject obj) {
     sPlayer.startStream();
-    for (int i = 0; i < sources.size(); ++i) {
+    for (int i = 0; i < sPlayer.getNumSampleSources(); ++i) {
         sPlayer.triggerDown(i);
     }
+    // The tracks only produce audio while the transport runs, so they all start together
+    sPlayer.startTransport();
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_armsaudio_ArmsaudioModule_getMaxPlaybackDuration(JNIEnv *env, jobject thiz) {
     jfloat maxDuration = 0.0f;
-    for (int i = 0; i < sources.size(); ++i) {
-        float duration = sources[i]->getDuration();
+    for (int i = 0; i < sPlayer.getNumSampleSources(); ++i) {
+        float duration = sPlayer.getDuration(i);
         if (duration > maxDuration) {
             maxDuration = duration;
         }
@@ -76,39 +127,64 @@ Java_com_armsaudio_ArmsaudioModule_resumeAudio(JNIEnv *env, jobject thiz) {
 }
 
 extern "C"
-JNIEXPORT jfloat JNICALL
-Java_com_armsaudio_ArmsaudioModule_getCurrentPosition(JNIEnv *env, jobject thiz) {
-    if (sources.empty())
-        return 0;
+JNIEXPORT jlong JNICALL
+Java_com_armsaudio_ArmsaudioModule_getCurrentFrame(JNIEnv *env, jobject thiz) {
+    return sPlayer.getCurrentFrame();
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_armsaudio_ArmsaudioModule_getTotalFrames(JNIEnv *env, jobject thiz) {
+    return sPlayer.getTotalFrames();
+}
 
-    return sources[0]->getPosition();
+// The engine's SharedStateBlock, wrapped once. The player is static, so the buffer stays valid
+// for the life of the process.
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_com_armsaudio_ArmsaudioModule_getSharedState(JNIEnv *env, jobject thiz) {
+    return env->NewDirectByteBuffer(sPlayer.getSharedState(),
+                                    static_cast<jlong>(sPlayer.getSharedStateSize()));
 }
 
+// SharedEngineState.read() before API 33, where Java has no acquire fence to read the block in
+// place with: header gets the transport, xrun and meter fields, meters the dBFS levels.
 extern "C"
-JNIEXPORT jobjectArray JNICALL
-Java_com_armsaudio_ArmsaudioModule_getAmplitudes(JNIEnv *env, jobject thiz) {
-    auto length = sources.size();
-    auto amplitudesCpp = new float[length];
-    for (int i = 0; i < length; i++) {
-        amplitudesCpp[i] = sources[i]->getAmplitude();
+JNIEXPORT jboolean JNICALL
+Java_com_armsaudio_SharedEngineState_nativeRead(JNIEnv *env, jclass clazz, jobject buffer,
+                                                jlongArray header, jfloatArray meters) {
+    iolib::SharedStateReader reader(env->GetDirectBufferAddress(buffer),
+                                    static_cast<size_t>(env->GetDirectBufferCapacity(buffer)));
+    iolib::SharedStateSnapshot snapshot;
+    if (!reader.read(&snapshot)) {
+        return JNI_FALSE;
     }
 
-    auto floatClass = env->FindClass("java/lang/Float");
-    auto amplitudesJava = env->NewObjectArray(length, floatClass, nullptr);
-    jmethodID floatConstructorID = env->GetMethodID(floatClass, "<init>", "(F)V");
-    for(int i = 0; i < length; i++) {
-        auto floatObj = env->NewObject(floatClass, floatConstructorID, amplitudesCpp[i]);
-        env->SetObjectArrayElement(amplitudesJava, i, floatObj);
-    }
+    jlong values[] = {
+            snapshot.transportFrame, snapshot.totalFrames, snapshot.sampleRate,
+            snapshot.playing ? 1 : 0, snapshot.xRunCount, snapshot.meterFrame, snapshot.numTracks,
+    };
+    env->SetLongArrayRegion(header, 0, sizeof(values) / sizeof(values[0]), values);
+    env->SetFloatArrayRegion(meters, 0, snapshot.numTracks * iolib::kSharedStateValuesPerTrack,
+                             snapshot.meters);
+    return JNI_TRUE;
+}
 
-    delete[] amplitudesCpp;
-    return amplitudesJava;
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setTrackMeterBallistics(
+        JNIEnv *env,
+        jobject thiz,
+        jfloat refresh_hz,
+        jfloat release_db_per_second,
+        jfloat hold_seconds) {
+    sPlayer.setMeterBallistics(refresh_hz, release_db_per_second, hold_seconds);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_armsaudio_ArmsaudioModule_setPosition(JNIEnv *env, jobject thiz, jfloat position) {
-    sPlayer.setPosition(position);
+Java_com_armsaudio_ArmsaudioModule_setPositionFrames(JNIEnv *env, jobject thiz, jlong frame) {
+    sPlayer.seekToFrame(frame);
 }
 
 extern "C"
@@ -118,7 +194,7 @@ Java_com_armsaudio_ArmsaudioModule_setTrackVolume(
         jobject thiz,
         jint track_num,
         jfloat volume) {
-    sources[track_num]->setGain(volume);
+    sPlayer.setGain(track_num, volume);
 }
 
 extern "C"
@@ -128,5 +204,198 @@ Java_com_armsaudio_ArmsaudioModule_setTrackPan(
         jobject thiz,
         jint track_num,
         jfloat pan) {
-    sources[track_num]->setPan(pan);
-}
\ No newline at end of file
+    sPlayer.setPan(track_num, pan);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_armsaudio_ArmsaudioModule_getTrackStarvationCount(
+        JNIEnv *env,
+        jobject thiz,
+        jint track_num) {
+    return static_cast<jint>(sPlayer.getStarvationCount(track_num));
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_armsaudio_ArmsaudioModule_createMixBus(JNIEnv *env, jobject thiz) {
+    return sPlayer.createBus();
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_armsaudio_ArmsaudioModule_removeMixBus(JNIEnv *env, jobject thiz, jint bus) {
+    return sPlayer.removeBus(bus);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_armsaudio_ArmsaudioModule_setMixBusOutput(
+        JNIEnv *env,
+        jobject thiz,
+        jint bus,
+        jint output_bus) {
+    return sPlayer.setBusOutput(bus, output_bus);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_armsaudio_ArmsaudioModule_setTrackBus(
+        JNIEnv *env,
+        jobject thiz,
+        jint track_num,
+        jint bus) {
+    return sPlayer.setTrackBus(track_num, bus);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setMixBusGain(JNIEnv *env, jobject thiz, jint bus, jfloat gain) {
+    sPlayer.setBusGain(bus, gain);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setMixBusPan(JNIEnv *env, jobject thiz, jint bus, jfloat pan) {
+    sPlayer.setBusPan(bus, pan);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setMixBusMute(
+        JNIEnv *env,
+        jobject thiz,
+        jint bus,
+        jboolean muted) {
+    sPlayer.setBusMute(bus, muted);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setResamplerQuality(JNIEnv *env, jobject thiz, jint quality) {
+    sPlayer.setResamplerQuality(static_cast<iolib::ResamplerQuality>(quality));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setStreamingWatermarks(
+        JNIEnv *env,
+        jobject thiz,
+        jint low_watermark_frames,
+        jint high_watermark_frames) {
+    sPlayer.setStreamingWatermarks(low_watermark_frames, high_watermark_frames);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_armsaudio_ArmsaudioModule_renderMixdown(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint format) {
+    const char* pathChars = env->GetStringUTFChars(path, 0);
+    bool result = sPlayer.renderMixdown(
+            pathChars, static_cast<parselib::WavStreamWriter::Format>(format));
+    env->ReleaseStringUTFChars(path, pathChars);
+    return result;
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_armsaudio_ArmsaudioModule_getMixdownProgress(JNIEnv *env, jobject thiz) {
+    return sPlayer.getMixdownProgress();
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_armsaudio_ArmsaudioModule_getMixdownSpeed(JNIEnv *env, jobject thiz) {
+    return sPlayer.getMixdownSpeed();
+}
+
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_armsaudio_ArmsaudioModule_getTrackWaveform(
+        JNIEnv *env,
+        jobject thiz,
+        jint track_num,
+        jlong start_frame,
+        jlong end_frame,
+        jint num_peaks) {
+    if (num_peaks <= 0) {
+        return nullptr;
+    }
+
+    // min, max, rms for each peak
+    std::vector<iolib::PeakPyramid::Peak> peaks(num_peaks);
+    if (!sPlayer.getWaveform(track_num, start_frame, end_frame, num_peaks, peaks.data())) {
+        return nullptr;
+    }
+
+    static_assert(sizeof(iolib::PeakPyramid::Peak) == 3 * sizeof(float), "Peak must be packed");
+    jfloatArray result = env->NewFloatArray(num_peaks * 3);
+    env->SetFloatArrayRegion(result, 0, num_peaks * 3, reinterpret_cast<jfloat*>(peaks.data()));
+    return result;
+}
+
+// Callback timing since the last reset, flattened: callbacks, late callbacks, xruns, wall load
+// at p50/p90/p99/p99.9, CPU load at the same, max wall load, max CPU load, then track, mean us,
+// max us for each of the costliest tracks, worst first.
+extern "C"
+JNIEXPORT jdoubleArray JNICALL
+Java_com_armsaudio_ArmsaudioModule_getCallbackReport(JNIEnv *env, jobject thiz, jint max_tracks) {
+    iolib::CallbackProfiler::Report report;
+    sPlayer.getCallbackReport(&report, max_tracks);
+
+    std::vector<jdouble> values = {
+            static_cast<jdouble>(report.numCallbacks),
+            static_cast<jdouble>(report.numLateCallbacks),
+            static_cast<jdouble>(report.numXRuns),
+    };
+    values.insert(values.end(), report.wallLoadPercentiles, report.wallLoadPercentiles + 4);
+    values.insert(values.end(), report.cpuLoadPercentiles, report.cpuLoadPercentiles + 4);
+    values.push_back(report.maxWallLoad);
+    values.push_back(report.maxCpuLoad);
+    for (int32_t index = 0; index < report.numOffenders; index++) {
+        values.push_back(report.offenders[index].track);
+        values.push_back(report.offenders[index].meanMicros);
+        values.push_back(report.offenders[index].maxMicros);
+    }
+
+    jdoubleArray result = env->NewDoubleArray(static_cast<jsize>(values.size()));
+    env->SetDoubleArrayRegion(result, 0, static_cast<jsize>(values.size()), values.data());
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_resetCallbackReport(JNIEnv *env, jobject thiz) {
+    sPlayer.resetCallbackReport();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setAdaptiveLatency(
+        JNIEnv *env,
+        jobject thiz,
+        jboolean enabled,
+        jfloat max_latency_millis) {
+    sPlayer.setMaxLatencyMillis(max_latency_millis);
+    sPlayer.setAdaptiveLatency(enabled);
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_armsaudio_ArmsaudioModule_getOutputLatencyMillis(JNIEnv *env, jobject thiz) {
+    return sPlayer.getOutputLatencyMillis();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_armsaudio_ArmsaudioModule_setParallelMixing(
+        JNIEnv *env,
+        jobject thiz,
+        jboolean enabled,
+        jint min_tracks,
+        jfloat min_load) {
+    sPlayer.setParallelMixing(enabled, min_tracks, min_load);
+}
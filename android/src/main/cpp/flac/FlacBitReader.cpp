@@ -0,0 +1,62 @@
+#include <algorithm>
+
+#include "../stream/InputStream.h"
+
+#include "FlacBitReader.h"
+
+namespace parselib {
+
+    FlacBitReader::FlacBitReader(InputStream* stream)
+            : mStream(stream),
+              mData(mBuffer),
+              mBufferSize(0),
+              mBufferIndex(0),
+              mBufferEndPos(0),
+              mCache(0),
+              mCacheBits(0),
+              mPastEnd(false) {
+    }
+
+    void FlacBitReader::setPosition(int64_t position) {
+        // Resyncing and seeking move about within a block more often than not
+        int64_t bufferStartPos = mBufferEndPos - mBufferSize;
+        if (position >= bufferStartPos && position < mBufferEndPos) {
+            mBufferIndex = static_cast<int32_t>(position - bufferStartPos);
+        } else {
+            mStream->setPos(position);
+            mBufferSize = 0;
+            mBufferIndex = 0;
+            mBufferEndPos = position;
+        }
+        mCache = 0;
+        mCacheBits = 0;
+        mPastEnd = false;
+    }
+
+    void FlacBitReader::refill() {
+        while (mCacheBits <= 56) {
+            if (mBufferIndex == mBufferSize) {
+                int32_t numRead;
+                const void* directData = mStream->peekDirect(&numRead);
+                if (directData != nullptr && numRead > 0) {
+                    // A block at a time all the same, so the stream's read-ahead follows
+                    numRead = std::min(numRead, kBufferBytes);
+                    mStream->advance(numRead);
+                    mData = static_cast<const uint8_t*>(directData);
+                } else {
+                    numRead = mStream->read(mBuffer, kBufferBytes);
+                    mData = mBuffer;
+                }
+                if (numRead <= 0) {
+                    return;
+                }
+                mBufferSize = numRead;
+                mBufferIndex = 0;
+                mBufferEndPos += numRead;
+            }
+            mCache |= static_cast<uint64_t>(mData[mBufferIndex++]) << (56 - mCacheBits);
+            mCacheBits += 8;
+        }
+    }
+
+} // namespace parselib
@@ -0,0 +1,128 @@
+#ifndef _IO_FLAC_FLACBITREADER_H_
+#define _IO_FLAC_FLACBITREADER_H_
+
+#include <cstdint>
+
+namespace parselib {
+
+    class InputStream;
+
+/**
+ * Reads a FLAC bitstream, most significant bit first, from an InputStream that it reads ahead
+ * of in blocks, in place if the stream allows (see InputStream::peekDirect()). Up to 64 bits
+ * are cached, so a field is usually a shift and a mask.
+ *
+ * Reading past the end of the stream returns zeros and sets isPastEnd().
+ */
+    class FlacBitReader {
+    public:
+        explicit FlacBitReader(InputStream* stream);
+
+        /**
+         * Moves to byte position of the stream. What was read ahead is dropped, unless the
+         * position is within it.
+         */
+        void setPosition(int64_t position);
+
+        /**
+         * The stream position of the next byte. Only meaningful at a byte boundary.
+         */
+        int64_t getPosition() const {
+            return mBufferEndPos - (mBufferSize - mBufferIndex) - mCacheBits / 8;
+        }
+
+        bool isPastEnd() const { return mPastEnd; }
+
+        // numBits is 0 to 32
+        uint32_t readBits(int32_t numBits) {
+            if (numBits == 0) {
+                return 0;
+            }
+            if (mCacheBits < numBits) {
+                refill();
+                if (mCacheBits < numBits) {
+                    mPastEnd = true;
+                    mCache = 0;
+                    mCacheBits = 0;
+                    return 0;
+                }
+            }
+            uint32_t value = static_cast<uint32_t>(mCache >> (64 - numBits));
+            mCache <<= numBits;
+            mCacheBits -= numBits;
+            return value;
+        }
+
+        // Two's complement, numBits is 0 to 32
+        int32_t readSignedBits(int32_t numBits) {
+            if (numBits == 0) {
+                return 0;
+            }
+            uint32_t value = readBits(numBits) << (32 - numBits);
+            return static_cast<int32_t>(value) >> (32 - numBits);
+        }
+
+        /**
+         * The number of 0 bits before the next 1, which is consumed too.
+         */
+        uint32_t readUnary() {
+            uint32_t count = 0;
+            while (true) {
+                // The bits below the cached ones are always 0
+                if (mCache != 0) {
+                    int32_t numZeros = __builtin_clzll(mCache);
+                    mCache <<= numZeros;
+                    mCache <<= 1;
+                    mCacheBits -= numZeros + 1;
+                    return count + numZeros;
+                }
+                count += mCacheBits;
+                mCacheBits = 0;
+                refill();
+                if (mCacheBits == 0) {
+                    mPastEnd = true;
+                    return count;
+                }
+            }
+        }
+
+        /**
+         * Rice coded signed value with parameter riceParameter, as in a FLAC residual.
+         */
+        int32_t readRice(int32_t riceParameter) {
+            uint32_t quotient = readUnary();
+            uint32_t value = (quotient << riceParameter) | readBits(riceParameter);
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+        void alignToByte() {
+            int32_t numBits = mCacheBits % 8;
+            mCache <<= numBits;
+            mCacheBits -= numBits;
+        }
+
+    private:
+        static constexpr int32_t kBufferBytes = 16384;
+
+        InputStream* mStream;
+
+        // The block read ahead: mBuffer, or the stream's own memory
+        uint8_t mBuffer[kBufferBytes];
+        const uint8_t* mData;
+        int32_t mBufferSize;
+        int32_t mBufferIndex;
+        int64_t mBufferEndPos;      // stream position of the byte after the buffer's last
+
+        // The next mCacheBits bits, from the most significant, and zeros
+        uint64_t mCache;
+        int32_t mCacheBits;
+
+        bool mPastEnd;
+
+        // Tops the cache up to at least 57 bits, fewer at the end of the stream
+        void refill();
+    };
+
+} // namespace parselib
+
+#endif // _IO_FLAC_FLACBITREADER_H_
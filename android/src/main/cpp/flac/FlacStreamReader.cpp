@@ -0,0 +1,646 @@
+#include <algorithm>
+#include <string.h>
+
+#include <android/log.h>
+
+#include "../stream/InputStream.h"
+
+#include "FlacStreamReader.h"
+
+static const char *TAG = "FlacStreamReader";
+
+namespace parselib {
+
+    // METADATA_BLOCK types
+    static constexpr int32_t kStreamInfoBlock = 0;
+    static constexpr int32_t kSeekTableBlock = 3;
+
+    static constexpr int32_t kStreamInfoBytes = 34;
+    static constexpr int32_t kSeekPointBytes = 18;
+
+    // Channel assignments beyond the independent ones, which are the channel count - 1
+    static constexpr int32_t kLeftSide = 8;
+    static constexpr int32_t kSideRight = 9;
+    static constexpr int32_t kMidSide = 10;
+
+    static uint8_t updateCrc8(uint8_t crc, uint32_t byte) {
+        crc ^= static_cast<uint8_t>(byte);
+        for (int32_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) != 0 ? static_cast<uint8_t>((crc << 1) ^ 0x07)
+                                    : static_cast<uint8_t>(crc << 1);
+        }
+        return crc;
+    }
+
+    static int64_t readBigEndian(const uint8_t* data, int32_t numBytes) {
+        uint64_t value = 0;
+        for (int32_t index = 0; index < numBytes; index++) {
+            value = (value << 8) | data[index];
+        }
+        return static_cast<int64_t>(value);
+    }
+
+    FlacStreamReader::FlacStreamReader(InputStream *stream)
+            : mStream(stream),
+              mBits(stream),
+              mHasStreamInfo(false),
+              mMinBlockSize(0),
+              mMaxBlockSize(0),
+              mMaxFrameBytes(0),
+              mSampleRate(0),
+              mNumChannels(0),
+              mBitsPerSample(0),
+              mTotalSamples(0),
+              mFirstFramePos(-1),
+              mLearnSeekPoints(false),
+              mBlockStart(0),
+              mBlockSize(0),
+              mBlockFrame(0) {
+    }
+
+    void FlacStreamReader::parse() {
+        // Skip an ID3v2 tag, its size is "syncsafe": 7 bits a byte
+        uint8_t id3Header[10];
+        if (mStream->peek(id3Header, sizeof(id3Header)) == sizeof(id3Header)
+            && memcmp(id3Header, "ID3", 3) == 0) {
+            int32_t tagSize = (id3Header[6] & 0x7F) << 21 | (id3Header[7] & 0x7F) << 14
+                              | (id3Header[8] & 0x7F) << 7 | (id3Header[9] & 0x7F);
+            if ((id3Header[5] & 0x10) != 0) {
+                tagSize += sizeof(id3Header); // the footer
+            }
+            mStream->advance(sizeof(id3Header) + tagSize);
+        }
+
+        uint8_t magic[4];
+        if (mStream->read(magic, sizeof(magic)) != sizeof(magic)
+            || memcmp(magic, "fLaC", sizeof(magic)) != 0) {
+            return;
+        }
+
+        bool isLast = false;
+        while (!isLast) {
+            uint8_t blockHeader[4];
+            if (mStream->read(blockHeader, sizeof(blockHeader)) != sizeof(blockHeader)) {
+                mHasStreamInfo = false; // truncated
+                return;
+            }
+            isLast = (blockHeader[0] & 0x80) != 0;
+            int32_t type = blockHeader[0] & 0x7F;
+            int32_t length = static_cast<int32_t>(readBigEndian(blockHeader + 1, 3));
+
+            if (type == kStreamInfoBlock && length >= kStreamInfoBytes) {
+                uint8_t streamInfo[kStreamInfoBytes];
+                if (mStream->read(streamInfo, kStreamInfoBytes) != kStreamInfoBytes) {
+                    return;
+                }
+                parseStreamInfo(streamInfo);
+                mStream->advance(length - kStreamInfoBytes);
+            } else if (type == kSeekTableBlock) {
+                parseSeekTable(length);
+            } else {
+                mStream->advance(length); // VORBIS_COMMENT, PICTURE, PADDING...
+            }
+        }
+
+        if (!isValid()) {
+            return;
+        }
+
+        mFirstFramePos = mStream->getPos();
+        mBlock.assign(static_cast<size_t>(mNumChannels) * mMaxBlockSize, 0);
+
+        mLearnSeekPoints = mSeekPoints.empty();
+        if (mLearnSeekPoints) {
+            mSeekPoints.reserve(static_cast<size_t>(
+                    std::min<int64_t>(mTotalSamples / kLearnedSeekInterval + 1, 1 << 16)));
+        }
+
+        positionToAudio();
+    }
+
+    void FlacStreamReader::parseStreamInfo(const uint8_t* data) {
+        // Bit fields, from byte 10: 20 bits of sample rate, 3 of channels - 1, 5 of bits per
+        // sample - 1 and 36 of total samples
+        mMinBlockSize = static_cast<int32_t>(readBigEndian(data, 2));
+        mMaxBlockSize = static_cast<int32_t>(readBigEndian(data + 2, 2));
+        mMaxFrameBytes = static_cast<int32_t>(readBigEndian(data + 7, 3));
+        mSampleRate = data[10] << 12 | data[11] << 4 | data[12] >> 4;
+        mNumChannels = ((data[12] >> 1) & 0x07) + 1;
+        mBitsPerSample = ((data[12] & 0x01) << 4 | data[13] >> 4) + 1;
+        mTotalSamples = static_cast<int64_t>(data[13] & 0x0F) << 32 | readBigEndian(data + 14, 4);
+        mHasStreamInfo = true;
+    }
+
+    void FlacStreamReader::parseSeekTable(int32_t length) {
+        int32_t numPoints = length / kSeekPointBytes;
+        mSeekPoints.reserve(numPoints);
+        for (int32_t index = 0; index < numPoints; index++) {
+            uint8_t data[kSeekPointBytes];
+            if (mStream->read(data, kSeekPointBytes) != kSeekPointBytes) {
+                return;
+            }
+            // Placeholders have a sample number of all ones
+            SeekPoint point { readBigEndian(data, 8), readBigEndian(data + 8, 8) };
+            if (point.sampleNumber >= 0 && point.offset >= 0) {
+                mSeekPoints.push_back(point);
+            }
+        }
+        mStream->advance(length - numPoints * kSeekPointBytes);
+
+        std::sort(mSeekPoints.begin(), mSeekPoints.end(),
+                  [](const SeekPoint& a, const SeekPoint& b) {
+                      return a.sampleNumber < b.sampleNumber;
+                  });
+    }
+
+    bool FlacStreamReader::isValid() {
+        return mHasStreamInfo
+               && mNumChannels > 0 && mNumChannels <= kMaxChannels
+               && mBitsPerSample >= 4 && mBitsPerSample <= kMaxBitsPerSample
+               && mSampleRate > 0
+               && mMaxBlockSize >= 16
+               && mTotalSamples > 0;
+    }
+
+// Data access
+    void FlacStreamReader::positionToAudio() {
+        if (mFirstFramePos >= 0) {
+            mBits.setPosition(mFirstFramePos);
+            mBlockStart = 0;
+            mBlockSize = 0;
+            mBlockFrame = 0;
+        }
+    }
+
+    void FlacStreamReader::setDataPosition(int64_t frameIndex) {
+        if (mFirstFramePos < 0) {
+            return;
+        }
+        int64_t target = std::max<int64_t>(0, std::min<int64_t>(frameIndex, mTotalSamples));
+        int64_t blockEnd = mBlockStart + mBlockSize;
+        if (target >= mBlockStart && target < blockEnd) {
+            mBlockFrame = static_cast<int32_t>(target - mBlockStart);
+            return;
+        }
+
+        // The seek points around the target bound the search: the last at or before it, or
+        // the first frame, and the first after it, or the end of the data
+        auto point = std::upper_bound(mSeekPoints.begin(), mSeekPoints.end(), target,
+                                      [](int64_t sampleNumber, const SeekPoint& point) {
+                                          return sampleNumber < point.sampleNumber;
+                                      });
+        int64_t lowSample = 0;
+        int64_t lowPos = mFirstFramePos;
+        if (point != mSeekPoints.begin()) {
+            lowSample = (point - 1)->sampleNumber;
+            lowPos = mFirstFramePos + (point - 1)->offset;
+        }
+        // Unless the frame after the current one is nearer
+        if (mBlockSize > 0 && target >= blockEnd && blockEnd > lowSample) {
+            lowSample = blockEnd;
+            lowPos = mBits.getPosition();
+        }
+        int64_t highPos = point != mSeekPoints.end()
+                          ? mFirstFramePos + point->offset
+                          : lowPos + getMaxDataBytes(mTotalSamples - lowSample);
+
+        // lowPos is a frame that starts at or before the target, no frame from highPos on
+        // does. Bisect until there is little left to decode between them.
+        while (highPos - lowPos > kMinBisectBytes) {
+            int64_t probe = lowPos + (highPos - lowPos) / 2;
+            FrameHeader header;
+            int64_t framePos = findFrame(probe, highPos, lowSample, &header);
+            if (framePos < 0 || header.sampleNumber > target) {
+                highPos = probe;
+            } else {
+                lowSample = header.sampleNumber;
+                lowPos = framePos;
+                if (target < header.sampleNumber + header.blockSize) {
+                    break;
+                }
+            }
+        }
+
+        mBits.setPosition(lowPos);
+        mBlockStart = lowSample;
+        mBlockSize = 0;
+        mBlockFrame = 0;
+        while (decodeFrame()) {
+            if (target < mBlockStart + mBlockSize) {
+                mBlockFrame = static_cast<int32_t>(std::max<int64_t>(0, target - mBlockStart));
+                return;
+            }
+        }
+    }
+
+    int64_t FlacStreamReader::getMaxDataBytes(int64_t numSamples) {
+        // STREAMINFO's largest frame if it has one, else a verbatim frame of the largest block
+        // (the side channel has a bit more) with a generous header
+        int64_t frameBytes = mMaxFrameBytes > 0
+                             ? mMaxFrameBytes
+                             : (static_cast<int64_t>(mMaxBlockSize) * mNumChannels
+                                * (mBitsPerSample + 1) + 7) / 8 + 64;
+        int64_t minBlockSize = std::max(mMinBlockSize, 16);
+        return (numSamples / minBlockSize + 1) * frameBytes;
+    }
+
+    void FlacStreamReader::learnSeekPoint(int64_t sampleNumber, int64_t framePos) {
+        // In order, kLearnedSeekInterval apart at least, wherever seeks have decoded
+        auto next = std::upper_bound(mSeekPoints.begin(), mSeekPoints.end(), sampleNumber,
+                                     [](int64_t sampleNumber, const SeekPoint& point) {
+                                         return sampleNumber < point.sampleNumber;
+                                     });
+        if ((next == mSeekPoints.end()
+             || next->sampleNumber - sampleNumber >= kLearnedSeekInterval)
+            && (next == mSeekPoints.begin()
+                || sampleNumber - (next - 1)->sampleNumber >= kLearnedSeekInterval)) {
+            mSeekPoints.insert(next, { sampleNumber, framePos - mFirstFramePos });
+        }
+    }
+
+    bool FlacStreamReader::readFrameHeader(FrameHeader* header) {
+        // Every byte from the sync code on is covered by the CRC-8 that ends the header, the
+        // first (0xFF) has been read
+        uint8_t crc = updateCrc8(0, 0xFF);
+        auto readByte = [this, &crc]() -> uint32_t {
+            uint32_t byte = mBits.readBits(8);
+            crc = updateCrc8(crc, byte);
+            return byte;
+        };
+
+        uint32_t byte = readByte();
+        if ((byte & 0xFE) != 0xF8) {
+            return false;
+        }
+        bool variableBlockSize = (byte & 0x01) != 0;
+
+        byte = readByte();
+        int32_t blockSizeCode = byte >> 4;
+        int32_t sampleRateCode = byte & 0x0F;
+
+        byte = readByte();
+        int32_t channelAssignment = byte >> 4;
+        int32_t sampleSizeCode = (byte >> 1) & 0x07;
+        if (blockSizeCode == 0 || sampleRateCode == 15 || channelAssignment > kMidSide
+            || sampleSizeCode == 3 || (byte & 0x01) != 0) {
+            return false;
+        }
+
+        // The frame or sample number, coded as UTF-8 (extended to 36 bits)
+        byte = readByte();
+        int32_t numLeadingOnes = __builtin_clz(~(byte << 24));
+        if (numLeadingOnes == 1 || numLeadingOnes > 7) {
+            return false;
+        }
+        int64_t number = byte & (0x7F >> numLeadingOnes);
+        for (int32_t index = 1; index < numLeadingOnes; index++) {
+            byte = readByte();
+            if ((byte & 0xC0) != 0x80) {
+                return false;
+            }
+            number = (number << 6) | (byte & 0x3F);
+        }
+
+        int32_t blockSize;
+        if (blockSizeCode == 1) {
+            blockSize = 192;
+        } else if (blockSizeCode <= 5) {
+            blockSize = 576 << (blockSizeCode - 2);
+        } else if (blockSizeCode == 6) {
+            blockSize = readByte() + 1;
+        } else if (blockSizeCode == 7) {
+            blockSize = readByte() << 8;
+            blockSize = (blockSize | readByte()) + 1;
+        } else {
+            blockSize = 256 << (blockSizeCode - 8);
+        }
+
+        // The frame's own sample rate is of no use, the stream has one
+        if (sampleRateCode == 12) {
+            readByte();
+        } else if (sampleRateCode == 13 || sampleRateCode == 14) {
+            readByte();
+            readByte();
+        }
+
+        static const int32_t kSampleSizes[] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+        int32_t bitsPerSample = sampleSizeCode == 0 ? mBitsPerSample : kSampleSizes[sampleSizeCode];
+        int32_t numChannels = channelAssignment < kLeftSide ? channelAssignment + 1 : 2;
+
+        if (mBits.readBits(8) != crc || mBits.isPastEnd()
+            || blockSize > mMaxBlockSize || bitsPerSample != mBitsPerSample
+            || numChannels != mNumChannels) {
+            return false;
+        }
+
+        header->sampleNumber = variableBlockSize ? number : number * mMaxBlockSize;
+        header->blockSize = blockSize;
+        header->channelAssignment = channelAssignment;
+        header->bitsPerSample = bitsPerSample;
+        return true;
+    }
+
+    int64_t FlacStreamReader::findFrame(int64_t position, int64_t endPosition,
+                                        int64_t afterSample, FrameHeader* header) {
+        // The first frame header from position on, before endPosition. A sync code and a CRC-8
+        // can match by chance in the audio data, the sample number must follow afterSample too.
+        mBits.setPosition(position);
+        while (true) {
+            int64_t framePos = mBits.getPosition();
+            if (framePos >= endPosition) {
+                return -1;
+            }
+            uint32_t sync = mBits.readBits(8);
+            if (mBits.isPastEnd()) {
+                return -1;
+            }
+            if (sync != 0xFF) {
+                continue;
+            }
+            if (readFrameHeader(header) && header->sampleNumber > afterSample
+                && header->sampleNumber < mTotalSamples) {
+                return framePos;
+            }
+            if (mBits.isPastEnd()) {
+                return -1;
+            }
+            mBits.setPosition(framePos + 1);
+        }
+    }
+
+    bool FlacStreamReader::decodeFrame() {
+        mBits.alignToByte();
+        while (true) {
+            // Frames follow each other, unless the data is corrupt: then look for the next
+            int64_t framePos = mBits.getPosition();
+            uint32_t sync = mBits.readBits(8);
+            if (mBits.isPastEnd()) {
+                break;
+            }
+            if (sync != 0xFF) {
+                continue;
+            }
+            FrameHeader header;
+            if (!readFrameHeader(&header)) {
+                if (mBits.isPastEnd()) {
+                    break;
+                }
+                mBits.setPosition(framePos + 1);
+                continue;
+            }
+
+            bool decoded = true;
+            for (int32_t channel = 0; channel < mNumChannels && decoded; channel++) {
+                // The side channel has a bit more
+                bool isSide = (header.channelAssignment == kLeftSide && channel == 1)
+                              || (header.channelAssignment == kSideRight && channel == 0)
+                              || (header.channelAssignment == kMidSide && channel == 1);
+                decoded = decodeSubframe(getPlane(channel), header.blockSize,
+                                         header.bitsPerSample + (isSide ? 1 : 0));
+            }
+            if (mBits.isPastEnd()) {
+                break;
+            }
+            if (!decoded) {
+                __android_log_print(ANDROID_LOG_WARN, TAG, "corrupt frame at %lld",
+                                    static_cast<long long>(framePos));
+                mBits.setPosition(framePos + 1);
+                continue;
+            }
+
+            // Padding to the byte, then the CRC-16
+            mBits.alignToByte();
+            mBits.readBits(16);
+            decorrelate(header.channelAssignment, header.blockSize);
+
+            if (mLearnSeekPoints) {
+                learnSeekPoint(header.sampleNumber, framePos);
+            }
+
+            mBlockStart = header.sampleNumber;
+            mBlockSize = header.blockSize;
+            mBlockFrame = 0;
+            return true;
+        }
+
+        // The end of the data
+        mBlockStart += mBlockSize;
+        mBlockSize = 0;
+        mBlockFrame = 0;
+        return false;
+    }
+
+    bool FlacStreamReader::decodeSubframe(int32_t* samples, int32_t blockSize,
+                                          int32_t bitsPerSample) {
+        if (mBits.readBits(1) != 0) {
+            return false;
+        }
+        uint32_t type = mBits.readBits(6);
+
+        // Wasted bits: low bits that are zero in every sample, left out
+        int32_t wastedBits = 0;
+        if (mBits.readBits(1) != 0) {
+            wastedBits = static_cast<int32_t>(mBits.readUnary()) + 1;
+            bitsPerSample -= wastedBits;
+            if (bitsPerSample <= 0) {
+                return false;
+            }
+        }
+
+        if (type == 0) {
+            // CONSTANT
+            std::fill(samples, samples + blockSize, mBits.readSignedBits(bitsPerSample));
+        } else if (type == 1) {
+            // VERBATIM
+            for (int32_t index = 0; index < blockSize; index++) {
+                samples[index] = mBits.readSignedBits(bitsPerSample);
+            }
+        } else if (type >= 8 && type <= 12) {
+            // FIXED: polynomial predictors of order 0 to 4
+            int32_t order = type - 8;
+            if (order > blockSize) {
+                return false;
+            }
+            for (int32_t index = 0; index < order; index++) {
+                samples[index] = mBits.readSignedBits(bitsPerSample);
+            }
+            if (!decodeResidual(samples, blockSize, order)) {
+                return false;
+            }
+            int32_t* sample = samples + order;
+            int32_t* end = samples + blockSize;
+            switch (order) {
+                case 1:
+                    for (; sample < end; sample++) {
+                        *sample += sample[-1];
+                    }
+                    break;
+                case 2:
+                    for (; sample < end; sample++) {
+                        *sample += 2 * sample[-1] - sample[-2];
+                    }
+                    break;
+                case 3:
+                    for (; sample < end; sample++) {
+                        *sample += 3 * (sample[-1] - sample[-2]) + sample[-3];
+                    }
+                    break;
+                case 4:
+                    for (; sample < end; sample++) {
+                        *sample += 4 * (sample[-1] + sample[-3]) - 6 * sample[-2] - sample[-4];
+                    }
+                    break;
+                default:
+                    break;
+            }
+        } else if (type >= 32) {
+            // LPC of order 1 to 32, with quantized coefficients
+            int32_t order = type - 31;
+            if (order > blockSize) {
+                return false;
+            }
+            for (int32_t index = 0; index < order; index++) {
+                samples[index] = mBits.readSignedBits(bitsPerSample);
+            }
+            int32_t precision = mBits.readBits(4) + 1;
+            int32_t shift = mBits.readSignedBits(5);
+            if (precision == 16 || shift < 0) {
+                return false;
+            }
+            int32_t coefficients[32];
+            for (int32_t index = 0; index < order; index++) {
+                coefficients[index] = mBits.readSignedBits(precision);
+            }
+            if (!decodeResidual(samples, blockSize, order)) {
+                return false;
+            }
+
+            // The sum can take more than 32 bits at 24 bits per sample
+            for (int32_t index = order; index < blockSize; index++) {
+                const int32_t* history = samples + index;
+                int64_t prediction = 0;
+                for (int32_t tap = 0; tap < order; tap++) {
+                    prediction += static_cast<int64_t>(coefficients[tap]) * history[-1 - tap];
+                }
+                samples[index] += static_cast<int32_t>(prediction >> shift);
+            }
+        } else {
+            return false; // reserved
+        }
+
+        if (wastedBits > 0) {
+            for (int32_t index = 0; index < blockSize; index++) {
+                samples[index] = static_cast<int32_t>(static_cast<uint32_t>(samples[index])
+                                                      << wastedBits);
+            }
+        }
+        return !mBits.isPastEnd();
+    }
+
+    bool FlacStreamReader::decodeResidual(int32_t* samples, int32_t blockSize,
+                                          int32_t predictorOrder) {
+        // Rice coding with 4 or 5 bit parameters, in 2^order partitions of the block
+        uint32_t method = mBits.readBits(2);
+        if (method > 1) {
+            return false;
+        }
+        int32_t parameterBits = method == 0 ? 4 : 5;
+        uint32_t escapeParameter = (1u << parameterBits) - 1;
+
+        int32_t partitionOrder = mBits.readBits(4);
+        int32_t partitionSize = blockSize >> partitionOrder;
+        if ((partitionSize << partitionOrder) != blockSize || partitionSize < predictorOrder) {
+            return false;
+        }
+
+        // The warm-up samples take the place of the first partition's first residuals
+        int32_t* residual = samples + predictorOrder;
+        int32_t numPartitions = 1 << partitionOrder;
+        for (int32_t partition = 0; partition < numPartitions; partition++) {
+            int32_t numResiduals = partition == 0 ? partitionSize - predictorOrder : partitionSize;
+            uint32_t parameter = mBits.readBits(parameterBits);
+            if (parameter == escapeParameter) {
+                // Unencoded, in a given number of bits
+                int32_t numBits = mBits.readBits(5);
+                for (int32_t index = 0; index < numResiduals; index++) {
+                    residual[index] = mBits.readSignedBits(numBits);
+                }
+            } else {
+                for (int32_t index = 0; index < numResiduals; index++) {
+                    residual[index] = mBits.readRice(parameter);
+                }
+            }
+            residual += numResiduals;
+            if (mBits.isPastEnd()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void FlacStreamReader::decorrelate(int32_t channelAssignment, int32_t blockSize) {
+        int32_t* first = getPlane(0);
+        int32_t* second = getPlane(1);
+        switch (channelAssignment) {
+            case kLeftSide:
+                for (int32_t index = 0; index < blockSize; index++) {
+                    second[index] = first[index] - second[index];
+                }
+                break;
+
+            case kSideRight:
+                for (int32_t index = 0; index < blockSize; index++) {
+                    first[index] += second[index];
+                }
+                break;
+
+            case kMidSide:
+                for (int32_t index = 0; index < blockSize; index++) {
+                    // The side's low bit is the one the mid lost
+                    int32_t side = second[index];
+                    int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(first[index]) << 1)
+                                  | (side & 1);
+                    first[index] = (mid + side) >> 1;
+                    second[index] = (mid - side) >> 1;
+                }
+                break;
+
+            default:
+                break; // independent channels
+        }
+    }
+
+    int FlacStreamReader::getDataFloat(float *buff, int numFrames) {
+        if (mFirstFramePos < 0) {
+            return ERR_INVALID_STATE;
+        }
+
+        int numChannels = mNumChannels;
+        float scale = 1.0f / static_cast<float>(1 << (mBitsPerSample - 1));
+        int numFramesRead = 0;
+        while (numFramesRead < numFrames) {
+            if (mBlockFrame >= mBlockSize && !decodeFrame()) {
+                break;
+            }
+            int32_t numToCopy = std::min(numFrames - numFramesRead, mBlockSize - mBlockFrame);
+            float* output = buff + numFramesRead * numChannels;
+            for (int32_t channel = 0; channel < numChannels; channel++) {
+                const int32_t* input = getPlane(channel) + mBlockFrame;
+                for (int32_t index = 0; index < numToCopy; index++) {
+                    output[index * numChannels + channel] = input[index] * scale;
+                }
+            }
+            mBlockFrame += numToCopy;
+            numFramesRead += numToCopy;
+        }
+
+        // Zero out any unread frames
+        if (numFramesRead < numFrames) {
+            memset(buff + (numFramesRead * numChannels), 0,
+                   (numFrames - numFramesRead) * sizeof(buff[0]) * numChannels);
+        }
+
+        return numFramesRead;
+    }
+
+} // namespace parselib
@@ -0,0 +1,110 @@
+#ifndef _IO_FLAC_FLACSTREAMREADER_H_
+#define _IO_FLAC_FLACSTREAMREADER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "../wav/AudioStreamReader.h"
+#include "FlacBitReader.h"
+
+/*
+ * FLAC format documentation can be found:
+ * https://xiph.org/flac/format.html
+ * https://datatracker.ietf.org/doc/rfc9639/
+ */
+namespace parselib {
+
+/**
+ * Decodes a native FLAC stream (not Ogg FLAC) a frame at a time, so it streams from disk like a
+ * WAV file: only the current block is held decoded.
+ *
+ * Seeks bisect the bytes between the seek points around the target for the frame that holds
+ * it, probing for frame sync codes whose header CRC-8 checks out, then decode forward from the
+ * last frame found before the target. The seek points are the SEEKTABLE's or, for files
+ * without one, points learned from the frames decoded so far: they only narrow the bisection.
+ *
+ * Up to 8 channels of up to 24 bits, as the reference encoder wrote before 1.4. The frames'
+ * CRC-16 isn't checked, their headers' CRC-8 is, to find the next frame after corrupt data.
+ */
+    class FlacStreamReader : public AudioStreamReader {
+    public:
+        static constexpr int32_t kMaxChannels = 8;
+        static constexpr int32_t kMaxBitsPerSample = 24;
+
+        explicit FlacStreamReader(InputStream *stream);
+
+        void parse() override;
+        bool isValid() override;
+
+        int getSampleRate() override { return mSampleRate; }
+        int getNumChannels() override { return mNumChannels; }
+        int64_t getNumSampleFrames() override { return mTotalSamples; }
+        int getBitsPerSample() override { return mBitsPerSample; }
+
+        // Data access
+        void positionToAudio() override;
+        void setDataPosition(int64_t frameIndex) override;
+
+        int getDataFloat(float *buff, int numFrames) override;
+
+    private:
+        // Seek points learned while decoding a file without a SEEKTABLE, in samples
+        static constexpr int64_t kLearnedSeekInterval = 1 << 16;
+        // Seeks stop bisecting and decode forward once the range is this small, in bytes
+        static constexpr int64_t kMinBisectBytes = 1 << 15;
+
+        struct SeekPoint {
+            int64_t sampleNumber;
+            int64_t offset;         // from the first frame
+        };
+
+        struct FrameHeader {
+            int64_t sampleNumber;   // of the frame's first sample
+            int32_t blockSize;
+            int32_t channelAssignment;
+            int32_t bitsPerSample;
+        };
+
+        InputStream *mStream;
+        FlacBitReader mBits;
+
+        // STREAMINFO
+        bool mHasStreamInfo;
+        int32_t mMinBlockSize;
+        int32_t mMaxBlockSize;
+        int32_t mMaxFrameBytes;                 // 0 if unknown
+        int32_t mSampleRate;
+        int32_t mNumChannels;
+        int32_t mBitsPerSample;
+        int64_t mTotalSamples;
+
+        int64_t mFirstFramePos;
+        std::vector<SeekPoint> mSeekPoints;     // by sample number
+        bool mLearnSeekPoints;
+
+        // The last frame decoded, a plane of mMaxBlockSize samples per channel
+        std::vector<int32_t> mBlock;
+        int64_t mBlockStart;
+        int32_t mBlockSize;
+        int32_t mBlockFrame;                    // the next to read
+
+        void parseStreamInfo(const uint8_t* data);
+        void parseSeekTable(int32_t length);
+
+        int64_t getMaxDataBytes(int64_t numSamples);
+        void learnSeekPoint(int64_t sampleNumber, int64_t framePos);
+
+        bool readFrameHeader(FrameHeader* header);
+        int64_t findFrame(int64_t position, int64_t endPosition, int64_t afterSample,
+                          FrameHeader* header);
+        bool decodeFrame();
+        bool decodeSubframe(int32_t* samples, int32_t blockSize, int32_t bitsPerSample);
+        bool decodeResidual(int32_t* samples, int32_t blockSize, int32_t predictorOrder);
+        void decorrelate(int32_t channelAssignment, int32_t blockSize);
+
+        int32_t* getPlane(int32_t channel) { return mBlock.data() + channel * mMaxBlockSize; }
+    };
+
+} // namespace parselib
+
+#endif // _IO_FLAC_FLACSTREAMREADER_H_
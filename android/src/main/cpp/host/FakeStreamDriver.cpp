@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "FakeStreamDriver.h"
+
+namespace iolib {
+
+    FakeStreamDriver::FakeStreamDriver(const Config& config)
+            : mConfig(config),
+              mCapacityFrames(config.framesPerBurst * std::max(1, config.bufferCapacityInBursts)),
+              mBufferFrames(0),
+              mLevel(0),
+              mNow(0.0),
+              mNextDrain(0.0),
+              mXRunCount(0),
+              mCallbackCount(0),
+              mBurstBuffer(config.framesPerBurst * config.channelCount) {
+        setBufferSizeInFrames(config.framesPerBurst * config.bufferSizeInBursts);
+        mNextDrain = getBurstSeconds();
+    }
+
+    double FakeStreamDriver::getBurstSeconds() const {
+        return mConfig.framesPerBurst / static_cast<double>(mConfig.sampleRate);
+    }
+
+    int32_t FakeStreamDriver::setBufferSizeInFrames(int32_t numFrames) {
+        mBufferFrames = std::max(mConfig.framesPerBurst, std::min(numFrames, mCapacityFrames));
+        return mBufferFrames;
+    }
+
+    void FakeStreamDriver::injectStall(int64_t callbackIndex, double seconds) {
+        auto position = std::lower_bound(
+                mStalls.begin(), mStalls.end(), std::make_pair(callbackIndex, 0.0));
+        mStalls.insert(position, std::make_pair(callbackIndex, seconds));
+    }
+
+    double FakeStreamDriver::takeStall(int64_t callbackIndex) {
+        double seconds = 0.0;
+        while (!mStalls.empty() && mStalls.front().first <= callbackIndex) {
+            if (mStalls.front().first == callbackIndex) {
+                seconds += mStalls.front().second;
+            }
+            mStalls.erase(mStalls.begin());
+        }
+        return seconds;
+    }
+
+    void FakeStreamDriver::drainUntil(double time) {
+        double burstSeconds = getBurstSeconds();
+        while (mNextDrain <= time) {
+            if (mLevel >= mConfig.framesPerBurst) {
+                mLevel -= mConfig.framesPerBurst;
+            } else {
+                // The device plays silence, and the stream skips ahead rather than fall behind
+                mXRunCount++;
+                mLevel = 0;
+            }
+            mNextDrain += burstSeconds;
+        }
+    }
+
+    int64_t FakeStreamDriver::run(int64_t numCallbacks, const DataCallback& callback) {
+        using Clock = std::chrono::steady_clock;
+        mCallbackSeconds.clear();
+        mCallbackSeconds.reserve(static_cast<size_t>(numCallbacks));
+
+        Clock::time_point wallStart = Clock::now();
+        double streamStart = mNow;
+        int32_t burstFrames = mConfig.framesPerBurst;
+        int64_t numRun = 0;
+        while (numRun < numCallbacks) {
+            // Wait for the device to make room for a burst
+            if (mLevel + burstFrames > mBufferFrames) {
+                mNow = std::max(mNow, mNextDrain);
+                drainUntil(mNow);
+                continue;
+            }
+
+            if (mConfig.paced) {
+                std::this_thread::sleep_until(
+                        wallStart + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(mNow - streamStart)));
+            }
+
+            std::fill(mBurstBuffer.begin(), mBurstBuffer.end(), 0.0f);
+            Clock::time_point callbackStart = Clock::now();
+            bool keepGoing = callback(mBurstBuffer.data(), burstFrames);
+            double seconds = std::chrono::duration<double>(Clock::now() - callbackStart).count();
+            mCallbackSeconds.push_back(seconds);
+
+            // The device keeps draining while the callback runs, the burst lands at its end
+            mNow += seconds + takeStall(mCallbackCount);
+            drainUntil(mNow);
+            mLevel = std::min(mLevel + burstFrames, mCapacityFrames);
+            mCallbackCount++;
+            numRun++;
+            if (!keepGoing) {
+                break;
+            }
+        }
+        return numRun;
+    }
+
+} // namespace iolib
@@ -0,0 +1,103 @@
+#ifndef _HOST_FAKESTREAMDRIVER_H_
+#define _HOST_FAKESTREAMDRIVER_H_
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace iolib {
+
+/**
+ * Stands in for an Oboe output stream on a desktop host, so the engine can be driven and
+ * measured without a device.
+ *
+ * The device is simulated: it drains one burst from the stream buffer every burst period, and
+ * the data callback is called whenever there is room for a burst, as with a callback stream.
+ * A callback takes as long in simulated time as it took on the wall clock (plus any stall
+ * injected for it), so a slow callback makes the device find the buffer empty: an xrun, which
+ * drops a burst as a real stream would. Runs unpaced (as fast as the host can) by default,
+ * or paced to the wall clock.
+ *
+ * Not thread safe, but the callback may call the setters and getters.
+ */
+    class FakeStreamDriver {
+    public:
+        struct Config {
+            int32_t sampleRate = 48000;
+            int32_t channelCount = 2;
+            int32_t framesPerBurst = 192;
+            int32_t bufferCapacityInBursts = 8;
+            int32_t bufferSizeInBursts = 2;     // the initial buffer size
+            bool paced = false;                 // sleep so callbacks happen in real time
+        };
+
+        // Fills numFrames interleaved frames. Returns false to stop the stream.
+        typedef std::function<bool(float* audioData, int32_t numFrames)> DataCallback;
+
+        explicit FakeStreamDriver(const Config& config);
+
+        int32_t getSampleRate() const { return mConfig.sampleRate; }
+        int32_t getChannelCount() const { return mConfig.channelCount; }
+        int32_t getFramesPerBurst() const { return mConfig.framesPerBurst; }
+        int32_t getBufferCapacityInFrames() const { return mCapacityFrames; }
+        double getBurstSeconds() const;
+
+        /**
+         * As oboe::AudioStream::setBufferSizeInFrames(): clamped to one burst and the
+         * capacity. Returns the size set.
+         */
+        int32_t setBufferSizeInFrames(int32_t numFrames);
+        int32_t getBufferSizeInFrames() const { return mBufferFrames; }
+
+        // Bursts the device found missing since the stream was created
+        int32_t getXRunCount() const { return mXRunCount; }
+
+        // Callbacks run since the stream was created
+        int64_t getCallbackCount() const { return mCallbackCount; }
+
+        /**
+         * Callback number callbackIndex (counting from 0 over the life of the driver) takes
+         * seconds longer than it does, as if preempted. For testing the reaction to xruns.
+         */
+        void injectStall(int64_t callbackIndex, double seconds);
+
+        /**
+         * Runs numCallbacks callbacks (fewer if the callback returns false) on the calling
+         * thread. Returns the number run.
+         */
+        int64_t run(int64_t numCallbacks, const DataCallback& callback);
+
+        /**
+         * Wall time each callback of the last run() took, in seconds, stalls excluded.
+         */
+        const std::vector<double>& getCallbackSeconds() const { return mCallbackSeconds; }
+
+        // Simulated time since the stream was created, in seconds
+        double getStreamSeconds() const { return mNow; }
+
+    private:
+        Config mConfig;
+        int32_t mCapacityFrames;
+        int32_t mBufferFrames;
+
+        // Frames written and not yet drained by the device
+        int32_t mLevel;
+        double mNow;
+        double mNextDrain;
+        int32_t mXRunCount;
+        int64_t mCallbackCount;
+
+        std::vector<std::pair<int64_t, double>> mStalls;    // sorted by callback
+        std::vector<double> mCallbackSeconds;
+        std::vector<float> mBurstBuffer;
+
+        double takeStall(int64_t callbackIndex);
+
+        // The device drains the bursts due up to time
+        void drainUntil(double time);
+    };
+
+} // namespace iolib
+
+#endif //_HOST_FAKESTREAMDRIVER_H_
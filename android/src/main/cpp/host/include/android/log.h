@@ -0,0 +1,53 @@
+#ifndef _HOST_ANDROID_LOG_H_
+#define _HOST_ANDROID_LOG_H_
+
+/*
+ * Minimal stand-in for the NDK's <android/log.h> so the platform-independent parts of the
+ * player build on a desktop host. Messages go to stderr.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+static inline int __android_log_write(int prio, const char* tag, const char* text) {
+    (void) prio;
+    return fprintf(stderr, "%s: %s\n", tag != nullptr ? tag : "", text);
+}
+
+static inline int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    (void) prio;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag != nullptr ? tag : "");
+    int result = vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return result;
+}
+
+__attribute__((noreturn))
+static inline void __android_log_assert(const char* cond, const char* tag, const char* fmt, ...) {
+    (void) cond;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag != nullptr ? tag : "");
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    abort();
+}
+
+#endif // _HOST_ANDROID_LOG_H_
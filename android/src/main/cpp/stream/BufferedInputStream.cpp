@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "BufferedInputStream.h"
+
+namespace parselib {
+
+    BufferedInputStream::BufferedInputStream(std::unique_ptr<InputStream> source,
+                                             int32_t bufferSize)
+            : mSource(std::move(source)),
+              mBuffer(nullptr),
+              mBufferSize(0),
+              mBufferStart(0),
+              mBufferFill(0),
+              mBufferOffset(0),
+              mSourcePos(-1),
+              mNumRequests(0),
+              mNumHits(0),
+              mNumSourceReads(0) {
+        bufferSize = std::max(bufferSize, kBufferAlignment);
+        bufferSize = (bufferSize + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment;
+
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, kBufferAlignment, bufferSize) == 0) {
+            mBuffer = static_cast<unsigned char*>(buffer);
+            mBufferSize = bufferSize;
+        }
+
+        mBufferStart = mSource->getPos();
+        mSourcePos = mBufferStart;
+    }
+
+    BufferedInputStream::~BufferedInputStream() {
+        free(mBuffer);
+    }
+
+    void BufferedInputStream::discard(int64_t pos) {
+        mBufferStart = pos;
+        mBufferFill = 0;
+        mBufferOffset = 0;
+    }
+
+    void BufferedInputStream::syncSource() {
+        int64_t pos = mBufferStart + mBufferFill;
+        if (mSourcePos != pos) {
+            mSource->setPos(pos);
+            mSourcePos = pos;
+        }
+    }
+
+    int32_t BufferedInputStream::readSource(void *buff, int32_t numBytes) {
+        mNumSourceReads++;
+        int32_t numRead = std::max(0, mSource->read(buff, numBytes));
+        mSourcePos += numRead;
+        return numRead;
+    }
+
+    int32_t BufferedInputStream::fill() {
+        int32_t numBuffered = getBufferedBytes();
+        if (numBuffered > 0 && mBufferOffset > 0) {
+            memmove(mBuffer, mBuffer + mBufferOffset, numBuffered);
+        }
+        mBufferStart += mBufferOffset;
+        mBufferFill = numBuffered;
+        mBufferOffset = 0;
+
+        syncSource();
+        mBufferFill += readSource(mBuffer + mBufferFill, mBufferSize - mBufferFill);
+        return mBufferFill;
+    }
+
+    int32_t BufferedInputStream::read(void *buff, int32_t numBytes) {
+        if (numBytes <= 0) {
+            return 0;
+        }
+        mNumRequests++;
+
+        unsigned char* dest = static_cast<unsigned char*>(buff);
+        int32_t numCopied = std::min(numBytes, getBufferedBytes());
+        memcpy(dest, mBuffer + mBufferOffset, numCopied);
+        mBufferOffset += numCopied;
+
+        if (numCopied == numBytes) {
+            mNumHits++;
+            return numBytes;
+        }
+
+        int32_t numLeft = numBytes - numCopied;
+        if (numLeft >= mBufferSize) {
+            // Big enough to go straight to the caller's buffer
+            discard(mBufferStart + mBufferFill);
+            syncSource();
+            int32_t numRead = readSource(dest + numCopied, numLeft);
+            discard(mBufferStart + numRead);
+            return numCopied + numRead;
+        }
+
+        int32_t numRead = std::min(numLeft, fill());
+        memcpy(dest + numCopied, mBuffer, numRead);
+        mBufferOffset = numRead;
+        return numCopied + numRead;
+    }
+
+    int32_t BufferedInputStream::peek(void *buff, int32_t numBytes) {
+        if (numBytes <= 0) {
+            return 0;
+        }
+        mNumRequests++;
+
+        if (numBytes <= getBufferedBytes()) {
+            mNumHits++;
+        } else if (numBytes <= mBufferSize) {
+            fill();
+        } else {
+            // Larger than the buffer, let the source do it
+            discard(getPos());
+            syncSource();
+            mNumSourceReads++;
+            return mSource->peek(buff, numBytes);
+        }
+
+        int32_t numPeeked = std::min(numBytes, getBufferedBytes());
+        memcpy(buff, mBuffer + mBufferOffset, numPeeked);
+        return numPeeked;
+    }
+
+    void BufferedInputStream::advance(int64_t numBytes) {
+        if (numBytes <= 0) {
+            return;
+        }
+        mNumRequests++;
+
+        if (numBytes <= getBufferedBytes()) {
+            mNumHits++;
+            mBufferOffset += static_cast<int32_t>(numBytes);
+        } else {
+            discard(getPos() + numBytes);
+        }
+    }
+
+    int64_t BufferedInputStream::getPos() {
+        return mBufferStart + mBufferOffset;
+    }
+
+    void BufferedInputStream::setPos(int64_t pos) {
+        if (pos < 0) {
+            return;
+        }
+        mNumRequests++;
+
+        if (pos >= mBufferStart && pos <= mBufferStart + mBufferFill) {
+            mNumHits++;
+            mBufferOffset = static_cast<int32_t>(pos - mBufferStart);
+        } else {
+            discard(pos);
+        }
+    }
+
+} // namespace parselib
@@ -0,0 +1,91 @@
+#ifndef _IO_STREAM_BUFFEREDINPUTSTREAM_H_
+#define _IO_STREAM_BUFFEREDINPUTSTREAM_H_
+
+#include <memory>
+
+#include "InputStream.h"
+
+namespace parselib {
+
+/**
+ * An InputStream decorator that reads its source in large, aligned blocks and serves
+ * read()/peek()/advance()/setPos() from memory whenever the data is already buffered.
+ *
+ * This turns the many small requests made while parsing headers and converting samples into
+ * a few large sequential reads of the source. Requests of at least a buffer's worth of data
+ * bypass the buffer and go straight to the source.
+ */
+    class BufferedInputStream : public InputStream {
+    public:
+        static constexpr int32_t kDefaultBufferSize = 128 * 1024;
+        static constexpr int32_t kBufferAlignment = 4096;
+
+        /**
+         * Takes ownership of source. bufferSize is rounded up to a multiple of kBufferAlignment.
+         */
+        BufferedInputStream(std::unique_ptr<InputStream> source,
+                            int32_t bufferSize = kDefaultBufferSize);
+        virtual ~BufferedInputStream();
+
+        virtual int32_t read(void *buff, int32_t numBytes);
+
+        virtual int32_t peek(void *buff, int32_t numBytes);
+
+        virtual void advance(int64_t numBytes);
+
+        virtual int64_t getPos();
+
+        virtual void setPos(int64_t pos);
+
+        /*
+         * Statistics. A request is a hit if it was served entirely from the buffer.
+         */
+        int64_t getNumRequests() { return mNumRequests; }
+        int64_t getNumHits() { return mNumHits; }
+        int64_t getNumSourceReads() { return mNumSourceReads; }
+        float getHitRate() {
+            return mNumRequests != 0 ? (float) mNumHits / (float) mNumRequests : 0.0f;
+        }
+
+    private:
+        /** Number of buffered bytes at and after the read position */
+        int32_t getBufferedBytes() { return mBufferFill - mBufferOffset; }
+
+        /** Drop the buffer contents, the next request will refill it starting at pos */
+        void discard(int64_t pos);
+
+        /**
+         * Move the unread bytes to the front of the buffer and top it up from the source.
+         * Returns the number of buffered bytes afterwards.
+         */
+        int32_t fill();
+
+        /** Read from the source at its current position, counting the call */
+        int32_t readSource(void *buff, int32_t numBytes);
+
+        /** Position the source at the end of the buffered data, if it isn't already */
+        void syncSource();
+
+        std::unique_ptr<InputStream> mSource;
+
+        unsigned char* mBuffer;
+        int32_t mBufferSize;
+
+        /** Stream position of mBuffer[0] */
+        int64_t mBufferStart;
+        /** Number of valid bytes in mBuffer */
+        int32_t mBufferFill;
+        /** Read position, relative to mBufferStart */
+        int32_t mBufferOffset;
+
+        /** Position of the source, or -1 if unknown */
+        int64_t mSourcePos;
+
+        int64_t mNumRequests;
+        int64_t mNumHits;
+        int64_t mNumSourceReads;
+    };
+
+} // namespace parselib
+
+#endif // _IO_STREAM_BUFFEREDINPUTSTREAM_H_
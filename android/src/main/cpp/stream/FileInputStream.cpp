@@ -25,23 +25,26 @@ namespace parselib {
 
     int32_t FileInputStream::peek(void *buff, int32_t numBytes) {
         int32_t numRead = ::read(mFH, buff, numBytes);
-        ::lseek(mFH, -numBytes, SEEK_CUR);
+        if (numRead > 0) {
+            ::lseek(mFH, -numRead, SEEK_CUR);
+        }
         return numRead;
     }
 
-    void FileInputStream::advance(int32_t numBytes) {
+    // off_t is 64 bits, see _FILE_OFFSET_BITS in CMakeLists.txt
+    void FileInputStream::advance(int64_t numBytes) {
         if (numBytes > 0) {
-            ::lseek(mFH, numBytes, SEEK_CUR);
+            ::lseek(mFH, static_cast<off_t>(numBytes), SEEK_CUR);
         }
     }
 
-    int32_t FileInputStream::getPos() {
-        return ::lseek(mFH, 0L, SEEK_CUR);
+    int64_t FileInputStream::getPos() {
+        return ::lseek(mFH, 0, SEEK_CUR);
     }
 
-    void FileInputStream::setPos(int32_t pos) {
-        if (pos > 0) {
-            ::lseek(mFH, pos, SEEK_SET);
+    void FileInputStream::setPos(int64_t pos) {
+        if (pos >= 0) {
+            ::lseek(mFH, static_cast<off_t>(pos), SEEK_SET);
         }
     }
 
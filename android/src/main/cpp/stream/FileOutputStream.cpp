@@ -0,0 +1,35 @@
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "FileOutputStream.h"
+
+namespace parselib {
+
+    int32_t FileOutputStream::write(const void *buff, int32_t numBytes) {
+        const char* bytes = static_cast<const char*>(buff);
+        int32_t numWritten = 0;
+        while (numWritten < numBytes) {
+            ssize_t result = ::write(mFH, bytes + numWritten, numBytes - numWritten);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                break;
+            }
+            numWritten += static_cast<int32_t>(result);
+        }
+        return numWritten;
+    }
+
+    int64_t FileOutputStream::getPos() {
+        return ::lseek(mFH, 0, SEEK_CUR);
+    }
+
+    void FileOutputStream::setPos(int64_t pos) {
+        if (pos >= 0) {
+            ::lseek(mFH, static_cast<off_t>(pos), SEEK_SET);
+        }
+    }
+
+} // namespace parselib
@@ -0,0 +1,30 @@
+#ifndef _IO_STREAM_FILEOUTPUTSTREAM_H_
+#define _IO_STREAM_FILEOUTPUTSTREAM_H_
+
+#include "OutputStream.h"
+
+namespace parselib {
+
+/**
+ * A concrete implementation of OutputStream for a file data sink
+ */
+    class FileOutputStream : public OutputStream {
+    public:
+        /** constructor. Caller is presumed to have opened the file with (at least) write permission */
+        FileOutputStream(int fh) : mFH(fh) {}
+        virtual ~FileOutputStream() {}
+
+        virtual int32_t write(const void *buff, int32_t numBytes);
+
+        virtual int64_t getPos();
+
+        virtual void setPos(int64_t pos);
+
+    private:
+        /** File handle of the data file to write to */
+        int mFH;
+    };
+
+} // namespace parselib
+
+#endif // _IO_STREAM_FILEOUTPUTSTREAM_H_
@@ -17,6 +17,11 @@
 
 namespace parselib {
 
-// All of the methods of InputStream are pure virtual
+// All of the other methods of InputStream are pure virtual
+
+    const void* InputStream::peekDirect(int32_t* numAvailable) {
+        *numAvailable = 0;
+        return nullptr;
+    }
 
 } /* namespace wavlib */
\ No newline at end of file
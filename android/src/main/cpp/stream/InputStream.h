@@ -45,17 +45,25 @@ namespace parselib {
         /**
          * Moves the read position forward the (positive) number of bytes specified.
          */
-        virtual void advance(int32_t numBytes) = 0;
+        virtual void advance(int64_t numBytes) = 0;
 
         /**
          * Returns the read position of the stream
          */
-        virtual int32_t getPos() = 0;
+        virtual int64_t getPos() = 0;
 
         /**
          * Sets the read position of the stream to the 0 or positive position.
          */
-        virtual void setPos(int32_t pos) = 0;
+        virtual void setPos(int64_t pos) = 0;
+
+        /**
+         * Zero-copy access. If the stream can expose its data in place, returns a pointer to
+         * the data at the read position and sets numAvailable to the number of contiguous
+         * bytes that may be read through it. DOES NOT advance the read position, use advance().
+         * Returns nullptr if the stream has no such access (the default).
+         */
+        virtual const void* peekDirect(int32_t* numAvailable);
     };
 
 } // namespace parselib
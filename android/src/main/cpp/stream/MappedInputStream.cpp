@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedInputStream.h"
+
+namespace parselib {
+
+    // How far ahead of the read position we ask the kernel to fault pages in
+    static constexpr size_t kReadAheadBytes = 1024 * 1024;
+
+    MappedInputStream::MappedInputStream(int fh)
+            : mData(nullptr), mSize(0), mPos(0), mAdvisedEnd(0) {
+        struct stat fileStat;
+        if (fh < 0 || fstat(fh, &fileStat) != 0 || fileStat.st_size <= 0
+            || static_cast<uint64_t>(fileStat.st_size) > SIZE_MAX) {
+            return; // a file larger than the address space can only be read
+        }
+
+        void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fh, 0);
+        if (data == MAP_FAILED) {
+            return; // e.g. out of address space on 32-bit ABIs
+        }
+
+        mData = static_cast<const unsigned char*>(data);
+        mSize = fileStat.st_size;
+
+        madvise(const_cast<unsigned char*>(mData), mSize, MADV_SEQUENTIAL);
+        adviseReadAhead(true);
+    }
+
+    MappedInputStream::~MappedInputStream() {
+        if (mData != nullptr) {
+            munmap(const_cast<unsigned char*>(mData), mSize);
+        }
+    }
+
+    void MappedInputStream::adviseReadAhead(bool force) {
+        if (!force && mPos + kReadAheadBytes / 2 < mAdvisedEnd) {
+            return; // still comfortably inside the last window
+        }
+
+        static const size_t kPageSize = sysconf(_SC_PAGESIZE);
+        size_t start = (force ? mPos : std::max(mPos, mAdvisedEnd)) & ~(kPageSize - 1);
+        size_t end = std::min(mSize, mPos + kReadAheadBytes);
+        if (start < end) {
+            madvise(const_cast<unsigned char*>(mData) + start, end - start, MADV_WILLNEED);
+        }
+        mAdvisedEnd = end;
+    }
+
+    int32_t MappedInputStream::read(void *buff, int32_t numBytes) {
+        int32_t numRead = peek(buff, numBytes);
+        advance(numRead);
+        return numRead;
+    }
+
+    int32_t MappedInputStream::peek(void *buff, int32_t numBytes) {
+        if (mData == nullptr || numBytes <= 0) {
+            return 0;
+        }
+        int32_t numRead = static_cast<int32_t>(std::min<size_t>(numBytes, mSize - mPos));
+        memcpy(buff, mData + mPos, numRead);
+        return numRead;
+    }
+
+    void MappedInputStream::advance(int64_t numBytes) {
+        if (numBytes > 0) {
+            mPos += static_cast<size_t>(std::min<uint64_t>(numBytes, mSize - mPos));
+            if (mData != nullptr) {
+                adviseReadAhead(false);
+            }
+        }
+    }
+
+    int64_t MappedInputStream::getPos() {
+        return static_cast<int64_t>(mPos);
+    }
+
+    void MappedInputStream::setPos(int64_t pos) {
+        if (pos >= 0) {
+            mPos = static_cast<size_t>(std::min<uint64_t>(pos, mSize));
+            if (mData != nullptr) {
+                adviseReadAhead(true);
+            }
+        }
+    }
+
+    const void* MappedInputStream::peekDirect(int32_t* numAvailable) {
+        if (mData == nullptr) {
+            *numAvailable = 0;
+            return nullptr;
+        }
+        *numAvailable = static_cast<int32_t>(std::min<size_t>(mSize - mPos, INT32_MAX));
+        return mData + mPos;
+    }
+
+} /* namespace parselib */
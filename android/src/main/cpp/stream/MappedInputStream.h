@@ -0,0 +1,53 @@
+#ifndef _IO_STREAM_MAPPEDINPUTSTREAM_H_
+#define _IO_STREAM_MAPPEDINPUTSTREAM_H_
+
+#include <cstddef>
+
+#include "InputStream.h"
+
+namespace parselib {
+
+/**
+ * A concrete implementation of InputStream that memory-maps a file.
+ * read()/peek() copy out of the mapping; peekDirect() exposes it in place so the data
+ * can be decoded straight from the page cache.
+ *
+ * The kernel is told the access pattern is sequential, and the pages just ahead of the read
+ * position are prefetched (MADV_WILLNEED) as the position moves, including after setPos().
+ */
+    class MappedInputStream : public InputStream {
+    public:
+        /** constructor. Caller is presumed to have opened the file with (at least) read permission */
+        MappedInputStream(int fh);
+        virtual ~MappedInputStream();
+
+        /** false if the file could not be mapped (in which case fall back to FileInputStream) */
+        bool isValid() { return mData != nullptr; }
+
+        virtual int32_t read(void *buff, int32_t numBytes);
+
+        virtual int32_t peek(void *buff, int32_t numBytes);
+
+        virtual void advance(int64_t numBytes);
+
+        virtual int64_t getPos();
+
+        virtual void setPos(int64_t pos);
+
+        virtual const void* peekDirect(int32_t* numAvailable);
+
+    private:
+        /** Issue MADV_WILLNEED for the read-ahead window if the position has moved past it */
+        void adviseReadAhead(bool force);
+
+        const unsigned char* mData;
+        size_t mSize;
+        size_t mPos;
+
+        /** End of the region most recently passed to MADV_WILLNEED */
+        size_t mAdvisedEnd;
+    };
+
+} // namespace parselib
+
+#endif // _IO_STREAM_MAPPEDINPUTSTREAM_H_
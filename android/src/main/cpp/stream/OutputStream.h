@@ -0,0 +1,35 @@
+#ifndef _IO_STREAM_OUTPUTSTREAM_H_
+#define _IO_STREAM_OUTPUTSTREAM_H_
+
+#include <cstdint>
+
+namespace parselib {
+
+/**
+ * An interface declaration for a writable stream of bytes, the counterpart of InputStream.
+ */
+    class OutputStream {
+    public:
+        OutputStream() {}
+        virtual ~OutputStream() {}
+
+        /**
+         * Writes the specified number of bytes and advances the write position.
+         * Returns: The number of bytes actually written, less than requested on error.
+         */
+        virtual int32_t write(const void *buff, int32_t numBytes) = 0;
+
+        /**
+         * Returns the write position of the stream
+         */
+        virtual int64_t getPos() = 0;
+
+        /**
+         * Sets the write position of the stream to the 0 or positive position.
+         */
+        virtual void setPos(int64_t pos) = 0;
+    };
+
+} // namespace parselib
+
+#endif // _IO_STREAM_OUTPUTSTREAM_H_
@@ -0,0 +1,266 @@
+/*
+ * Checks FlacStreamReader against reference decodes: each FLAC file is decoded whole and from
+ * --seeks random seek positions, and compared sample for sample with a WAV of the same audio
+ * written by another decoder (libsndfile's sndfile-convert, or flac -d), both read as the
+ * player reads them, to floats. Each file is read mapped and through a BufferedInputStream,
+ * as SampleSource may open it.
+ *
+ * Also prints what the seeks cost: the bytes read from the file and the time, for a first
+ * seek to 3/4 of a freshly opened file (nothing decoded yet, so no learned seek points) and
+ * for the random ones. Exits with 1 if a decode differs from its reference.
+ *
+ * usage: flac_check [--seeks <n>] <in.flac> <reference.wav> [<in.flac> <reference.wav>]...
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "stream/BufferedInputStream.h"
+#include "stream/FileInputStream.h"
+#include "stream/MappedInputStream.h"
+#include "wav/AudioStreamReader.h"
+
+using namespace parselib;
+
+static constexpr int32_t kSeekReadFrames = 3000;
+
+/*
+ * Counts the bytes read through it, in place or not.
+ */
+class CountingInputStream : public InputStream {
+public:
+    explicit CountingInputStream(std::unique_ptr<InputStream> source)
+            : mSource(std::move(source)), mNumBytesRead(0) {}
+
+    int32_t read(void *buff, int32_t numBytes) override {
+        int32_t numRead = mSource->read(buff, numBytes);
+        mNumBytesRead += std::max(0, numRead);
+        return numRead;
+    }
+
+    int32_t peek(void *buff, int32_t numBytes) override { return mSource->peek(buff, numBytes); }
+
+    // After peekDirect(), advancing is reading
+    void advance(int64_t numBytes) override {
+        mSource->advance(numBytes);
+        mNumBytesRead += numBytes;
+    }
+
+    int64_t getPos() override { return mSource->getPos(); }
+    void setPos(int64_t pos) override { mSource->setPos(pos); }
+
+    const void* peekDirect(int32_t* numAvailable) override {
+        return mSource->peekDirect(numAvailable);
+    }
+
+    int64_t getNumBytesRead() const { return mNumBytesRead; }
+    void resetNumBytesRead() { mNumBytesRead = 0; }
+
+private:
+    std::unique_ptr<InputStream> mSource;
+    int64_t mNumBytesRead;
+};
+
+class OpenedFile {
+public:
+    OpenedFile(const char* path, bool mapped) : mFileDescriptor(open(path, O_RDONLY)) {
+        if (mFileDescriptor < 0) {
+            return;
+        }
+        std::unique_ptr<InputStream> source;
+        if (mapped) {
+            source = std::make_unique<MappedInputStream>(mFileDescriptor);
+        } else {
+            source = std::make_unique<BufferedInputStream>(
+                    std::make_unique<FileInputStream>(mFileDescriptor));
+        }
+        mStream = std::make_unique<CountingInputStream>(std::move(source));
+        mReader = AudioStreamReader::create(mStream.get());
+        if (mReader != nullptr) {
+            mReader->parse();
+        }
+    }
+
+    ~OpenedFile() {
+        mReader.reset();
+        mStream.reset();
+        if (mFileDescriptor >= 0) {
+            close(mFileDescriptor);
+        }
+    }
+
+    bool isValid() const { return mReader != nullptr && mReader->isValid(); }
+    AudioStreamReader* getReader() const { return mReader.get(); }
+    CountingInputStream* getStream() const { return mStream.get(); }
+
+private:
+    int mFileDescriptor;
+    std::unique_ptr<CountingInputStream> mStream;
+    std::unique_ptr<AudioStreamReader> mReader;
+};
+
+struct SeekCost {
+    double bytes = 0.0;
+    double maxBytes = 0.0;
+    double micros = 0.0;
+    double maxMicros = 0.0;
+    int32_t numSeeks = 0;
+
+    void add(int64_t seekBytes, double seekMicros) {
+        bytes += seekBytes;
+        maxBytes = std::max<double>(maxBytes, seekBytes);
+        micros += seekMicros;
+        maxMicros = std::max(maxMicros, seekMicros);
+        numSeeks++;
+    }
+};
+
+/*
+ * Seeks to frameIndex and reads kSeekReadFrames, counting the cost of the seek and the first
+ * read (which decodes the frame the seek landed in, if it didn't). Returns the number of
+ * samples that differ from the reference, the frames past its end must be zeros.
+ */
+static int64_t checkSeek(OpenedFile& file, const std::vector<float>& reference,
+                         int64_t frameIndex, SeekCost* cost) {
+    AudioStreamReader* reader = file.getReader();
+    int32_t numChannels = reader->getNumChannels();
+    int64_t numFrames = reader->getNumSampleFrames();
+    std::vector<float> buffer(static_cast<size_t>(kSeekReadFrames) * numChannels, 1.0f);
+
+    file.getStream()->resetNumBytesRead();
+    auto start = std::chrono::steady_clock::now();
+    reader->setDataPosition(frameIndex);
+    int32_t numRead = reader->getDataFloat(buffer.data(), kSeekReadFrames);
+    double micros = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+    cost->add(file.getStream()->getNumBytesRead(), micros);
+
+    int64_t numExpected = std::min<int64_t>(kSeekReadFrames, numFrames - frameIndex);
+    int64_t numDifferent = numRead == numExpected ? 0 : 1;
+    for (int64_t index = 0; index < static_cast<int64_t>(buffer.size()); index++) {
+        float expected = index < numExpected * numChannels
+                         ? reference[frameIndex * numChannels + index] : 0.0f;
+        if (memcmp(&buffer[index], &expected, sizeof(float)) != 0) {
+            numDifferent++;
+        }
+    }
+    return numDifferent;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: flac_check [--seeks <n>] <in.flac> <reference.wav>"
+                    " [<in.flac> <reference.wav>]...\n");
+}
+
+int main(int argc, char** argv) {
+    int32_t numSeeks = 200;
+    std::vector<const char*> paths;
+    for (int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+        if (strcmp(arg, "--seeks") == 0 && index + 1 < argc) {
+            numSeeks = atoi(argv[++index]);
+        } else if (arg[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() || paths.size() % 2 != 0 || numSeeks < 0) {
+        usage();
+        return 1;
+    }
+
+    printf("%-14s %-8s %9s %3s %9s %6s %8s %8s %8s %8s %8s %8s\n", "file", "stream", "frames",
+           "ch", "different", "seeks", "cold KB", "cold us", "mean KB", "max KB", "mean us",
+           "max us");
+    int result = 0;
+    for (size_t index = 0; index < paths.size(); index += 2) {
+        const char* flacPath = paths[index];
+        const char* name = strrchr(flacPath, '/') != nullptr ? strrchr(flacPath, '/') + 1
+                                                             : flacPath;
+        OpenedFile referenceFile(paths[index + 1], false);
+        if (!referenceFile.isValid()) {
+            fprintf(stderr, "flac_check: can't read %s\n", paths[index + 1]);
+            result = 1;
+            continue;
+        }
+        AudioStreamReader* referenceReader = referenceFile.getReader();
+        int32_t numChannels = referenceReader->getNumChannels();
+        int64_t numFrames = referenceReader->getNumSampleFrames();
+        std::vector<float> reference(static_cast<size_t>(numFrames) * numChannels);
+        referenceReader->getDataFloat(reference.data(), static_cast<int>(numFrames));
+
+        for (bool mapped : { true, false }) {
+            OpenedFile file(flacPath, mapped);
+            if (!file.isValid()) {
+                fprintf(stderr, "flac_check: can't read %s\n", flacPath);
+                result = 1;
+                break;
+            }
+            AudioStreamReader* reader = file.getReader();
+            if (reader->getNumChannels() != numChannels
+                || reader->getNumSampleFrames() != numFrames
+                || reader->getSampleRate() != referenceReader->getSampleRate()) {
+                fprintf(stderr, "flac_check: %s and its reference differ in format\n", flacPath);
+                result = 1;
+                break;
+            }
+
+            // Cold: before anything is decoded
+            SeekCost coldCost;
+            int64_t numDifferent = checkSeek(file, reference, numFrames * 3 / 4, &coldCost);
+
+            // The whole file, in reads of varying sizes, as the DiskStreamer's
+            reader->positionToAudio();
+            std::vector<float> decoded(reference.size() + numChannels);
+            int64_t numDecoded = 0;
+            while (numDecoded < numFrames) {
+                int32_t numToRead = static_cast<int32_t>(std::min<int64_t>(
+                        1000 + numDecoded % 777, numFrames - numDecoded));
+                int32_t numRead = reader->getDataFloat(decoded.data() + numDecoded * numChannels,
+                                                       numToRead);
+                if (numRead <= 0) {
+                    break;
+                }
+                numDecoded += numRead;
+            }
+            numDifferent += numDecoded == numFrames ? 0 : 1;
+            numDifferent += memcmp(decoded.data(), reference.data(),
+                                   reference.size() * sizeof(float)) == 0 ? 0 : 1;
+
+            // Random seeks, some near the end, then past it
+            SeekCost seekCost;
+            uint32_t seed = 0x2545F491;
+            for (int32_t seek = 0; seek < numSeeks; seek++) {
+                seed = seed * 1664525 + 1013904223;
+                int64_t frameIndex = (seed >> 8) % numFrames;
+                if (seek % 10 == 9) {
+                    frameIndex = std::max<int64_t>(0, numFrames - (seed >> 8) % 50);
+                }
+                numDifferent += checkSeek(file, reference, frameIndex, &seekCost);
+            }
+            numDifferent += checkSeek(file, reference, numFrames, &seekCost);
+
+            printf("%-14s %-8s %9lld %3d %9lld %6d %8.0f %8.0f %8.1f %8.0f %8.0f %8.0f\n",
+                   name, mapped ? "mapped" : "buffered", static_cast<long long>(numFrames),
+                   numChannels, static_cast<long long>(numDifferent), seekCost.numSeeks,
+                   coldCost.bytes / 1024.0, coldCost.micros,
+                   seekCost.bytes / 1024.0 / seekCost.numSeeks, seekCost.maxBytes / 1024.0,
+                   seekCost.micros / seekCost.numSeeks, seekCost.maxMicros);
+            if (numDifferent != 0) {
+                result = 1;
+            }
+        }
+    }
+    printf("%s\n", result == 0 ? "pass: every decode matches its reference"
+                               : "FAIL: decodes differ from their references");
+    return result;
+}
@@ -0,0 +1,181 @@
+/*
+ * Runs the LatencyTuner against a simulated output stream (FakeStreamDriver) with injected
+ * underruns, as SimpleMultiPlayer runs it against the Oboe stream, and checks that it:
+ *  - stays at one burst while the stream is clean,
+ *  - grows by a burst per underrun, and no further than it takes to stop them,
+ *  - stops at the latency ceiling however many underruns follow,
+ *  - shrinks back to one burst, a burst per quiet period, once they stop.
+ *
+ * Prints the buffer size every time it changes. Exits with 1 if a check fails.
+ *
+ * usage: latency_simulation [--burst <frames>] [--rate <Hz>] [--ceiling <ms>]
+ *                           [--quiet <s>] [--paced]
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "LatencyTuner.h"
+#include "host/FakeStreamDriver.h"
+
+using namespace iolib;
+
+namespace {
+
+    struct Options {
+        int32_t burstFrames = 192;
+        int32_t sampleRate = 48000;
+        float maxLatencyMillis = LatencyTuner::kDefaultMaxLatencyMillis;
+        float quietSeconds = LatencyTuner::kDefaultQuietSeconds;
+        bool paced = false;
+    };
+
+    class Simulation {
+    public:
+        Simulation(const Options& options, FakeStreamDriver::Config config)
+                : mDriver(config), mMaxBufferFrames(0), mNumFailures(0) {
+            mTuner.setMaxLatencyMillis(options.maxLatencyMillis);
+            mTuner.setQuietSeconds(options.quietSeconds);
+            // As SimpleMultiPlayer::openStream()
+            int32_t bufferFrames = mTuner.reset(mDriver.getFramesPerBurst(),
+                                                mDriver.getBufferCapacityInFrames(),
+                                                mDriver.getSampleRate());
+            mTuner.setActualBufferSize(mDriver.setBufferSizeInFrames(bufferFrames));
+            printf("%10s %8s %8s %8s  %s\n", "time s", "frames", "ms", "xruns", "phase");
+            print("open");
+        }
+
+        int32_t getBursts() const {
+            return mTuner.getBufferSizeInFrames() / mDriver.getFramesPerBurst();
+        }
+        int32_t getMaxBufferFrames() const { return mMaxBufferFrames; }
+        int32_t getXRunCount() const { return mDriver.getXRunCount(); }
+        int32_t getNumFailures() const { return mNumFailures; }
+
+        /**
+         * Runs numCallbacks callbacks, the first of each period stalled by stallBursts
+         * (none if 0).
+         */
+        void run(const char* phase, int64_t numCallbacks, int64_t period = 0,
+                 double stallBursts = 0.0) {
+            mPhase = phase;
+            if (stallBursts > 0.0) {
+                int64_t first = mDriver.getCallbackCount();
+                for (int64_t callback = 0; callback < numCallbacks; callback += period) {
+                    mDriver.injectStall(first + callback, stallBursts * mDriver.getBurstSeconds());
+                }
+            }
+            mDriver.run(numCallbacks, [this](float* /*audioData*/, int32_t numFrames) {
+                return onAudioReady(numFrames);
+            });
+        }
+
+        void check(bool passed, const char* description) {
+            printf("%s: %s\n", passed ? "pass" : "FAIL", description);
+            if (!passed) {
+                mNumFailures++;
+            }
+        }
+
+    private:
+        FakeStreamDriver mDriver;
+        LatencyTuner mTuner;
+        const char* mPhase = "";
+        int32_t mMaxBufferFrames;
+        int32_t mNumFailures;
+
+        // As SimpleMultiPlayer::finishCallback()
+        bool onAudioReady(int32_t numFrames) {
+            int32_t bufferFrames = mTuner.update(mDriver.getXRunCount(), numFrames);
+            if (bufferFrames != mTuner.getBufferSizeInFrames()) {
+                mTuner.setActualBufferSize(mDriver.setBufferSizeInFrames(bufferFrames));
+                print(mPhase);
+            }
+            mMaxBufferFrames = std::max(mMaxBufferFrames, mTuner.getBufferSizeInFrames());
+            return true;
+        }
+
+        void print(const char* phase) {
+            printf("%10.3f %8d %8.2f %8d  %s\n", mDriver.getStreamSeconds(),
+                   mTuner.getBufferSizeInFrames(), mTuner.getLatencyMillis(),
+                   mDriver.getXRunCount(), phase);
+        }
+    };
+
+} // namespace
+
+static void usage() {
+    fprintf(stderr, "usage: latency_simulation [--burst <frames>] [--rate <Hz>] [--ceiling <ms>]\n"
+                    "                          [--quiet <s>] [--paced]\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+        bool hasValue = index + 1 < argc;
+        if (strcmp(arg, "--burst") == 0 && hasValue) {
+            options.burstFrames = atoi(argv[++index]);
+        } else if (strcmp(arg, "--rate") == 0 && hasValue) {
+            options.sampleRate = atoi(argv[++index]);
+        } else if (strcmp(arg, "--ceiling") == 0 && hasValue) {
+            options.maxLatencyMillis = static_cast<float>(atof(argv[++index]));
+        } else if (strcmp(arg, "--quiet") == 0 && hasValue) {
+            options.quietSeconds = static_cast<float>(atof(argv[++index]));
+        } else if (strcmp(arg, "--paced") == 0) {
+            options.paced = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (options.burstFrames <= 0 || options.sampleRate <= 0 || options.maxLatencyMillis <= 0.0f
+        || options.quietSeconds <= 0.0f) {
+        usage();
+        return 2;
+    }
+
+    // The ceiling in whole bursts, as the tuner rounds it. The buffer has room beyond it.
+    int32_t ceilingBursts = std::max(1, static_cast<int32_t>(ceilf(
+            options.maxLatencyMillis * options.sampleRate / (1000.0f * options.burstFrames))));
+    FakeStreamDriver::Config config;
+    config.sampleRate = options.sampleRate;
+    config.framesPerBurst = options.burstFrames;
+    config.bufferCapacityInBursts = ceilingBursts + 4;
+    config.paced = options.paced;
+
+    double burstSeconds = options.burstFrames / static_cast<double>(options.sampleRate);
+    int64_t quietCallbacks = static_cast<int64_t>(ceil(options.quietSeconds / burstSeconds));
+    printf("stream: %d Hz, %d-frame bursts, ceiling %d bursts (%.1f ms), quiet period %.1f s\n",
+           options.sampleRate, options.burstFrames, ceilingBursts,
+           1000.0 * ceilingBursts * burstSeconds, options.quietSeconds);
+    Simulation simulation(options, config);
+
+    // Longer than a quiet period, without a stall
+    simulation.run("clean", quietCallbacks * 3 / 2);
+    simulation.check(simulation.getBursts() == 1 && simulation.getXRunCount() == 0,
+                     "a clean stream stays at one burst");
+
+    // Stalls of a burst and a half underrun a one-burst buffer, not a two-burst one
+    simulation.run("short stalls", 1000, 100, 1.5);
+    simulation.check(simulation.getBursts() == 2, "short stalls grow the buffer to two bursts");
+
+    // Stalls no buffer under the ceiling covers
+    int32_t xRunsBefore = simulation.getXRunCount();
+    simulation.run("long stalls", 50 * (ceilingBursts + 4), 50, ceilingBursts + 2.0);
+    simulation.check(simulation.getXRunCount() > xRunsBefore
+                     && simulation.getBursts() == ceilingBursts,
+                     "long stalls grow the buffer to the ceiling");
+    simulation.check(simulation.getMaxBufferFrames() <= ceilingBursts * options.burstFrames,
+                     "the buffer never exceeds the ceiling");
+
+    // One burst back per quiet period
+    xRunsBefore = simulation.getXRunCount();
+    simulation.run("quiet", quietCallbacks * ceilingBursts + quietCallbacks / 2);
+    simulation.check(simulation.getXRunCount() == xRunsBefore && simulation.getBursts() == 1,
+                     "the buffer shrinks back to one burst once the stalls stop");
+
+    return simulation.getNumFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+ * Renders a mix of WAV or FLAC files to a WAV file through the player's offline render path
+ * (iolib::OfflineRenderer), without an audio device.
+ *
+ * usage: mixdown <out.wav> <in.wav>... [--rate <Hz>] [--channels <1|2>]
+ *                [--format pcm16|pcm24|float] [--quality low|medium|high] [--preload]
+ *
+ * The rate defaults to that of the first input, the other inputs are resampled to it.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "OfflineRenderer.h"
+#include "SampleSource.h"
+#include "stream/FileOutputStream.h"
+#include "wav/WavStreamWriter.h"
+
+using namespace iolib;
+using namespace parselib;
+
+static void usage() {
+    fprintf(stderr, "usage: mixdown <out.wav> <in.wav>... [--rate <Hz>] [--channels <1|2>]\n"
+                    "               [--format pcm16|pcm24|float] [--quality low|medium|high]"
+                    " [--preload]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = nullptr;
+    std::vector<const char*> inputPaths;
+    int32_t sampleRate = 0;
+    int32_t channelCount = 2;
+    WavStreamWriter::Format format = WavStreamWriter::Format::PCM16;
+    ResamplerQuality quality = ResamplerQuality::Medium;
+    LoadPolicy loadPolicy = LoadPolicy::Stream;
+
+    for (int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+        bool hasValue = index + 1 < argc;
+        if (strcmp(arg, "--rate") == 0 && hasValue) {
+            sampleRate = atoi(argv[++index]);
+        } else if (strcmp(arg, "--channels") == 0 && hasValue) {
+            channelCount = atoi(argv[++index]);
+        } else if (strcmp(arg, "--format") == 0 && hasValue) {
+            const char* value = argv[++index];
+            if (strcmp(value, "pcm16") == 0) {
+                format = WavStreamWriter::Format::PCM16;
+            } else if (strcmp(value, "pcm24") == 0) {
+                format = WavStreamWriter::Format::PCM24;
+            } else if (strcmp(value, "float") == 0) {
+                format = WavStreamWriter::Format::Float32;
+            } else {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(arg, "--quality") == 0 && hasValue) {
+            const char* value = argv[++index];
+            quality = strcmp(value, "low") == 0 ? ResamplerQuality::Low
+                    : strcmp(value, "high") == 0 ? ResamplerQuality::High
+                    : ResamplerQuality::Medium;
+        } else if (strcmp(arg, "--preload") == 0) {
+            loadPolicy = LoadPolicy::Preload;
+        } else if (arg[0] == '-') {
+            usage();
+            return 1;
+        } else if (outputPath == nullptr) {
+            outputPath = arg;
+        } else {
+            inputPaths.push_back(arg);
+        }
+    }
+    if (outputPath == nullptr || inputPaths.empty() || channelCount < 1 || channelCount > 2) {
+        usage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<SampleSource>> sources;
+    for (const char* path : inputPaths) {
+        auto source = std::make_unique<SampleSource>(path, SampleSource::PAN_CENTER, loadPolicy);
+        if (source->getNumChannels() <= 0) {
+            fprintf(stderr, "mixdown: can't read %s\n", path);
+            return 1;
+        }
+        if (sampleRate <= 0) {
+            sampleRate = source->getSampleRate();
+        }
+        source->setPlayMode();
+        sources.push_back(std::move(source));
+    }
+
+    OfflineRenderer renderer(channelCount, sampleRate);
+    renderer.setResamplerQuality(quality);
+    for (auto& source : sources) {
+        renderer.addSampleSource(source.get());
+    }
+
+    int64_t reportInterval = std::max<int64_t>(1, renderer.getTotalFrames() / 10);
+    int64_t nextReport = reportInterval;
+    renderer.setProgressCallback([&](const OfflineRenderer::Progress& progress) {
+        if (progress.framesRendered >= nextReport) {
+            fprintf(stderr, "\r%3d%%  %.1fx realtime",
+                    (int) (100 * progress.framesRendered / progress.totalFrames),
+                    progress.realtimeMultiple);
+            nextReport += reportInterval;
+        }
+    });
+
+    int fileDescriptor = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0) {
+        fprintf(stderr, "mixdown: can't create %s\n", outputPath);
+        return 1;
+    }
+    FileOutputStream stream(fileDescriptor);
+    WavStreamWriter writer(&stream, channelCount, sampleRate, format);
+    bool result = renderer.render(&writer);
+    close(fileDescriptor);
+    fprintf(stderr, "\n");
+
+    const OfflineRenderer::Progress& progress = renderer.getLastProgress();
+    printf("%s: %lld frames, %d channels at %d Hz, %.2fs of audio at %.1fx realtime\n",
+           outputPath, (long long) progress.framesRendered, channelCount, sampleRate,
+           progress.framesRendered / (double) sampleRate, progress.realtimeMultiple);
+    return result ? 0 : 1;
+}
@@ -0,0 +1,376 @@
+/*
+ * Drives streamed SampleSources through the SeekCoordinator, as SimpleMultiPlayer's data
+ * callback does, from a simulated output stream (FakeStreamDriver), and seeks them around:
+ * a start from a cold cue, single seeks, a scrub (a seek every few callbacks), a seek close to
+ * the end. Checks that:
+ *  - every seek is carried out, the audio thread never waiting on the disk,
+ *  - no block has some tracks at the target and some not (partial-track output),
+ *  - after a seek, every track plays from the target.
+ *
+ * The corpus is --tracks stereo float WAVs with the same constant left channel, so the left
+ * mix is either silence, every track, or a known fade, and a right channel that ramps with
+ * the frame index, so the right mix gives the position played. Prints the seek latencies and
+ * callback times. Exits with 1 if a check fails.
+ *
+ * Runs paced, as the disk is serviced by a real DiskStreamer thread. --jump moves the
+ * transport as the player did before the coordinator (each source seeking by itself when it
+ * sees the jump), for comparison; it reports, but doesn't check.
+ *
+ * usage: seek_simulation [--burst <frames>] [--rate <Hz>] [--tracks <n>] [--dir <path>]
+ *                        [--jump]
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BusMixer.h"
+#include "DiskStreamer.h"
+#include "SampleSource.h"
+#include "SeekCoordinator.h"
+#include "host/FakeStreamDriver.h"
+#include "stream/FileOutputStream.h"
+#include "wav/WavStreamWriter.h"
+
+using namespace iolib;
+using namespace parselib;
+
+namespace {
+
+    constexpr int32_t kFileSeconds = 20;
+    constexpr int32_t kRampFrames = 4096;
+    constexpr float kTolerance = 1.0e-4f;
+
+    struct Options {
+        int32_t burstFrames = 192;
+        int32_t sampleRate = 48000;
+        int32_t numTracks = 8;
+        std::string directory = "/tmp/seek_simulation";
+        bool jump = false;
+    };
+
+    inline float rampAt(int64_t frame) {
+        return static_cast<float>(frame % kRampFrames) / kRampFrames;
+    }
+
+    bool writeCorpusFile(const std::string& path, int32_t sampleRate, float level) {
+        int fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fileDescriptor < 0) {
+            return false;
+        }
+        FileOutputStream stream(fileDescriptor);
+        WavStreamWriter writer(&stream, 2, sampleRate, WavStreamWriter::Format::Float32);
+        bool result = writer.writeHeader();
+        std::vector<float> block(2 * kRampFrames);
+        int64_t numFrames = static_cast<int64_t>(kFileSeconds) * sampleRate;
+        for (int64_t frame = 0; result && frame < numFrames; frame += kRampFrames) {
+            int32_t blockFrames = static_cast<int32_t>(std::min<int64_t>(kRampFrames,
+                                                                         numFrames - frame));
+            for (int32_t index = 0; index < blockFrames; index++) {
+                block[2 * index] = level;
+                block[2 * index + 1] = level * rampAt(frame + index);
+            }
+            result = writer.write(block.data(), blockFrames) == blockFrames;
+        }
+        result = writer.finish() && result;
+        return close(fileDescriptor) == 0 && result;
+    }
+
+    class Simulation {
+    public:
+        Simulation(const Options& options, FakeStreamDriver::Config config)
+                : mOptions(options),
+                  mDriver(config),
+                  mFullLevel(0.0f),
+                  mTransportFrame(0),
+                  mNumFrames(0),
+                  mNumSeeksReported(0),
+                  mNumFailures(0) {
+            memset(&mCounts, 0, sizeof(mCounts));
+        }
+
+        ~Simulation() {
+            mStreamer.stop();
+        }
+
+        bool open() {
+            mkdir(mOptions.directory.c_str(), 0755);
+            float level = 1.0f / mOptions.numTracks;
+            for (int32_t track = 0; track < mOptions.numTracks; track++) {
+                std::string path = mOptions.directory + "/track" + std::to_string(track) + ".wav";
+                if (!writeCorpusFile(path, mOptions.sampleRate, level)) {
+                    fprintf(stderr, "seek_simulation: can't write %s\n", path.c_str());
+                    return false;
+                }
+                auto source = std::make_unique<SampleSource>(path.c_str(),
+                                                             SampleSource::PAN_CENTER,
+                                                             LoadPolicy::Stream);
+                if (!source->isStreaming()) {
+                    fprintf(stderr, "seek_simulation: can't stream %s\n", path.c_str());
+                    return false;
+                }
+                source->setOutputSampleRate(mOptions.sampleRate, ResamplerQuality::Medium);
+                source->prepareToPlay(mOptions.burstFrames, 2);
+                source->setPlayMode();
+                mStreamer.addSource(source.get());
+                mNumFrames = source->getNumFrames();
+                mTracks.push_back(source.get());
+                mSources.push_back(std::move(source));
+            }
+            mStreamer.start();
+            mBusMixer.prepare(mOptions.burstFrames, 2);
+            mSeekCoordinator.prepare(mOptions.burstFrames, 2);
+
+            // Every track, centered: each channel at half gain
+            mFullLevel = 0.5f * level * mOptions.numTracks;
+            printf("%d tracks of %d s, %d Hz, %d-frame bursts, %s\n", mOptions.numTracks,
+                   kFileSeconds, mOptions.sampleRate, mOptions.burstFrames,
+                   mOptions.jump ? "jumping the transport" : "through the SeekCoordinator");
+            printf("%-12s %6s %12s %12s %8s %8s %8s %8s\n", "phase", "seeks", "latency ms",
+                   "max ms", "held", "partial", "wrong", "xruns");
+            return true;
+        }
+
+        int64_t getNumFrames() const { return mNumFrames; }
+        int32_t getNumFailures() const { return mNumFailures; }
+
+        /**
+         * Starts the transport at frame from a cold cue, as SimpleMultiPlayer's TransportStart.
+         */
+        void start(int64_t frame) {
+            if (mOptions.jump) {
+                mTransportFrame = frame;
+            } else {
+                mSeekCoordinator.requestSeek(frame);
+                mSeekCoordinator.holdUntilCued();
+            }
+            mSeekCallbacks.push_back(0);
+        }
+
+        void seek(int64_t frame) {
+            if (mOptions.jump) {
+                mTransportFrame = frame;
+            } else {
+                mSeekCoordinator.requestSeek(frame);
+            }
+            mSeekCallbacks.push_back(0);
+        }
+
+        /**
+         * Runs numCallbacks callbacks, seeking to the next of targets every seekPeriod of them.
+         */
+        void run(const char* phase, int64_t numCallbacks,
+                 const std::vector<int64_t>& targets = std::vector<int64_t>(),
+                 int32_t seekPeriod = 1) {
+            Counts before = mCounts;
+            int32_t xRunsBefore = mDriver.getXRunCount();
+            int64_t callback = 0;
+            mDriver.run(numCallbacks, [&](float* audioData, int32_t numFrames) {
+                if (callback % seekPeriod == 0 && static_cast<size_t>(callback / seekPeriod)
+                                                  < targets.size()) {
+                    seek(targets[callback / seekPeriod]);
+                }
+                callback++;
+                onAudioReady(audioData, numFrames);
+                return true;
+            });
+
+            double maxSeconds = 0.0;
+            for (double seconds : mDriver.getCallbackSeconds()) {
+                maxSeconds = std::max(maxSeconds, seconds);
+            }
+            int32_t numSeeks = static_cast<int32_t>(mSeekCallbacks.size() - mNumSeeksReported);
+            int64_t latencyCallbacks = 0;
+            for (size_t index = mNumSeeksReported; index < mSeekCallbacks.size(); index++) {
+                latencyCallbacks = std::max(latencyCallbacks, mSeekCallbacks[index]);
+            }
+            mNumSeeksReported = mSeekCallbacks.size();
+            double latencyMillis = 1000.0 * latencyCallbacks * mOptions.burstFrames
+                                   / mOptions.sampleRate;
+            printf("%-12s %6d %12.1f %12.3f %8lld %8lld %8lld %8d\n", phase, numSeeks,
+                   latencyMillis, 1000.0 * maxSeconds,
+                   static_cast<long long>(mCounts.heldBlocks - before.heldBlocks),
+                   static_cast<long long>(mCounts.partialFrames - before.partialFrames),
+                   static_cast<long long>(mCounts.wrongFrames - before.wrongFrames),
+                   mDriver.getXRunCount() - xRunsBefore);
+        }
+
+        void check(bool condition, const char* what) {
+            printf("%s: %s\n", condition ? "pass" : "FAIL", what);
+            if (!condition) {
+                mNumFailures++;
+            }
+        }
+
+        bool isSeekPending() const { return mSeekCoordinator.isPending(); }
+        int64_t getPartialFrames() const { return mCounts.partialFrames; }
+        int64_t getWrongFrames() const { return mCounts.wrongFrames; }
+        int64_t getFullFrames() const { return mCounts.fullFrames; }
+
+    private:
+        struct Counts {
+            int64_t fullFrames;     // every track, from the expected position
+            int64_t partialFrames;  // some tracks but not others
+            int64_t wrongFrames;    // every track, from somewhere else
+            int64_t heldBlocks;     // silent, waiting on a seek
+        };
+
+        Options mOptions;
+        FakeStreamDriver mDriver;
+        DiskStreamer mStreamer;
+        BusMixer mBusMixer;
+        SeekCoordinator mSeekCoordinator;
+        std::vector<std::unique_ptr<SampleSource>> mSources;
+        std::vector<SampleSource*> mTracks;
+        std::vector<int64_t> mSeekCallbacks;    // callbacks each seek waited for its switch
+        float mFullLevel;
+        int64_t mTransportFrame;
+        int64_t mNumFrames;
+        size_t mNumSeeksReported;
+        int32_t mNumFailures;
+        Counts mCounts;
+
+        // As SimpleMultiPlayer::onAudioReady() with the transport running
+        void onAudioReady(float* audioData, int32_t numFrames) {
+            memset(audioData, 0, static_cast<size_t>(numFrames) * 2 * sizeof(float));
+            bool pending = mSeekCoordinator.isPending();
+            bool advanced = true;
+            if (mOptions.jump) {
+                mBusMixer.mix(mTracks.data(), static_cast<int32_t>(mTracks.size()), audioData,
+                              2, mTransportFrame, numFrames, nullptr, mOptions.sampleRate);
+            } else {
+                advanced = mSeekCoordinator.mix(&mBusMixer, mTracks.data(),
+                                                static_cast<int32_t>(mTracks.size()), audioData,
+                                                2, &mTransportFrame, numFrames, nullptr,
+                                                mOptions.sampleRate);
+            }
+            if (pending) {
+                mSeekCallbacks.back()++;
+            }
+            if (!advanced) {
+                mCounts.heldBlocks++;
+            }
+            classify(audioData, numFrames, pending);
+            if (advanced) {
+                mTransportFrame += numFrames;
+            }
+        }
+
+        bool isFade(float ratio, int32_t frame, int32_t numFadeFrames) {
+            float phase = (frame + 0.5f) / numFadeFrames * static_cast<float>(M_PI / 2.0);
+            float fadeIn = sinf(phase);
+            float fadeOut = cosf(phase);
+            const float kFadeTolerance = 1.0e-3f;
+            return fabsf(ratio - fadeIn) < kFadeTolerance
+                   || fabsf(ratio - fadeOut) < kFadeTolerance
+                   || fabsf(ratio - (fadeIn + fadeOut)) < kFadeTolerance;
+        }
+
+        /*
+         * Sorts the frames of a block. A block mixed while a seek was pending may start with
+         * a fade, over which the position isn't checked.
+         */
+        void classify(const float* audioData, int32_t numFrames, bool pending) {
+            int32_t numFadeFrames = std::min(numFrames, SeekCoordinator::kCrossfadeFrames);
+            for (int32_t frame = 0; frame < numFrames; frame++) {
+                float left = audioData[2 * frame];
+                float right = audioData[2 * frame + 1];
+                if (fabsf(left) < kTolerance && fabsf(right) < kTolerance) {
+                    continue;
+                }
+                if (pending && frame < numFadeFrames
+                    && isFade(left / mFullLevel, frame, numFadeFrames)) {
+                    continue;
+                }
+                if (fabsf(left - mFullLevel) >= kTolerance) {
+                    mCounts.partialFrames++;
+                } else if (fabsf(right - mFullLevel * rampAt(mTransportFrame + frame))
+                           >= kTolerance) {
+                    mCounts.wrongFrames++;
+                } else {
+                    mCounts.fullFrames++;
+                }
+            }
+        }
+    };
+
+} // namespace
+
+static void usage() {
+    fprintf(stderr, "usage: seek_simulation [--burst <frames>] [--rate <Hz>] [--tracks <n>]\n"
+                    "                       [--dir <path>] [--jump]\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+        bool hasValue = index + 1 < argc;
+        if (strcmp(arg, "--burst") == 0 && hasValue) {
+            options.burstFrames = atoi(argv[++index]);
+        } else if (strcmp(arg, "--rate") == 0 && hasValue) {
+            options.sampleRate = atoi(argv[++index]);
+        } else if (strcmp(arg, "--tracks") == 0 && hasValue) {
+            options.numTracks = atoi(argv[++index]);
+        } else if (strcmp(arg, "--dir") == 0 && hasValue) {
+            options.directory = argv[++index];
+        } else if (strcmp(arg, "--jump") == 0) {
+            options.jump = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (options.burstFrames <= 0 || options.sampleRate <= 0 || options.numTracks <= 0
+        || options.numTracks > kMaxScheduleTracks) {
+        usage();
+        return 2;
+    }
+
+    FakeStreamDriver::Config config;
+    config.sampleRate = options.sampleRate;
+    config.framesPerBurst = options.burstFrames;
+    config.paced = true;
+    Simulation simulation(options, config);
+    if (!simulation.open()) {
+        return 1;
+    }
+
+    int64_t second = options.sampleRate;
+    int64_t callbacksPerSecond = std::max<int64_t>(1, second / options.burstFrames);
+
+    simulation.start(0);
+    simulation.run("start", callbacksPerSecond);
+    simulation.run("seek", callbacksPerSecond, { 10 * second });
+
+    // A scrub, a seek every 5 callbacks (~20ms at 192 frames), wandering to and fro
+    std::vector<int64_t> targets;
+    uint32_t seed = 0x2545F491;
+    for (int32_t index = 0; index < 40; index++) {
+        seed = seed * 1664525 + 1013904223;
+        targets.push_back(2 * second + (seed >> 8) % (14 * second));
+    }
+    simulation.run("scrub", 5 * targets.size() + callbacksPerSecond, targets, 5);
+
+    // Close enough to the end that the tracks run out of file before it's fully cued
+    simulation.run("near end", callbacksPerSecond,
+                   { simulation.getNumFrames() - options.burstFrames * 3 / 2 });
+    simulation.run("back", callbacksPerSecond, { 3 * second + 17 });
+
+    if (options.jump) {
+        return 0;
+    }
+    simulation.check(!simulation.isSeekPending(), "every seek was carried out");
+    simulation.check(simulation.getPartialFrames() == 0, "no partial-track output");
+    simulation.check(simulation.getWrongFrames() == 0, "every track plays from the target");
+    simulation.check(simulation.getFullFrames() > 0, "the tracks played");
+    return simulation.getNumFailures() == 0 ? 0 : 1;
+}
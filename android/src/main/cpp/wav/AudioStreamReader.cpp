@@ -0,0 +1,21 @@
+#include <cstring>
+
+#include "../flac/FlacStreamReader.h"
+#include "../stream/InputStream.h"
+
+#include "AudioStreamReader.h"
+#include "WavStreamReader.h"
+
+namespace parselib {
+
+    std::unique_ptr<AudioStreamReader> AudioStreamReader::create(InputStream* stream) {
+        char magic[4] = {};
+        stream->peek(magic, sizeof(magic));
+        // FLAC files may start with an ID3v2 tag
+        if (memcmp(magic, "fLaC", 4) == 0 || memcmp(magic, "ID3", 3) == 0) {
+            return std::make_unique<FlacStreamReader>(stream);
+        }
+        return std::make_unique<WavStreamReader>(stream);
+    }
+
+} // namespace parselib
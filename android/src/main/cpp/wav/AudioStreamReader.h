@@ -0,0 +1,56 @@
+#ifndef _IO_WAV_AUDIOSTREAMREADER_H_
+#define _IO_WAV_AUDIOSTREAMREADER_H_
+
+#include <cstdint>
+#include <memory>
+
+namespace parselib {
+
+    class InputStream;
+
+/**
+ * Decodes an audio file from an InputStream to interleaved float frames, whatever its format
+ * (WavStreamReader, FlacStreamReader). The stream must outlive the reader.
+ */
+    class AudioStreamReader {
+    public:
+        virtual ~AudioStreamReader() {}
+
+        /**
+         * Returns a reader for the format of the stream's data, told by its first bytes
+         * (WAV if it isn't recognized). The reader still has to be parse()d.
+         */
+        static std::unique_ptr<AudioStreamReader> create(InputStream* stream);
+
+        /**
+         * Reads the file's headers, and leaves the stream at the start of the audio data.
+         */
+        virtual void parse() = 0;
+
+        /**
+         * true if parse() found audio data this reader can decode.
+         */
+        virtual bool isValid() = 0;
+
+        virtual int getSampleRate() = 0;
+        virtual int getNumChannels() = 0;
+        virtual int64_t getNumSampleFrames() = 0;
+        virtual int getBitsPerSample() = 0;
+
+        // Data access
+        virtual void positionToAudio() = 0;
+        virtual void setDataPosition(int64_t frameIndex) = 0;
+
+        /**
+         * Decodes up to numFrames frames at the read position into buff, and zeroes the rest.
+         * Returns the number decoded, fewer at the end of the data, or a negative error.
+         */
+        virtual int getDataFloat(float *buff, int numFrames) = 0;
+
+        static constexpr int ERR_INVALID_FORMAT    = -1;
+        static constexpr int ERR_INVALID_STATE    = -2;
+    };
+
+} // namespace parselib
+
+#endif // _IO_WAV_AUDIOSTREAMREADER_H_
@@ -0,0 +1,441 @@
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "SampleConversion.h"
+
+namespace parselib {
+
+    static constexpr float kPCM8FullScale = (float) 0x80;
+    static constexpr float kPCM8InverseScale = 1.0f / kPCM8FullScale;
+    static constexpr float kPCM16InverseScale = 1.0f / (float) 0x8000;
+    static constexpr float kPCM32InverseScale = 1.0f / (float) 0x80000000;
+
+/*
+ * Scalar reference implementations. The vector versions use these for their tails.
+ */
+    static void convertPCM8_Scalar(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* samples = static_cast<const uint8_t*>(src);
+        for (int32_t index = 0; index < numSamples; index++) {
+            // PCM8 is unsigned, so we need to make it signed before scaling/converting
+            dst[index] = ((float) samples[index] - kPCM8FullScale) * kPCM8InverseScale;
+        }
+    }
+
+    static void convertPCM16_Scalar(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        for (int32_t index = 0; index < numSamples; index++) {
+            int16_t sample;
+            memcpy(&sample, bytes + index * sizeof(int16_t), sizeof(int16_t));
+            dst[index] = (float) sample * kPCM16InverseScale;
+        }
+    }
+
+    static void convertPCM24_Scalar(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        for (int32_t index = 0; index < numSamples; index++) {
+            // Packed little-endian, shifted into the top of an int32 to pick up the sign
+            const uint8_t* sample = bytes + index * 3;
+            uint32_t value = ((uint32_t) sample[0] << 8) | ((uint32_t) sample[1] << 16)
+                             | ((uint32_t) sample[2] << 24);
+            dst[index] = (float) (int32_t) value * kPCM32InverseScale;
+        }
+    }
+
+    static void convertPCM32_Scalar(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        for (int32_t index = 0; index < numSamples; index++) {
+            int32_t sample;
+            memcpy(&sample, bytes + index * sizeof(int32_t), sizeof(int32_t));
+            dst[index] = (float) sample * kPCM32InverseScale;
+        }
+    }
+
+#if defined(__ARM_NEON)
+/*
+ * NEON. Loads are done as bytes so the source needn't be aligned.
+ */
+    static void convertPCM8_Neon(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* samples = static_cast<const uint8_t*>(src);
+        const int32x4_t offset = vdupq_n_s32(0x80);
+        const float32x4_t scale = vdupq_n_f32(kPCM8InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            uint8x16_t bytes = vld1q_u8(samples + index);
+            uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+            uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+
+            int32x4_t s0 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low))), offset);
+            int32x4_t s1 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low))), offset);
+            int32x4_t s2 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(high))), offset);
+            int32x4_t s3 = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(high))), offset);
+
+            vst1q_f32(dst + index, vmulq_f32(vcvtq_f32_s32(s0), scale));
+            vst1q_f32(dst + index + 4, vmulq_f32(vcvtq_f32_s32(s1), scale));
+            vst1q_f32(dst + index + 8, vmulq_f32(vcvtq_f32_s32(s2), scale));
+            vst1q_f32(dst + index + 12, vmulq_f32(vcvtq_f32_s32(s3), scale));
+        }
+
+        convertPCM8_Scalar(samples + index, dst + index, numSamples - index);
+    }
+
+    static void convertPCM16_Neon(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const float32x4_t scale = vdupq_n_f32(kPCM16InverseScale);
+
+        int32_t index = 0;
+        for (; index + 8 <= numSamples; index += 8) {
+            int16x8_t samples = vreinterpretq_s16_u8(vld1q_u8(bytes + index * sizeof(int16_t)));
+            int32x4_t low = vmovl_s16(vget_low_s16(samples));
+            int32x4_t high = vmovl_s16(vget_high_s16(samples));
+
+            vst1q_f32(dst + index, vmulq_f32(vcvtq_f32_s32(low), scale));
+            vst1q_f32(dst + index + 4, vmulq_f32(vcvtq_f32_s32(high), scale));
+        }
+
+        convertPCM16_Scalar(bytes + index * sizeof(int16_t), dst + index, numSamples - index);
+    }
+
+    static void convertPCM24_Neon(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const uint8x16_t zero = vdupq_n_u8(0);
+        const float32x4_t scale = vdupq_n_f32(kPCM32InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            // De-interleave 16 packed samples into low/mid/high byte planes, then zip them
+            // back together as [0, low, mid, high] int32s
+            uint8x16x3_t planes = vld3q_u8(bytes + index * 3);
+            uint8x16x2_t lowHalves = vzipq_u8(zero, planes.val[0]);
+            uint8x16x2_t highHalves = vzipq_u8(planes.val[1], planes.val[2]);
+
+            for (int part = 0; part < 2; part++) {
+                uint16x8x2_t words = vzipq_u16(vreinterpretq_u16_u8(lowHalves.val[part]),
+                                               vreinterpretq_u16_u8(highHalves.val[part]));
+                int32x4_t s0 = vreinterpretq_s32_u16(words.val[0]);
+                int32x4_t s1 = vreinterpretq_s32_u16(words.val[1]);
+
+                vst1q_f32(dst + index + part * 8, vmulq_f32(vcvtq_f32_s32(s0), scale));
+                vst1q_f32(dst + index + part * 8 + 4, vmulq_f32(vcvtq_f32_s32(s1), scale));
+            }
+        }
+
+        convertPCM24_Scalar(bytes + index * 3, dst + index, numSamples - index);
+    }
+
+    static void convertPCM32_Neon(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const float32x4_t scale = vdupq_n_f32(kPCM32InverseScale);
+
+        int32_t index = 0;
+        for (; index + 8 <= numSamples; index += 8) {
+            int32x4_t s0 = vreinterpretq_s32_u8(vld1q_u8(bytes + index * sizeof(int32_t)));
+            int32x4_t s1 = vreinterpretq_s32_u8(vld1q_u8(bytes + (index + 4) * sizeof(int32_t)));
+
+            vst1q_f32(dst + index, vmulq_f32(vcvtq_f32_s32(s0), scale));
+            vst1q_f32(dst + index + 4, vmulq_f32(vcvtq_f32_s32(s1), scale));
+        }
+
+        convertPCM32_Scalar(bytes + index * sizeof(int32_t), dst + index, numSamples - index);
+    }
+#endif // __ARM_NEON
+
+#if defined(__SSE2__)
+/*
+ * SSE2
+ */
+    static void convertPCM8_Sse2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* samples = static_cast<const uint8_t*>(src);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i offset = _mm_set1_epi32(0x80);
+        const __m128 scale = _mm_set1_ps(kPCM8InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + index));
+            __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+            __m128i s0 = _mm_sub_epi32(_mm_unpacklo_epi16(low, zero), offset);
+            __m128i s1 = _mm_sub_epi32(_mm_unpackhi_epi16(low, zero), offset);
+            __m128i s2 = _mm_sub_epi32(_mm_unpacklo_epi16(high, zero), offset);
+            __m128i s3 = _mm_sub_epi32(_mm_unpackhi_epi16(high, zero), offset);
+
+            _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(s0), scale));
+            _mm_storeu_ps(dst + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(s1), scale));
+            _mm_storeu_ps(dst + index + 8, _mm_mul_ps(_mm_cvtepi32_ps(s2), scale));
+            _mm_storeu_ps(dst + index + 12, _mm_mul_ps(_mm_cvtepi32_ps(s3), scale));
+        }
+
+        convertPCM8_Scalar(samples + index, dst + index, numSamples - index);
+    }
+
+    static void convertPCM16_Sse2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m128 scale = _mm_set1_ps(kPCM16InverseScale);
+
+        int32_t index = 0;
+        for (; index + 8 <= numSamples; index += 8) {
+            __m128i samples = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(bytes + index * sizeof(int16_t)));
+            // Duplicate each 16-bit sample into a 32-bit lane, then sign-extend by shifting down
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+            _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+            _mm_storeu_ps(dst + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+        }
+
+        convertPCM16_Scalar(bytes + index * sizeof(int16_t), dst + index, numSamples - index);
+    }
+
+    static void convertPCM32_Sse2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m128 scale = _mm_set1_ps(kPCM32InverseScale);
+
+        int32_t index = 0;
+        for (; index + 8 <= numSamples; index += 8) {
+            __m128i s0 = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(bytes + index * sizeof(int32_t)));
+            __m128i s1 = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(bytes + (index + 4) * sizeof(int32_t)));
+
+            _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(s0), scale));
+            _mm_storeu_ps(dst + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(s1), scale));
+        }
+
+        convertPCM32_Scalar(bytes + index * sizeof(int32_t), dst + index, numSamples - index);
+    }
+#endif // __SSE2__
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * SSSE3, for the PCM24 byte shuffle. Like AVX2 it is compiled for its target regardless of
+ * the build flags and picked at runtime.
+ */
+    __attribute__((target("ssse3")))
+    static void convertPCM24_Ssse3(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                              -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m128 scale = _mm_set1_ps(kPCM32InverseScale);
+
+        // Loads 16 bytes but only uses 12, so stop while the over-read is in bounds
+        int32_t index = 0;
+        for (; index + 6 <= numSamples; index += 4) {
+            __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + index * 3));
+            __m128i samples = _mm_shuffle_epi8(packed, shuffle);
+            _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+        }
+
+        convertPCM24_Scalar(bytes + index * 3, dst + index, numSamples - index);
+    }
+#endif // x86
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * AVX2. Compiled for the AVX2 target regardless of the build flags, only called
+ * when the CPU reports support.
+ */
+#define IOLIB_HAVE_AVX2 1
+
+    __attribute__((target("avx2")))
+    static void convertPCM8_Avx2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* samples = static_cast<const uint8_t*>(src);
+        const __m256i offset = _mm256_set1_epi32(0x80);
+        const __m256 scale = _mm256_set1_ps(kPCM8InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + index));
+            __m256i s0 = _mm256_sub_epi32(_mm256_cvtepu8_epi32(bytes), offset);
+            __m256i s1 = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), offset);
+
+            _mm256_storeu_ps(dst + index, _mm256_mul_ps(_mm256_cvtepi32_ps(s0), scale));
+            _mm256_storeu_ps(dst + index + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(s1), scale));
+        }
+
+        convertPCM8_Scalar(samples + index, dst + index, numSamples - index);
+    }
+
+    __attribute__((target("avx2")))
+    static void convertPCM16_Avx2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m256 scale = _mm256_set1_ps(kPCM16InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            __m256i samples = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(bytes + index * sizeof(int16_t)));
+            __m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(samples));
+            __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(samples, 1));
+
+            _mm256_storeu_ps(dst + index, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+            _mm256_storeu_ps(dst + index + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+        }
+
+        convertPCM16_Scalar(bytes + index * sizeof(int16_t), dst + index, numSamples - index);
+    }
+
+    // [0, b0, b1, b2] for each of the four packed samples in the low 12 bytes of a register
+    #define IOLIB_PCM24_SHUFFLE_MASK \
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11
+
+    __attribute__((target("avx2")))
+    static void convertPCM24_Avx2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m256i shuffle = _mm256_setr_epi8(IOLIB_PCM24_SHUFFLE_MASK,
+                                                 IOLIB_PCM24_SHUFFLE_MASK);
+        const __m256 scale = _mm256_set1_ps(kPCM32InverseScale);
+
+        // Each lane loads 16 bytes but only uses 12, so stop while the over-read is in bounds
+        int32_t index = 0;
+        for (; index + 10 <= numSamples; index += 8) {
+            const uint8_t* block = bytes + index * 3;
+            __m256i packed = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 12)), 1);
+            __m256i samples = _mm256_shuffle_epi8(packed, shuffle);
+            _mm256_storeu_ps(dst + index, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+        }
+
+        convertPCM24_Scalar(bytes + index * 3, dst + index, numSamples - index);
+    }
+
+    __attribute__((target("avx2")))
+    static void convertPCM32_Avx2(const void* src, float* dst, int32_t numSamples) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(src);
+        const __m256 scale = _mm256_set1_ps(kPCM32InverseScale);
+
+        int32_t index = 0;
+        for (; index + 16 <= numSamples; index += 16) {
+            __m256i s0 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(bytes + index * sizeof(int32_t)));
+            __m256i s1 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(bytes + (index + 8) * sizeof(int32_t)));
+
+            _mm256_storeu_ps(dst + index, _mm256_mul_ps(_mm256_cvtepi32_ps(s0), scale));
+            _mm256_storeu_ps(dst + index + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(s1), scale));
+        }
+
+        convertPCM32_Scalar(bytes + index * sizeof(int32_t), dst + index, numSamples - index);
+    }
+#endif // x86
+
+/*
+ * Dispatch
+ */
+    SampleConversion::Converters SampleConversion::sConverters =
+            SampleConversion::selectDefaultConverters();
+
+    const char* SampleConversion::getImplementationName(Implementation implementation) {
+        switch (implementation) {
+            case Implementation::Scalar: return "scalar";
+            case Implementation::Neon: return "neon";
+            case Implementation::Sse2: return "sse2";
+            case Implementation::Avx2: return "avx2";
+            default: return "unknown";
+        }
+    }
+
+    bool SampleConversion::isSupported(Implementation implementation) {
+        switch (implementation) {
+            case Implementation::Scalar:
+                return true;
+
+#if defined(__ARM_NEON)
+            // NEON is mandatory on arm64-v8a and enabled by default for armeabi-v7a
+            case Implementation::Neon:
+                return true;
+#endif
+
+#if defined(__SSE2__)
+            case Implementation::Sse2:
+                return true;
+#endif
+
+#if defined(IOLIB_HAVE_AVX2)
+            case Implementation::Avx2:
+                return __builtin_cpu_supports("avx2");
+#endif
+
+            default:
+                return false;
+        }
+    }
+
+    SampleConversion::Implementation SampleConversion::getBestImplementation() {
+        static const Implementation kPreferred[] = {
+                Implementation::Avx2, Implementation::Sse2, Implementation::Neon
+        };
+        for (Implementation implementation : kPreferred) {
+            if (isSupported(implementation)) {
+                return implementation;
+            }
+        }
+        return Implementation::Scalar;
+    }
+
+    bool SampleConversion::setImplementation(Implementation implementation) {
+        if (!isSupported(implementation)) {
+            return false;
+        }
+        sConverters = selectConverters(implementation);
+        return true;
+    }
+
+    void SampleConversion::setDefaultImplementation() {
+        sConverters = selectDefaultConverters();
+    }
+
+    SampleConversion::Converters SampleConversion::selectDefaultConverters() {
+        Converters converters = selectConverters(getBestImplementation());
+#if defined(__SSE2__)
+        if (converters.implementation == Implementation::Sse2) {
+            // SSE2 is the x86-64 baseline, so the compiler vectorizes the PCM16 and PCM32
+            // scalar loops just as well, and they measure faster than the hand-written kernels
+            // (conversion_benchmark)
+            converters.pcm16 = convertPCM16_Scalar;
+            converters.pcm32 = convertPCM32_Scalar;
+        }
+#endif
+        return converters;
+    }
+
+    SampleConversion::Converters SampleConversion::selectConverters(Implementation implementation) {
+        switch (implementation) {
+#if defined(__ARM_NEON)
+            case Implementation::Neon:
+                return { implementation, convertPCM8_Neon, convertPCM16_Neon, convertPCM24_Neon,
+                         convertPCM32_Neon };
+#endif
+
+#if defined(__SSE2__)
+            case Implementation::Sse2:
+                // The PCM24 shuffle needs SSSE3, which practically every SSE2 CPU has
+                return { implementation, convertPCM8_Sse2, convertPCM16_Sse2,
+                         __builtin_cpu_supports("ssse3") ? convertPCM24_Ssse3 : convertPCM24_Scalar,
+                         convertPCM32_Sse2 };
+#endif
+
+#if defined(IOLIB_HAVE_AVX2)
+            case Implementation::Avx2:
+                return { implementation, convertPCM8_Avx2, convertPCM16_Avx2, convertPCM24_Avx2,
+                         convertPCM32_Avx2 };
+#endif
+
+            default:
+                return { Implementation::Scalar,
+                         convertPCM8_Scalar, convertPCM16_Scalar, convertPCM24_Scalar,
+                         convertPCM32_Scalar };
+        }
+    }
+
+} // namespace parselib
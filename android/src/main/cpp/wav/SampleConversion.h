@@ -0,0 +1,85 @@
+#ifndef _IO_WAV_SAMPLECONVERSION_H_
+#define _IO_WAV_SAMPLECONVERSION_H_
+
+#include <cstdint>
+
+namespace parselib {
+
+/**
+ * Block converters from the WAV PCM encodings to float in [-1.0, 1.0).
+ *
+ * Each conversion has a scalar reference implementation plus vectorized versions
+ * (NEON on ARM, SSE2/AVX2 on x86). By default the fastest one the CPU supports is picked for
+ * each encoding, which may be the scalar one; all implementations produce bit-identical output.
+ *
+ * Sources need not be aligned. numSamples counts individual samples, not frames.
+ */
+    class SampleConversion {
+    public:
+        enum class Implementation : int32_t {
+            Scalar = 0,
+            Neon,
+            Sse2,
+            Avx2,
+        };
+
+        static void convertPCM8(const void* src, float* dst, int32_t numSamples) {
+            sConverters.pcm8(src, dst, numSamples);
+        }
+
+        static void convertPCM16(const void* src, float* dst, int32_t numSamples) {
+            sConverters.pcm16(src, dst, numSamples);
+        }
+
+        /**
+         * 24-bit samples are packed, 3 bytes each.
+         */
+        static void convertPCM24(const void* src, float* dst, int32_t numSamples) {
+            sConverters.pcm24(src, dst, numSamples);
+        }
+
+        static void convertPCM32(const void* src, float* dst, int32_t numSamples) {
+            sConverters.pcm32(src, dst, numSamples);
+        }
+
+        /**
+         * The implementation in use, or that the default per-encoding choice is drawn from.
+         */
+        static Implementation getImplementation() { return sConverters.implementation; }
+
+        static const char* getImplementationName(Implementation implementation);
+
+        static bool isSupported(Implementation implementation);
+
+        /**
+         * Force a specific implementation (e.g. for benchmarking). Returns false, and changes
+         * nothing, if it isn't supported on this CPU/build. Not thread-safe.
+         */
+        static bool setImplementation(Implementation implementation);
+
+        /**
+         * Back to the default, per-encoding choice. Not thread-safe.
+         */
+        static void setDefaultImplementation();
+
+    private:
+        typedef void (*ConvertFunction)(const void* src, float* dst, int32_t numSamples);
+
+        struct Converters {
+            Implementation  implementation;
+            ConvertFunction pcm8;
+            ConvertFunction pcm16;
+            ConvertFunction pcm24;
+            ConvertFunction pcm32;
+        };
+
+        static Converters selectConverters(Implementation implementation);
+        static Converters selectDefaultConverters();
+        static Implementation getBestImplementation();
+
+        static Converters sConverters;
+    };
+
+} // namespace parselib
+
+#endif // _IO_WAV_SAMPLECONVERSION_H_
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "../stream/InputStream.h"
+#include "../stream/OutputStream.h"
 
 #include "WavChunkHeader.h"
 
@@ -26,4 +27,9 @@ namespace parselib {
         stream->read(&mChunkSize, sizeof(mChunkSize));
     }
 
+    void WavChunkHeader::write(OutputStream *stream) {
+        stream->write(&mChunkId, sizeof(mChunkId));
+        stream->write(&mChunkSize, sizeof(mChunkSize));
+    }
+
 } // namespace parselib
\ No newline at end of file
@@ -21,6 +21,7 @@
 namespace parselib {
 
     class InputStream;
+    class OutputStream;
 
 /**
  * Superclass for all RIFF chunks. Handles the chunk ID and chunk size.
@@ -43,6 +44,12 @@ namespace parselib {
          * as the first step. It may then read the fields specific to that chunk type.
          */
         virtual void read(InputStream *stream);
+
+        /**
+         * Writes the chunk header, the counterpart of read(). Subclasses MUST call this (super)
+         * method first, then write their own fields.
+         */
+        virtual void write(OutputStream *stream);
     };
 
 } // namespace parselib
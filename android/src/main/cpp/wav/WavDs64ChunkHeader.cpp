@@ -0,0 +1,41 @@
+#include "../stream/InputStream.h"
+#include "../stream/OutputStream.h"
+
+#include "WavDs64ChunkHeader.h"
+
+namespace parselib {
+
+    const RiffID WavDs64ChunkHeader::RIFFID_DS64 = makeRiffID('d', 's', '6', '4');
+    const RiffID WavDs64ChunkHeader::RIFFID_JUNK = makeRiffID('J', 'U', 'N', 'K');
+
+    WavDs64ChunkHeader::WavDs64ChunkHeader() : WavChunkHeader(RIFFID_DS64) {
+        mRiffSize = 0;
+        mDataSize = 0;
+        mSampleCount = 0;
+    }
+
+    WavDs64ChunkHeader::WavDs64ChunkHeader(RiffID tag) : WavChunkHeader(tag) {
+        mRiffSize = 0;
+        mDataSize = 0;
+        mSampleCount = 0;
+    }
+
+    void WavDs64ChunkHeader::read(InputStream *stream) {
+        WavChunkHeader::read(stream);
+        stream->read(&mRiffSize, sizeof(mRiffSize));
+        stream->read(&mDataSize, sizeof(mDataSize));
+        stream->read(&mSampleCount, sizeof(mSampleCount));
+    }
+
+    void WavDs64ChunkHeader::write(OutputStream *stream) {
+        RiffInt32 tableLength = 0;
+        mChunkSize = sizeof(mRiffSize) + sizeof(mDataSize) + sizeof(mSampleCount)
+                     + sizeof(tableLength);
+        WavChunkHeader::write(stream);
+        stream->write(&mRiffSize, sizeof(mRiffSize));
+        stream->write(&mDataSize, sizeof(mDataSize));
+        stream->write(&mSampleCount, sizeof(mSampleCount));
+        stream->write(&tableLength, sizeof(tableLength));
+    }
+
+} // namespace parselib
@@ -0,0 +1,43 @@
+#ifndef _IO_WAV_WAVDS64CHUNKHEADER_H_
+#define _IO_WAV_WAVDS64CHUNKHEADER_H_
+
+#include "WavChunkHeader.h"
+
+namespace parselib {
+
+    class InputStream;
+
+/**
+ * Encapsulates the 'ds64' chunk of an RF64/BW64 file, which holds the 64-bit sizes of the
+ * 'RF64' and 'data' chunks whose own size fields are SIZE_IN_DS64.
+ *
+ * The table of sizes of other chunks isn't read, only 'data' is ever that large here.
+ */
+    class WavDs64ChunkHeader : public WavChunkHeader {
+    public:
+        static const RiffID RIFFID_DS64;
+
+        // The placeholder a writer leaves for a 'ds64' chunk, in case the file gets that large
+        static const RiffID RIFFID_JUNK;
+
+        static const RiffInt32 SIZE_IN_DS64 = -1; // 0xFFFFFFFF
+
+        RiffInt64 mRiffSize;
+        RiffInt64 mDataSize;
+        RiffInt64 mSampleCount;
+
+        WavDs64ChunkHeader();
+
+        WavDs64ChunkHeader(RiffID tag);
+
+        void read(InputStream *stream);
+
+        /**
+         * Writes the chunk with an empty table, 36 bytes all told.
+         */
+        void write(OutputStream *stream);
+    };
+
+} // namespace parselib
+
+#endif // _IO_WAV_WAVDS64CHUNKHEADER_H_
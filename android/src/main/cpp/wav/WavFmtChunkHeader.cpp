@@ -16,6 +16,7 @@
 #include <android/log.h>
 
 #include "../stream/InputStream.h"
+#include "../stream/OutputStream.h"
 
 #include "WavFmtChunkHeader.h"
 
@@ -67,9 +68,30 @@ namespace parselib {
         if (mEncodingId != ENCODING_PCM && mEncodingId != ENCODING_IEEE_FLOAT) {
             // only read this if NOT PCM
             stream->read(&mExtraBytes, sizeof(mExtraBytes));
+
+            // Usual for more than 2 channels or 16 bits. The SubFormat GUID starts with the
+            // encoding ID, the rest of the chunk is left to the caller to skip.
+            if (mEncodingId == ENCODING_EXTENSIBLE && mExtraBytes >= 22) {
+                RiffInt16 validBitsPerSample;
+                RiffInt32 channelMask;
+                stream->read(&validBitsPerSample, sizeof(validBitsPerSample));
+                stream->read(&channelMask, sizeof(channelMask));
+                stream->read(&mEncodingId, sizeof(mEncodingId));
+            }
         } else {
             mExtraBytes = (short) (mChunkSize - 16);
         }
     }
 
+    void WavFmtChunkHeader::write(OutputStream *stream) {
+        mChunkSize = 16;
+        WavChunkHeader::write(stream);
+        stream->write(&mEncodingId, sizeof(mEncodingId));
+        stream->write(&mNumChannels, sizeof(mNumChannels));
+        stream->write(&mSampleRate, sizeof(mSampleRate));
+        stream->write(&mAveBytesPerSecond, sizeof(mAveBytesPerSecond));
+        stream->write(&mBlockAlign, sizeof(mBlockAlign));
+        stream->write(&mSampleSize, sizeof(mSampleSize));
+    }
+
 } // namespace parselib
\ No newline at end of file
@@ -33,6 +33,7 @@ namespace parselib {
         static const short ENCODING_PCM = 1;
         static const short ENCODING_ADPCM = 2; // Microsoft ADPCM Format
         static const short ENCODING_IEEE_FLOAT = 3; // samples from -1.0 -> 1.0
+        static const short ENCODING_EXTENSIBLE = (short) 0xFFFE; // read() replaces it by its SubFormat
 
         RiffInt16 mEncodingId;  /** Microsoft WAV encoding ID (see above) */
         RiffInt16 mNumChannels;
@@ -49,6 +50,11 @@ namespace parselib {
         void normalize();
 
         void read(InputStream *stream);
+
+        /**
+         * Writes a PCM/IEEE float "fmt " chunk. Call normalize() first.
+         */
+        void write(OutputStream *stream);
     };
 
 } // namespace parselib
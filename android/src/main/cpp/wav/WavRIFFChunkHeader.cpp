@@ -15,10 +15,13 @@
  */
 #include "WavRIFFChunkHeader.h"
 #include "../stream/InputStream.h"
+#include "../stream/OutputStream.h"
 
 namespace parselib {
 
     const RiffID WavRIFFChunkHeader::RIFFID_RIFF = makeRiffID('R', 'I', 'F', 'F');
+    const RiffID WavRIFFChunkHeader::RIFFID_RF64 = makeRiffID('R', 'F', '6', '4');
+    const RiffID WavRIFFChunkHeader::RIFFID_BW64 = makeRiffID('B', 'W', '6', '4');
     const RiffID WavRIFFChunkHeader::RIFFID_WAVE = makeRiffID('W', 'A', 'V', 'E');
 
     WavRIFFChunkHeader::WavRIFFChunkHeader() : WavChunkHeader(RIFFID_RIFF) {
@@ -34,4 +37,9 @@ namespace parselib {
         stream->read(&mFormatId, sizeof(mFormatId));
     }
 
+    void WavRIFFChunkHeader::write(OutputStream *stream) {
+        WavChunkHeader::write(stream);
+        stream->write(&mFormatId, sizeof(mFormatId));
+    }
+
 } // namespace parselib
\ No newline at end of file
@@ -25,6 +25,9 @@ namespace parselib {
     class WavRIFFChunkHeader : public WavChunkHeader {
     public:
         static const RiffID RIFFID_RIFF;
+        // RIFF with 64-bit sizes in a 'ds64' chunk (EBU Tech 3306, ITU-R BS.2088)
+        static const RiffID RIFFID_RF64;
+        static const RiffID RIFFID_BW64;
 
         static const RiffID RIFFID_WAVE;
 
@@ -35,6 +38,8 @@ namespace parselib {
         WavRIFFChunkHeader(RiffID tag);
 
         virtual void read(InputStream *stream);
+
+        virtual void write(OutputStream *stream);
     };
 
 } // namespace parselib
@@ -23,12 +23,15 @@
 #include "AudioEncoding.h"
 #include "WavRIFFChunkHeader.h"
 #include "WavFmtChunkHeader.h"
+#include "WavDs64ChunkHeader.h"
 #include "WavChunkHeader.h"
+#include "SampleConversion.h"
 #include "WavStreamReader.h"
 
 static const char *TAG = "WavStreamReader";
 
-static constexpr int kConversionBufferFrames = 16;
+// Staging buffer for streams that can't be decoded in place
+static constexpr int kConversionBufferBytes = 4096;
 
 namespace parselib {
 
@@ -38,8 +41,10 @@ namespace parselib {
         mWavChunk = nullptr;
         mFmtChunk = nullptr;
         mDataChunk = nullptr;
+        mDs64Chunk = nullptr;
 
         mAudioDataStartPos = -1;
+        mDataSize = 0;
     }
 
     int WavStreamReader::getSampleEncoding() {
@@ -80,25 +85,44 @@ namespace parselib {
 //        __android_log_print(ANDROID_LOG_INFO, TAG, "[%c%c%c%c]",
 //                            tagStr[0], tagStr[1], tagStr[2], tagStr[3]);
 
-            std::shared_ptr<WavChunkHeader> chunk = nullptr;
-            if (tag == WavRIFFChunkHeader::RIFFID_RIFF) {
-                chunk = mWavChunk = std::make_shared<WavRIFFChunkHeader>(WavRIFFChunkHeader(tag));
+            if (tag == WavRIFFChunkHeader::RIFFID_RIFF || tag == WavRIFFChunkHeader::RIFFID_RF64
+                || tag == WavRIFFChunkHeader::RIFFID_BW64) {
+                // The other chunks are its body
+                mWavChunk = std::make_shared<WavRIFFChunkHeader>(WavRIFFChunkHeader(tag));
                 mWavChunk->read(mStream);
-            } else if (tag == WavFmtChunkHeader::RIFFID_FMT) {
+                mChunkMap[tag] = mWavChunk;
+                continue;
+            }
+
+            int64_t chunkPos = mStream->getPos();
+            std::shared_ptr<WavChunkHeader> chunk = nullptr;
+            if (tag == WavFmtChunkHeader::RIFFID_FMT) {
                 chunk = mFmtChunk = std::make_shared<WavFmtChunkHeader>(WavFmtChunkHeader(tag));
                 mFmtChunk->read(mStream);
+            } else if (tag == WavDs64ChunkHeader::RIFFID_DS64) {
+                chunk = mDs64Chunk = std::make_shared<WavDs64ChunkHeader>(WavDs64ChunkHeader(tag));
+                mDs64Chunk->read(mStream);
             } else if (tag == WavChunkHeader::RIFFID_DATA) {
                 chunk = mDataChunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
                 mDataChunk->read(mStream);
                 // We are now positioned at the start of the audio data.
                 mAudioDataStartPos = mStream->getPos();
-                mStream->advance(mDataChunk->mChunkSize);
             } else {
                 chunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
                 chunk->read(mStream);
-                mStream->advance(chunk->mChunkSize); // skip the body
             }
 
+            // Sizes are unsigned, and chunks word aligned
+            int64_t chunkSize = static_cast<uint32_t>(chunk->mChunkSize);
+            if (chunk == mDataChunk) {
+                if (chunk->mChunkSize == WavDs64ChunkHeader::SIZE_IN_DS64 && mDs64Chunk != nullptr) {
+                    chunkSize = mDs64Chunk->mDataSize;
+                }
+                mDataSize = chunkSize;
+            }
+            mStream->setPos(chunkPos + sizeof(RiffID) + sizeof(RiffInt32)
+                            + chunkSize + (chunkSize & 1));
+
             mChunkMap[tag] = chunk;
         }
 
@@ -114,8 +138,8 @@ namespace parselib {
         }
     }
 
-    void WavStreamReader::setDataPosition(int frameIndex) {
-        int shift = frameIndex * mFmtChunk->mNumChannels * (mFmtChunk->mSampleSize / 8);
+    void WavStreamReader::setDataPosition(int64_t frameIndex) {
+        int64_t shift = frameIndex * mFmtChunk->mNumChannels * (mFmtChunk->mSampleSize / 8);
 
         if (mDataChunk != 0) {
             mStream->setPos(mAudioDataStartPos + shift);
@@ -123,34 +147,36 @@ namespace parselib {
     }
 
 /**
- * Read and convert samples in PCM8 format to float
+ * Read samples of sampleSize bytes and convert them to float with the specified block converter
  */
-    int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
+    int WavStreamReader::getDataFloat_Converted(float *buff, int numFrames, int sampleSize,
+                                                ConvertFunction convert) {
         int numChannels = mFmtChunk->mNumChannels;
+        int frameSize = sampleSize * numChannels;
+
+        int32_t numAvailable;
+        const void* directData = mStream->peekDirect(&numAvailable);
+        if (directData != nullptr) {
+            // Convert the whole block straight out of the stream's memory, no intermediate copy
+            int numFramesRead = std::min(numFrames, numAvailable / frameSize);
+            convert(directData, buff, numFramesRead * numChannels);
+            mStream->advance(numFramesRead * frameSize);
+            return numFramesRead;
+        }
 
-        int buffOffset = 0;
         int totalFramesRead = 0;
 
-        static constexpr int kSampleSize = sizeof(u_int8_t);
-        static constexpr float kSampleFullScale = (float)0x80;
-        static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-        u_int8_t readBuff[kConversionBufferFrames * numChannels];
+        uint8_t readBuff[kConversionBufferBytes];
+        int maxFramesPerRead = std::max(1, kConversionBufferBytes / frameSize);
         int framesLeft = numFrames;
         while (framesLeft > 0) {
-            int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-            //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
+            int framesThisRead = std::min(framesLeft, maxFramesPerRead);
             int numFramesRead =
-                    mStream->read(readBuff, framesThisRead *  kSampleSize * numChannels) /
-                    (kSampleSize * numChannels);
-            totalFramesRead += numFramesRead;
+                    std::max(0, mStream->read(readBuff, framesThisRead * frameSize) / frameSize);
 
             // Convert & Scale
-            for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-                // PCM8 is unsigned, so we need to make it signed before scaling/converting
-                buff[buffOffset++] = ((float) readBuff[offset] - kSampleFullScale)
-                                     * kInverseScale;
-            }
+            convert(readBuff, buff + totalFramesRead * numChannels, numFramesRead * numChannels);
+            totalFramesRead += numFramesRead;
 
             if (numFramesRead < framesThisRead) {
                 break; // none left
@@ -162,64 +188,27 @@ namespace parselib {
         return totalFramesRead;
     }
 
+/**
+ * Read and convert samples in PCM8 format to float
+ */
+    int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
+        return getDataFloat_Converted(buff, numFrames, sizeof(uint8_t),
+                                      SampleConversion::convertPCM8);
+    }
+
 /**
  * Read and convert samples in PCM16 format to float
  */
     int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
-        int numChannels = mFmtChunk->mNumChannels;
-
-        int buffOffset = 0;
-        int totalFramesRead = 0;
-
-        static constexpr int kSampleSize = sizeof(int16_t);
-        static constexpr float kSampleFullScale = (float) 0x8000;
-        static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-        int16_t readBuff[kConversionBufferFrames * numChannels];
-        int framesLeft = numFrames;
-        while (framesLeft > 0) {
-            int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-            //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
-            int numFramesRead =
-                    mStream->read(readBuff, framesThisRead * kSampleSize * numChannels) /
-                    (kSampleSize * numChannels);
-            totalFramesRead += numFramesRead;
-
-            // Convert & Scale
-            for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-                buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
-            }
-
-            if (numFramesRead < framesThisRead) {
-                break; // none left
-            }
-
-            framesLeft -= framesThisRead;
-        }
-
-        return totalFramesRead;
+        return getDataFloat_Converted(buff, numFrames, sizeof(int16_t),
+                                      SampleConversion::convertPCM16);
     }
 
 /**
  * Read and convert samples in PCM24 format to float
  */
     int WavStreamReader::getDataFloat_PCM24(float *buff, int numFrames) {
-        int numChannels = mFmtChunk->mNumChannels;
-        int numSamples = numFrames * numChannels;
-
-        static constexpr float kSampleFullScale = (float) 0x80000000;
-        static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-        uint8_t buffer[3];
-        for(int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
-            if (mStream->read(buffer, 3) < 3) {
-                break; // no more data
-            }
-            int32_t sample = (buffer[0] << 8) | (buffer[1] << 16) | (buffer[2] << 24);
-            buff[sampleIndex] = (float)sample * kInverseScale;
-        }
-
-        return numFrames;
+        return getDataFloat_Converted(buff, numFrames, 3, SampleConversion::convertPCM24);
     }
 
 /**
@@ -229,6 +218,15 @@ namespace parselib {
         // Turns out that WAV Float32 is just Android floats
         int numChannels = mFmtChunk->mNumChannels;
 
+        int32_t numAvailable;
+        const void* directData = mStream->peekDirect(&numAvailable);
+        if (directData != nullptr) {
+            int numFramesRead = std::min(numFrames, numAvailable / (int)(sizeof(float) * numChannels));
+            memcpy(buff, directData, numFramesRead * sizeof(float) * numChannels);
+            mStream->advance(numFramesRead * sizeof(float) * numChannels);
+            return numFramesRead;
+        }
+
         return mStream->read(buff, numFrames * sizeof(float) * numChannels) /
                (sizeof(float) * numChannels);
     }
@@ -237,38 +235,8 @@ namespace parselib {
  * Read and convert samples in PCM32 format to float
  */
     int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
-        int numChannels = mFmtChunk->mNumChannels;
-
-        int buffOffset = 0;
-        int totalFramesRead = 0;
-
-        static constexpr int kSampleSize = sizeof(int32_t);
-        static constexpr float kSampleFullScale = (float) 0x80000000;
-        static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-        int32_t readBuff[kConversionBufferFrames * numChannels];
-        int framesLeft = numFrames;
-        while (framesLeft > 0) {
-            int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-            //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
-            int numFramesRead =
-                    mStream->read(readBuff, framesThisRead *  kSampleSize* numChannels) /
-                    (kSampleSize * numChannels);
-            totalFramesRead += numFramesRead;
-
-            // convert & Scale
-            for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-                buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
-            }
-
-            if (numFramesRead < framesThisRead) {
-                break; // none left
-            }
-
-            framesLeft -= framesThisRead;
-        }
-
-        return totalFramesRead;
+        return getDataFloat_Converted(buff, numFrames, sizeof(int32_t),
+                                      SampleConversion::convertPCM32);
     }
 
     int WavStreamReader::getDataFloat(float *buff, int numFrames) {
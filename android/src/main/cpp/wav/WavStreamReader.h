@@ -17,46 +17,55 @@
 #define _IO_WAV_WAVSTREAMREADER_H_
 
 #include <map>
+#include <memory>
 
 #include "AudioEncoding.h"
+#include "AudioStreamReader.h"
 #include "WavRIFFChunkHeader.h"
 #include "WavFmtChunkHeader.h"
+#include "WavDs64ChunkHeader.h"
 
 /*
  * WAV format documentation can be found:
  * http://soundfile.sapp.org/doc/WaveFormat/
  * https://web.archive.org/web/20090417165828/http://www.kk.iij4u.or.jp/~kondo/wave/mpidata.txt
+ * RF64: https://tech.ebu.ch/docs/tech/tech3306v1_1.pdf
  */
 namespace parselib {
 
     class InputStream;
 
-    class WavStreamReader {
+    class WavStreamReader : public AudioStreamReader {
     public:
         WavStreamReader(InputStream *stream);
 
-        int getSampleRate() { return mFmtChunk->mSampleRate; }
+        int getSampleRate() override { return mFmtChunk->mSampleRate; }
 
-        int getNumSampleFrames() {
-            return mDataChunk->mChunkSize / (mFmtChunk->mSampleSize / 8) / mFmtChunk->mNumChannels;
+        int64_t getNumSampleFrames() override {
+            return mDataSize / (mFmtChunk->mSampleSize / 8) / mFmtChunk->mNumChannels;
         }
 
-        int getNumChannels() { return mFmtChunk != 0 ? mFmtChunk->mNumChannels : 0; }
+        int getNumChannels() override { return mFmtChunk != 0 ? mFmtChunk->mNumChannels : 0; }
+
+        /**
+         * true if parse() found both a usable 'fmt ' chunk and a 'data' chunk.
+         */
+        bool isValid() override {
+            return mFmtChunk != 0 && mDataChunk != 0
+                   && mFmtChunk->mNumChannels > 0 && mFmtChunk->mSampleSize >= 8;
+        }
 
         int getSampleEncoding();
 
-        int getBitsPerSample() { return mFmtChunk->mSampleSize; }
+        int getBitsPerSample() override { return mFmtChunk->mSampleSize; }
 
-        void parse();
+        void parse() override;
 
         // Data access
-        void positionToAudio();
-        void setDataPosition(int frameIndex);
+        void positionToAudio() override;
+        void setDataPosition(int64_t frameIndex) override;
 
-        static constexpr int ERR_INVALID_FORMAT    = -1;
-        static constexpr int ERR_INVALID_STATE    = -2;
-
-        int getDataFloat(float *buff, int numFrames);
+        int getDataFloat(float *buff, int numFrames) override;
 
         // int getData16(short *buff, int numFramees);
 
@@ -66,8 +75,10 @@ namespace parselib {
         std::shared_ptr<WavRIFFChunkHeader> mWavChunk;
         std::shared_ptr<WavFmtChunkHeader> mFmtChunk;
         std::shared_ptr<WavChunkHeader> mDataChunk;
+        std::shared_ptr<WavDs64ChunkHeader> mDs64Chunk;
 
-        long mAudioDataStartPos;
+        int64_t mAudioDataStartPos;
+        int64_t mDataSize;          // in bytes, from 'ds64' if the file is RF64
 
         std::map<RiffID, std::shared_ptr<WavChunkHeader>> mChunkMap;
 
@@ -75,6 +86,11 @@ namespace parselib {
         /*
          * Individual Format Readers/Converters
          */
+        typedef void (*ConvertFunction)(const void* src, float* dst, int32_t numSamples);
+
+        int getDataFloat_Converted(float *buff, int numFrames, int sampleSize,
+                                   ConvertFunction convert);
+
         int getDataFloat_PCM8(float *buff, int numFrames);
 
         int getDataFloat_PCM16(float *buff, int numFrames);
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../stream/OutputStream.h"
+
+#include "WavStreamWriter.h"
+
+namespace parselib {
+
+    static constexpr int kConversionBufferBytes = 4096;
+
+    WavStreamWriter::WavStreamWriter(OutputStream *stream, int32_t numChannels,
+                                     int32_t sampleRate, Format format)
+            : mStream(stream),
+              mFormat(format),
+              mDs64Chunk(WavDs64ChunkHeader::RIFFID_JUNK),
+              mDataChunk(WavChunkHeader::RIFFID_DATA),
+              mRiffChunkPos(0),
+              mDs64ChunkPos(0),
+              mDataChunkPos(0),
+              mNumFramesWritten(0) {
+        mFmtChunk.mEncodingId = format == Format::Float32
+                                ? WavFmtChunkHeader::ENCODING_IEEE_FLOAT
+                                : WavFmtChunkHeader::ENCODING_PCM;
+        mFmtChunk.mNumChannels = (short) numChannels;
+        mFmtChunk.mSampleRate = sampleRate;
+        mFmtChunk.mSampleSize = format == Format::PCM16 ? 16 : (format == Format::PCM24 ? 24 : 32);
+        mFmtChunk.normalize();
+    }
+
+    bool WavStreamWriter::writeHeader() {
+        mRiffChunkPos = mStream->getPos();
+        mRiffChunk.mChunkSize = 0; // filled in by finish()
+        mRiffChunk.write(mStream);
+        mDs64ChunkPos = mStream->getPos();
+        mDs64Chunk.write(mStream);
+        mFmtChunk.write(mStream);
+
+        mDataChunkPos = mStream->getPos();
+        mDataChunk.mChunkSize = 0;
+        mDataChunk.write(mStream);
+
+        return mStream->getPos() == mDataChunkPos + 8;
+    }
+
+    // Float to integer, rounded and clipped to the full scale of the format
+    static inline int32_t toInteger(float sample, float fullScale) {
+        float scaled = sample * fullScale;
+        scaled = std::min(std::max(scaled, -fullScale), fullScale - 1.0f);
+        return static_cast<int32_t>(lrintf(scaled));
+    }
+
+    int32_t WavStreamWriter::write(const float *buff, int32_t numFrames) {
+        int32_t numChannels = mFmtChunk.mNumChannels;
+        int32_t frameSize = numChannels * getBytesPerSample();
+
+        if (mFormat == Format::Float32) {
+            // WAV Float32 is just Android floats
+            int32_t numWritten = mStream->write(buff, numFrames * frameSize) / frameSize;
+            mNumFramesWritten += numWritten;
+            return numWritten;
+        }
+
+        uint8_t writeBuff[kConversionBufferBytes];
+        int32_t maxFramesPerWrite = std::max(1, kConversionBufferBytes / frameSize);
+        int32_t totalFramesWritten = 0;
+        while (totalFramesWritten < numFrames) {
+            int32_t numFramesThisWrite = std::min(numFrames - totalFramesWritten, maxFramesPerWrite);
+            int32_t numSamples = numFramesThisWrite * numChannels;
+            const float* src = buff + totalFramesWritten * numChannels;
+
+            if (mFormat == Format::PCM16) {
+                for (int32_t index = 0; index < numSamples; index++) {
+                    int16_t sample = (int16_t) toInteger(src[index], (float) 0x8000);
+                    memcpy(writeBuff + index * sizeof(int16_t), &sample, sizeof(int16_t));
+                }
+            } else {
+                for (int32_t index = 0; index < numSamples; index++) {
+                    int32_t sample = toInteger(src[index], (float) 0x800000);
+                    writeBuff[index * 3] = (uint8_t) sample;
+                    writeBuff[index * 3 + 1] = (uint8_t) (sample >> 8);
+                    writeBuff[index * 3 + 2] = (uint8_t) (sample >> 16);
+                }
+            }
+
+            int32_t numFramesWritten = mStream->write(writeBuff, numFramesThisWrite * frameSize)
+                                       / frameSize;
+            totalFramesWritten += numFramesWritten;
+            if (numFramesWritten < numFramesThisWrite) {
+                break; // out of space?
+            }
+        }
+
+        mNumFramesWritten += totalFramesWritten;
+        return totalFramesWritten;
+    }
+
+    bool WavStreamWriter::finish() {
+        int64_t endPos = mStream->getPos();
+        int64_t dataSize = mNumFramesWritten * mFmtChunk.mNumChannels * getBytesPerSample();
+
+        // Chunks are word aligned
+        if (dataSize & 1) {
+            uint8_t pad = 0;
+            mStream->write(&pad, 1);
+            endPos++;
+        }
+
+        int64_t riffSize = endPos - mRiffChunkPos - 8;
+        if (riffSize > UINT32_MAX) {
+            // RF64, the sizes go in the 'ds64' chunk instead of the placeholder
+            mRiffChunk.mChunkId = WavRIFFChunkHeader::RIFFID_RF64;
+            mRiffChunk.mChunkSize = WavDs64ChunkHeader::SIZE_IN_DS64;
+            mDataChunk.mChunkSize = WavDs64ChunkHeader::SIZE_IN_DS64;
+
+            mDs64Chunk.mChunkId = WavDs64ChunkHeader::RIFFID_DS64;
+            mDs64Chunk.mRiffSize = riffSize;
+            mDs64Chunk.mDataSize = dataSize;
+            mDs64Chunk.mSampleCount = mNumFramesWritten;
+            mStream->setPos(mDs64ChunkPos);
+            mDs64Chunk.write(mStream);
+        } else {
+            // Unsigned, so up to 4 GiB
+            mRiffChunk.mChunkSize = static_cast<RiffInt32>(static_cast<uint32_t>(riffSize));
+            mDataChunk.mChunkSize = static_cast<RiffInt32>(static_cast<uint32_t>(dataSize));
+        }
+        mStream->setPos(mRiffChunkPos);
+        mRiffChunk.write(mStream);
+
+        mStream->setPos(mDataChunkPos);
+        mDataChunk.write(mStream);
+
+        mStream->setPos(endPos);
+        return mStream->getPos() == endPos;
+    }
+
+} // namespace parselib
@@ -0,0 +1,66 @@
+#ifndef _IO_WAV_WAVSTREAMWRITER_H_
+#define _IO_WAV_WAVSTREAMWRITER_H_
+
+#include <cstdint>
+
+#include "WavRIFFChunkHeader.h"
+#include "WavFmtChunkHeader.h"
+#include "WavDs64ChunkHeader.h"
+
+namespace parselib {
+
+    class OutputStream;
+
+/**
+ * Writes interleaved float frames to a WAV file, the counterpart of WavStreamReader.
+ *
+ * Call writeHeader(), then write() as often as needed, then finish() to fill in the chunk
+ * sizes (the stream must support setPos()). Integer formats are rounded and clipped.
+ *
+ * A 'JUNK' chunk is left after the RIFF header so that a file that outgrows 32-bit sizes
+ * (4 GiB) can be turned into RF64 by finish(), which overwrites it with a 'ds64' chunk.
+ */
+    class WavStreamWriter {
+    public:
+        enum class Format : int32_t {
+            PCM16 = 0,
+            PCM24 = 1,
+            Float32 = 2,
+        };
+
+        WavStreamWriter(OutputStream *stream, int32_t numChannels, int32_t sampleRate,
+                        Format format);
+
+        int32_t getNumChannels() { return mFmtChunk.mNumChannels; }
+        int32_t getSampleRate() { return mFmtChunk.mSampleRate; }
+        int64_t getNumFramesWritten() { return mNumFramesWritten; }
+
+        bool writeHeader();
+
+        /**
+         * Returns the number of frames written, less than numFrames on error.
+         */
+        int32_t write(const float *buff, int32_t numFrames);
+
+        bool finish();
+
+    private:
+        int32_t getBytesPerSample() { return mFmtChunk.mSampleSize / 8; }
+
+        OutputStream *mStream;
+        Format mFormat;
+
+        WavRIFFChunkHeader mRiffChunk;
+        WavDs64ChunkHeader mDs64Chunk;
+        WavFmtChunkHeader mFmtChunk;
+        WavChunkHeader mDataChunk;
+
+        int64_t mRiffChunkPos;
+        int64_t mDs64ChunkPos;
+        int64_t mDataChunkPos;
+        int64_t mNumFramesWritten;
+    };
+
+} // namespace parselib
+
+#endif // _IO_WAV_WAVSTREAMWRITER_H_
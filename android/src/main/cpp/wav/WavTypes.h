@@ -22,6 +22,7 @@ namespace parselib {
  * Declarations for various (cross-platform) WAV-specific data types.
  */
     typedef unsigned int RiffID;    // A "four character code" (i.e. FOURCC)
+    typedef long long RiffInt64;    // A 64-bit signed integer
     typedef int RiffInt32;          // A 32-bit signed integer
     typedef short RiffInt16;        // A 16-bit signed integer
 
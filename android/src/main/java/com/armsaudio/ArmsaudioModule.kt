@@ -22,6 +22,7 @@ import com.facebook.react.common.ReactConstants.TAG
 import kotlinx.coroutines.*
 import java.io.File
 import java.net.URL
+import java.nio.ByteBuffer
 import java.util.concurrent.CountDownLatch
 
 data class AudioTrack(
@@ -29,7 +30,10 @@ data class AudioTrack(
     val internalTrackNumber: Int,
     var volume: Float = 1.0f,
     var pan: Float = 0.0f,
-    var amplitudes: MutableList<Float> = MutableList(10) { 0.0f } // Initialize with 10 zeroes
+    var amplitudes: MutableList<Float> = MutableList(10) { 0.0f }, // Initialize with 10 zeroes
+    var peakDecibels: Float = SharedEngineState.SILENCE_DECIBELS,
+    var rmsDecibels: Float = SharedEngineState.SILENCE_DECIBELS,
+    var peakHoldDecibels: Float = SharedEngineState.SILENCE_DECIBELS
 )
 
 class ArmsaudioModule(reactContext: ReactApplicationContext) :
@@ -37,6 +41,31 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
 
     companion object {
         const val NAME = "Armsaudio"
+
+        // Must match iolib::LoadPolicy
+        const val LOAD_POLICY_STREAM = 0
+        const val LOAD_POLICY_PRELOAD = 1
+        const val LOAD_POLICY_AUTO = 2
+
+        // Must match iolib::ResamplerQuality
+        const val RESAMPLER_QUALITY_LOW = 0
+        const val RESAMPLER_QUALITY_MEDIUM = 1
+        const val RESAMPLER_QUALITY_HIGH = 2
+
+        // Must match parselib::WavStreamWriter::Format
+        const val MIXDOWN_FORMAT_PCM16 = 0
+        const val MIXDOWN_FORMAT_PCM24 = 1
+        const val MIXDOWN_FORMAT_FLOAT32 = 2
+
+        // Must match iolib::TrackLoader::TrackState
+        const val TRACK_STATE_PENDING = 0
+        const val TRACK_STATE_LOADING = 1
+        const val TRACK_STATE_READY = 2
+        const val TRACK_STATE_FAILED = 3
+        const val TRACK_STATE_CANCELLED = 4
+
+        // Peak level shown as amplitude 0, full scale is 1
+        const val AMPLITUDE_FLOOR_DECIBELS = -60.0f
     }
 
     init {
@@ -46,16 +75,40 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     external fun testFunction(): Long
     external fun preparePlayer()
     external fun resetPlayer()
-    external fun loadTrack(fileName: String): Int
+    external fun loadTrack(fileName: String, loadPolicy: Int): Int
+    external fun loadTracks(fileNames: Array<String>, loadPolicy: Int): Int
+    external fun getTrackLoadStates(numTracks: Int): IntArray
+    external fun cancelTrackLoading()
+    external fun setParallelMixing(enabled: Boolean, minTracks: Int, minLoad: Float)
     external fun getMaxPlaybackDuration(): Float
     external fun playAudioInternal()
     external fun pauseAudio()
     external fun resumeAudio()
-    external fun getCurrentPosition(): Float
-    external fun getAmplitudes(): Array<Float>
-    external fun setPosition(position: Float)
+    external fun getCurrentFrame(): Long
+    external fun getTotalFrames(): Long
+    external fun getSharedState(): ByteBuffer
+    external fun setTrackMeterBallistics(refreshHz: Float, releaseDbPerSecond: Float, holdSeconds: Float)
+    external fun setPositionFrames(frame: Long)
     external fun setTrackVolume(trackNum: Int, volume: Float)
     external fun setTrackPan(trackNum: Int, pan: Float)
+    external fun getTrackStarvationCount(trackNum: Int): Int
+    external fun createMixBus(): Int
+    external fun removeMixBus(bus: Int): Boolean
+    external fun setMixBusOutput(bus: Int, outputBus: Int): Boolean
+    external fun setTrackBus(trackNum: Int, bus: Int): Boolean
+    external fun setMixBusGain(bus: Int, gain: Float)
+    external fun setMixBusPan(bus: Int, pan: Float)
+    external fun setMixBusMute(bus: Int, muted: Boolean)
+    external fun setStreamingWatermarks(lowWatermarkFrames: Int, highWatermarkFrames: Int)
+    external fun setResamplerQuality(quality: Int)
+    external fun renderMixdown(path: String, format: Int): Boolean
+    external fun getMixdownProgress(): Float
+    external fun getMixdownSpeed(): Float
+    external fun getCallbackReport(maxTracks: Int): DoubleArray
+    external fun resetCallbackReport()
+    external fun setAdaptiveLatency(enabled: Boolean, maxLatencyMillis: Float)
+    external fun getOutputLatencyMillis(): Float
+    external fun getTrackWaveform(trackNum: Int, startFrame: Long, endFrame: Long, numPeaks: Int): FloatArray?
 
     override fun getName(): String {
         return NAME
@@ -71,6 +124,10 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     }
     private val scope = CoroutineScope(Dispatchers.IO)
     private var amplitudeTimer: Job? = null
+    private var amplitudeIntervalMs = 100L
+    // Views of the engine's shared state, one per timer
+    private val meterState: SharedEngineState by lazy { SharedEngineState(getSharedState()) }
+    private val progressState: SharedEngineState by lazy { SharedEngineState(getSharedState()) }
     private var progressUpdateTimer: Job? = null
     private var playerPrepared = false
 
@@ -234,13 +291,16 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
             }
 
             val files = deferreds.awaitAll()
+            val trackFiles = mutableListOf<File>()
             files.filterNotNull().forEach { file ->
                 val i = file.name.lastIndexOf('.')
                 val substr = file.name.substring(0, i)
                 val outputFile = File(file.parent, "$substr.wav")
-                if (outputFile.exists() && outputFile.totalSpace > 0)
-                    addTrack(outputFile)
-                else convertFile(file, outputFile) { addTrack(it) }
+                if (file.extension.equals("flac", ignoreCase = true))
+                    trackFiles.add(file) // decoded natively, as it streams
+                else if (outputFile.exists() && outputFile.totalSpace > 0)
+                    trackFiles.add(outputFile)
+                else convertFile(file, outputFile) { trackFiles.add(it) }
 
                 withContext(Dispatchers.Main) {
                     downloadedFiles += 1
@@ -252,6 +312,10 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
                 }
             }
 
+            if (!addTracks(trackFiles)) {
+                hasErrorOccurred = true
+            }
+
             withContext(Dispatchers.Main) {
                 if (!hasErrorOccurred) {
                     sendArrayEvent("DownloadComplete", audioTracks.map { it.fileName })
@@ -306,25 +370,149 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
         }
     }
 
+    // Submix buses. Bus 0 is the master output; new buses, and all tracks, feed it until
+    // routed elsewhere.
+    @ReactMethod
+    fun createBus(promise: Promise) {
+        val bus = createMixBus()
+        if (bus >= 0) {
+            promise.resolve(bus)
+        } else {
+            promise.reject("CREATE_BUS_ERROR", "No more buses available")
+        }
+    }
+
+    @ReactMethod
+    fun removeBus(bus: Int, promise: Promise) {
+        if (removeMixBus(bus)) {
+            promise.resolve(true)
+        } else {
+            promise.reject("REMOVE_BUS_ERROR", "Can't remove bus $bus")
+        }
+    }
+
+    @ReactMethod
+    fun setBusOutput(bus: Int, outputBus: Int, promise: Promise) {
+        if (setMixBusOutput(bus, outputBus)) {
+            promise.resolve(true)
+        } else {
+            promise.reject("SET_BUS_OUTPUT_ERROR", "Can't route bus $bus to bus $outputBus")
+        }
+    }
+
+    @ReactMethod
+    fun setBus(bus: Int, forFileName: String, promise: Promise) {
+        val track = audioTracks.find { it.fileName == forFileName }
+        if (track != null && setTrackBus(track.internalTrackNumber, bus)) {
+            promise.resolve(true)
+        } else {
+            promise.reject("SET_BUS_ERROR", "Can't route $forFileName to bus $bus")
+        }
+    }
+
+    @ReactMethod
+    fun setBusVolume(bus: Int, volume: Float) {
+        setMixBusGain(bus, volume)
+    }
+
+    @ReactMethod
+    fun setBusPan(bus: Int, pan: Float) {
+        setMixBusPan(bus, pan)
+    }
+
+    @ReactMethod
+    fun setBusMute(bus: Int, muted: Boolean) {
+        setMixBusMute(bus, muted)
+    }
+
     @ReactMethod
     fun setAudioProgress(progress: Double, promise: Promise) {
-        setPosition(progress.toFloat())
+        setPositionFrames(progressToFrame(progress))
 
         promise.resolve(true)
     }
 
     @ReactMethod
     fun audioSliderChanged(progress: Double, promise: Promise) {
-        setPosition(progress.toFloat())
+        setPositionFrames(progressToFrame(progress))
         promise.resolve(true)
     }
 
+    private fun progressToFrame(progress: Double): Long {
+        return (progress.coerceIn(0.0, 1.0) * getTotalFrames()).toLong()
+    }
+
+    private fun getPlaybackProgress(): Double {
+        progressState.read()
+        return progressState.progress
+    }
+
+    @ReactMethod
+    fun exportMix(path: String, format: Int, promise: Promise) {
+        scope.launch {
+            val progressJob = launch {
+                while (isActive) {
+                    delay(100)
+                    val progressEvent = Arguments.createMap()
+                    progressEvent.putDouble("progress", getMixdownProgress().toDouble())
+                    progressEvent.putDouble("speed", getMixdownSpeed().toDouble())
+                    sendEvent("MixdownProgress", progressEvent)
+                }
+            }
+
+            val rendered = renderMixdown(path, format)
+            progressJob.cancel()
+
+            if (rendered) {
+                val progressEvent = Arguments.createMap()
+                progressEvent.putDouble("progress", 1.0)
+                progressEvent.putDouble("speed", getMixdownSpeed().toDouble())
+                sendEvent("MixdownProgress", progressEvent)
+                promise.resolve(path)
+            } else {
+                promise.reject("EXPORT_MIX_ERROR", "Failed to render the mix to $path")
+                sendGenAppErrors("Failed to render the mix to $path")
+            }
+        }
+    }
+
+    @ReactMethod
+    fun getWaveform(forFileName: String, startProgress: Double, endProgress: Double, width: Int, promise: Promise) {
+        val track = audioTracks.find { it.fileName == forFileName }
+        if (track == null) {
+            promise.reject("GET_WAVEFORM_ERROR", "Player does not exist for $forFileName")
+            return
+        }
+
+        // Interleaved min, max, rms per pixel
+        val peaks = getTrackWaveform(
+            track.internalTrackNumber, progressToFrame(startProgress), progressToFrame(endProgress), width)
+        if (peaks == null) {
+            promise.reject("GET_WAVEFORM_ERROR", "No waveform for $forFileName")
+            return
+        }
+
+        val minArray = Arguments.createArray()
+        val maxArray = Arguments.createArray()
+        val rmsArray = Arguments.createArray()
+        for (i in 0 until peaks.size / 3) {
+            minArray.pushDouble(peaks[i * 3].toDouble())
+            maxArray.pushDouble(peaks[i * 3 + 1].toDouble())
+            rmsArray.pushDouble(peaks[i * 3 + 2].toDouble())
+        }
+        val waveform = Arguments.createMap()
+        waveform.putArray("min", minArray)
+        waveform.putArray("max", maxArray)
+        waveform.putArray("rms", rmsArray)
+        promise.resolve(waveform)
+    }
+
     private fun startAmplitudeUpdate() {
         amplitudeTimer?.cancel()
         amplitudeTimer = scope.launch {
             while (isActive) {
                 updateAmplitudes()
-                delay(100) // Update every 100ms
+                delay(amplitudeIntervalMs)
             }
         }
     }
@@ -332,10 +520,18 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     private fun updateAmplitudes() {
         if (isMixPaused) return
 
-        val amplitudes = getAmplitudes()
-        audioTracks.forEachIndexed { index, track ->
+        // Read in place, no call into the engine
+        if (!meterState.read()) return
+        audioTracks.forEach { track ->
+            val index = track.internalTrackNumber
+            if (index < 0 || index >= meterState.numTracks) return@forEach
+            track.peakDecibels = meterState.peakDecibels[index]
+            track.rmsDecibels = meterState.rmsDecibels[index]
+            track.peakHoldDecibels = meterState.peakHoldDecibels[index]
+
+            val amplitude = 1.0f - track.peakDecibels / AMPLITUDE_FLOOR_DECIBELS
             track.amplitudes.removeAt(0)
-            track.amplitudes.add(amplitudes[index])
+            track.amplitudes.add(amplitude.coerceIn(0.0f, 1.0f))
         }
 
         sendTrackAmplitudeUpdates()
@@ -344,11 +540,19 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     private fun sendTrackAmplitudeUpdates() {
         val eventParams = Arguments.createMap()
         val amplitudesMap = Arguments.createMap()
+        val metersMap = Arguments.createMap()
         audioTracks.forEach {
             amplitudesMap.putString(it.fileName, it.amplitudes.last().toString())
+
+            val meters = Arguments.createMap()
+            meters.putDouble("peak", it.peakDecibels.toDouble())
+            meters.putDouble("rms", it.rmsDecibels.toDouble())
+            meters.putDouble("peakHold", it.peakHoldDecibels.toDouble())
+            metersMap.putMap(it.fileName, meters)
         }
 
         eventParams.putMap("amplitudes", amplitudesMap)
+        eventParams.putMap("meters", metersMap)
         sendEvent("TracksAmplitudes", eventParams)
     }
 
@@ -356,9 +560,9 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
         progressUpdateTimer?.cancel() // Ensure no duplicate timers
         progressUpdateTimer = scope.launch {
             while (isActive && !isMixPaused) {
-                val progress = getCurrentPosition()
+                val progress = getPlaybackProgress()
                 val progressEvent = Arguments.createMap()
-                progressEvent.putDouble("progress", progress.toDouble())
+                progressEvent.putDouble("progress", progress)
                 sendEvent("PlaybackProgress", progressEvent)
                 delay(100) // Update every 100ms
             }
@@ -368,6 +572,7 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     @ReactMethod
     private fun resetApp() {
         // Stop and release all media players
+        cancelTrackLoading()
         resetPlayer()
         reactApplicationContext.removeLifecycleEventListener(lifecycleEventListener)
         deleteCache(reactApplicationContext)
@@ -412,10 +617,126 @@ class ArmsaudioModule(reactContext: ReactApplicationContext) :
     }
 
     private fun addTrack(track: File) {
-        val trackNum = loadTrack(track.absolutePath)
+        val trackNum = loadTrack(track.absolutePath, LOAD_POLICY_AUTO)
         audioTracks.add(AudioTrack(track.absolutePath, trackNum))
     }
 
+    // Loads all tracks in parallel, reporting each one's state as it changes. Returns false if
+    // any track failed to load or the load was cancelled.
+    private suspend fun addTracks(tracks: List<File>): Boolean {
+        if (tracks.isEmpty()) return true
+
+        val firstTrackNum = loadTracks(tracks.map { it.absolutePath }.toTypedArray(), LOAD_POLICY_AUTO)
+        if (firstTrackNum < 0) {
+            sendGenAppErrors("Too many tracks to load")
+            return false
+        }
+
+        var lastStates = IntArray(tracks.size) { -1 }
+        while (true) {
+            val states = getTrackLoadStates(tracks.size)
+            states.forEachIndexed { index, state ->
+                if (state != lastStates[index]) {
+                    val loadEvent = Arguments.createMap()
+                    loadEvent.putString("fileName", tracks[index].absolutePath)
+                    loadEvent.putInt("state", state)
+                    loadEvent.putDouble("progress",
+                        states.count { it >= TRACK_STATE_READY }.toDouble() / tracks.size)
+                    sendEvent("TrackLoadProgress", loadEvent)
+                }
+            }
+            lastStates = states
+            if (states.all { it >= TRACK_STATE_READY }) break
+            delay(50)
+        }
+
+        var allLoaded = true
+        lastStates.forEachIndexed { index, state ->
+            if (state == TRACK_STATE_READY) {
+                audioTracks.add(AudioTrack(tracks[index].absolutePath, firstTrackNum + index))
+            } else {
+                allLoaded = false
+                if (state == TRACK_STATE_FAILED) {
+                    sendGenAppErrors("Failed to load track: ${tracks[index].name}")
+                }
+            }
+        }
+        return allLoaded
+    }
+
+    // Spreads the mix over several cores once at least minTracks tracks play, or mixing takes
+    // more than minLoad (0..1) of each audio callback
+    @ReactMethod
+    fun setParallelMix(enabled: Boolean, minTracks: Int, minLoad: Double) {
+        setParallelMixing(enabled, minTracks, minLoad.toFloat())
+    }
+
+    // Meters are published refreshHz times a second (dBFS, see TracksAmplitudes "meters"), and
+    // polled at the same rate
+    @ReactMethod
+    fun setMeterBallistics(refreshHz: Double, releaseDbPerSecond: Double, holdSeconds: Double) {
+        setTrackMeterBallistics(refreshHz.toFloat(), releaseDbPerSecond.toFloat(), holdSeconds.toFloat())
+        if (refreshHz > 0) {
+            amplitudeIntervalMs = maxOf(10L, (1000.0 / refreshHz).toLong())
+        }
+    }
+
+    // Loads are fractions of the callback's budget (the duration of the frames it renders),
+    // track costs are in microseconds per callback
+    @ReactMethod
+    fun getCallbackStats(maxTracks: Int, promise: Promise) {
+        val values = getCallbackReport(maxTracks)
+        val stats = Arguments.createMap()
+        stats.putDouble("callbacks", values[0])
+        stats.putDouble("lateCallbacks", values[1])
+        stats.putDouble("xruns", values[2])
+
+        val percentileNames = arrayOf("p50", "p90", "p99", "p999")
+        val wallLoad = Arguments.createMap()
+        val cpuLoad = Arguments.createMap()
+        percentileNames.forEachIndexed { index, name ->
+            wallLoad.putDouble(name, values[3 + index])
+            cpuLoad.putDouble(name, values[7 + index])
+        }
+        wallLoad.putDouble("max", values[11])
+        cpuLoad.putDouble("max", values[12])
+        stats.putMap("wallLoad", wallLoad)
+        stats.putMap("cpuLoad", cpuLoad)
+
+        val costliestTracks = Arguments.createArray()
+        for (offset in 13 until values.size step 3) {
+            val trackNumber = values[offset].toInt()
+            val cost = Arguments.createMap()
+            cost.putString("fileName", audioTracks.find { it.internalTrackNumber == trackNumber }?.fileName)
+            cost.putDouble("meanMicros", values[offset + 1])
+            cost.putDouble("maxMicros", values[offset + 2])
+            costliestTracks.pushMap(cost)
+        }
+        stats.putArray("costliestTracks", costliestTracks)
+        promise.resolve(stats)
+    }
+
+    @ReactMethod
+    fun resetCallbackStats() {
+        resetCallbackReport()
+    }
+
+    // The output buffer starts at one burst and grows on underruns, up to maxLatencyMs
+    @ReactMethod
+    fun setOutputLatency(adaptive: Boolean, maxLatencyMs: Double) {
+        setAdaptiveLatency(adaptive, maxLatencyMs.toFloat())
+    }
+
+    @ReactMethod
+    fun getOutputLatency(promise: Promise) {
+        promise.resolve(getOutputLatencyMillis().toDouble())
+    }
+
+    @ReactMethod
+    fun cancelLoading() {
+        cancelTrackLoading()
+    }
+
     private fun deleteCache(context: Context) {
         try {
             val dir = context.cacheDir
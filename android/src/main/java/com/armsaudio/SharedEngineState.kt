@@ -0,0 +1,161 @@
+package com.armsaudio
+
+import android.os.Build
+import androidx.annotation.RequiresApi
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.math.log10
+import kotlin.math.max
+import kotlin.math.min
+import kotlin.math.sqrt
+
+/**
+ * Reads the engine's shared state block (iolib::SharedStateBlock) in place: transport, meters
+ * and xrun count. read() copies a consistent state into this object's fields and arrays, it
+ * doesn't allocate, so it can run at display rate. Not thread safe: use one instance per
+ * reading thread, they can share the buffer.
+ *
+ * The block is a seqlock written by native code, so the reads need acquire fences that the
+ * Java memory model only offers from API 33 (VarHandle.acquireFence()). Before that, read()
+ * takes the copy through the engine (iolib::SharedStateReader) instead of in place.
+ */
+class SharedEngineState(private val buffer: ByteBuffer) {
+
+    companion object {
+        // Must match iolib::SharedStateBlock
+        private const val MAGIC = 0x584d4e52
+        private const val VERSION = 1
+        private const val OFFSET_MAGIC = 0
+        private const val OFFSET_VERSION = 4
+        private const val OFFSET_SEQUENCE = 8
+        private const val OFFSET_NUM_TRACKS = 12
+        private const val OFFSET_TRANSPORT_FRAME = 16
+        private const val OFFSET_TOTAL_FRAMES = 24
+        private const val OFFSET_SAMPLE_RATE = 32
+        private const val OFFSET_PLAYING = 36
+        private const val OFFSET_XRUN_COUNT = 40
+        private const val OFFSET_METER_FRAME = 48
+        private const val OFFSET_METERS = 56
+        const val MAX_TRACKS = 128
+        const val VALUES_PER_TRACK = 3
+
+        private const val MAX_READ_ATTEMPTS = 8
+
+        // Must match iolib::LevelMeters::kSilenceDecibels
+        const val SILENCE_DECIBELS = -100.0f
+
+        // nativeRead()'s header: transport frame, total frames, sample rate, playing (0/1),
+        // xrun count, meter frame, number of tracks
+        private const val HEADER_SIZE = 7
+
+        private fun toDecibels(amplitude: Float): Float =
+            if (amplitude > 0.0f) max(SILENCE_DECIBELS, 20.0f * log10(amplitude)) else SILENCE_DECIBELS
+
+        /**
+         * Copies the block in buffer with iolib::SharedStateReader: the header into header,
+         * the meters, already in dBFS, into meters. Returns false as read() does.
+         */
+        @JvmStatic
+        private external fun nativeRead(buffer: ByteBuffer, header: LongArray, meters: FloatArray): Boolean
+    }
+
+    private val block = buffer.duplicate().order(ByteOrder.nativeOrder())
+
+    val isValid = block.capacity() >= OFFSET_METERS + MAX_TRACKS * VALUES_PER_TRACK * 4 &&
+        block.getInt(OFFSET_MAGIC) == MAGIC && block.getInt(OFFSET_VERSION) == VERSION
+
+    var transportFrame = 0L
+        private set
+    var totalFrames = 0L
+        private set
+    var sampleRate = 0
+        private set
+    var isPlaying = false
+        private set
+    var xRunCount = 0
+        private set
+    var meterFrame = 0L
+        private set
+    var numTracks = 0
+        private set
+
+    // dBFS per track, valid for the first numTracks tracks
+    val peakDecibels = FloatArray(MAX_TRACKS)
+    val rmsDecibels = FloatArray(MAX_TRACKS)
+    val peakHoldDecibels = FloatArray(MAX_TRACKS)
+
+    private val levels = FloatArray(MAX_TRACKS * VALUES_PER_TRACK)
+    private val header = LongArray(HEADER_SIZE)
+
+    val progress: Double
+        get() = if (totalFrames > 0) transportFrame.toDouble() / totalFrames else 0.0
+
+    /**
+     * Copies the current state into the fields. Returns false, leaving them unchanged, if the
+     * audio thread kept overtaking the copy.
+     */
+    fun read(): Boolean {
+        if (!isValid) return false
+        return if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) readInPlace() else readThroughEngine()
+    }
+
+    // Direct buffer reads are plain loads, the fences keep them between the two sequence reads
+    @RequiresApi(Build.VERSION_CODES.TIRAMISU)
+    private fun readInPlace(): Boolean {
+        repeat(MAX_READ_ATTEMPTS) {
+            val sequence = block.getInt(OFFSET_SEQUENCE)
+            if (sequence and 1 != 0) return@repeat
+            VarHandle.acquireFence()
+
+            val newTransportFrame = block.getLong(OFFSET_TRANSPORT_FRAME)
+            val newTotalFrames = block.getLong(OFFSET_TOTAL_FRAMES)
+            val newSampleRate = block.getInt(OFFSET_SAMPLE_RATE)
+            val newPlaying = block.getInt(OFFSET_PLAYING) != 0
+            val newXRunCount = block.getInt(OFFSET_XRUN_COUNT)
+            val newMeterFrame = block.getLong(OFFSET_METER_FRAME)
+            val newNumTracks = min(max(block.getInt(OFFSET_NUM_TRACKS), 0), MAX_TRACKS)
+            for (index in 0 until newNumTracks * VALUES_PER_TRACK) {
+                levels[index] = block.getFloat(OFFSET_METERS + index * 4)
+            }
+
+            VarHandle.acquireFence()
+            if (block.getInt(OFFSET_SEQUENCE) != sequence) return@repeat
+
+            transportFrame = newTransportFrame
+            totalFrames = newTotalFrames
+            sampleRate = newSampleRate
+            isPlaying = newPlaying
+            xRunCount = newXRunCount
+            meterFrame = newMeterFrame
+            numTracks = newNumTracks
+            for (track in 0 until numTracks) {
+                val offset = track * VALUES_PER_TRACK
+                peakDecibels[track] = toDecibels(levels[offset])
+                rmsDecibels[track] = toDecibels(sqrt(levels[offset + 1]))
+                peakHoldDecibels[track] = toDecibels(levels[offset + 2])
+            }
+            return true
+        }
+        return false
+    }
+
+    private fun readThroughEngine(): Boolean {
+        if (!nativeRead(buffer, header, levels)) return false
+
+        transportFrame = header[0]
+        totalFrames = header[1]
+        sampleRate = header[2].toInt()
+        isPlaying = header[3] != 0L
+        xRunCount = header[4].toInt()
+        meterFrame = header[5]
+        numTracks = header[6].toInt()
+        for (track in 0 until numTracks) {
+            val offset = track * VALUES_PER_TRACK
+            peakDecibels[track] = levels[offset]
+            rmsDecibels[track] = levels[offset + 1]
+            peakHoldDecibels[track] = levels[offset + 2]
+        }
+        return true
+    }
+}